@@ -254,105 +254,13 @@ void add_label_ranges(const std::shared_ptr<pq_string>& in, std::vector<std::sha
         }
     }
 
-    // now, expand sums 
-
-    bool done_adding_ranges = false;
-    do {
-        std::vector< std::shared_ptr<pq_string> > list;
-        done_adding_ranges = true;
-        for (const std::shared_ptr<pq_string> & tmp_str : tmp) {
-            bool am_i_done = add_ranges_to_string(tmp_str, list);
-            if ( !am_i_done ) done_adding_ranges = false;
-        }
-        if ( !done_adding_ranges ) {
-            tmp.clear();
-            for (std::shared_ptr<pq_string> & pq_str : list) {
-                if ( !pq_str->skip ) {
-                    tmp.push_back(pq_str);
-                }
-            }
-        }
-    }while(!done_adding_ranges);
-
-    // kill deltas that have mismatched ranges
-    for (std::shared_ptr<pq_string> & tmp_str : tmp) {
-
-        if ( tmp_str->skip ) continue;
-
-        bool killit = false;
-
-        // delta functions 
-        for (size_t j = 0; j < in->deltas.size(); j++) {
-            if (tmp_str->deltas[j].label_ranges[0] != tmp_str->deltas[j].label_ranges[1] ) {
-                killit = true;
-                break;
-            }
-        }
-
-        if ( killit ) {
-            tmp_str->skip = true;
-            continue;
-        }
-    }
-
-    // kill terms with ranges inconsistent with what is in the map
-    for (std::shared_ptr<pq_string> & tmp_str : tmp) {
-
-        if ( tmp_str->skip ) continue;
-
-        bool killit = false;
-
-        // get desired ranges for amplitudes from map
-        for (auto &amp_pair : tmp_str->amps) {
-            char type = amp_pair.first;
-            std::vector<amplitudes> & amps = amp_pair.second;
-            for (amplitudes & amp : amps) {
-
-                // amplitude type+order (ie 't' + '2' = "t2")
-                std::string amptype;
-                amptype.push_back(type);
-                int order = amp.n_create;
-                if (amp.n_annihilate > order) {
-                    order = amp.n_annihilate;
-                }
-                amptype += std::to_string(order);
-                
-                // is this amplitude in the map? if not, we can assume full ranges are desired
-                auto amp_pos = label_ranges.find(amptype); 
-                if ( amp_pos == label_ranges.end() ) continue;
-                
-                // get desired ranges for this amplitude from map
-                std::vector<std::string> label_range = amp_pos->second;
-
-                // are the number of ranges provided by the user correct?
-                if (label_range.size() != amp.label_ranges.size() ) {
-                    printf("\n");
-                    printf("    error: something is wrong with the number of ranges for %s\n", amptype.c_str());
-                    printf("\n");
-                    exit(1);
-                }
-
-                // check label ranges
-                killit = do_ranges_differ(0, amp.n_create, "act", amp.label_ranges, label_range);
-                if ( killit ) break;
-
-                killit = do_ranges_differ(0, amp.n_create, "ext", amp.label_ranges, label_range);
-                if ( killit ) break;
-
-                killit = do_ranges_differ(amp.n_create, amp.n_create + amp.n_annihilate, "act", amp.label_ranges, label_range);
-                if ( killit ) break;
-
-                killit = do_ranges_differ(amp.n_create, amp.n_create + amp.n_annihilate, "ext", amp.label_ranges, label_range);
-                if ( killit ) break;
-            }
-            if ( killit ) break;
-
-        }
-        if ( killit ) {
-            tmp_str->skip = true;
-            continue;
-        }
+    // now, expand sums. ranges are assigned one summed label at a time, so terms with mismatched
+    // ranges are discarded as soon as the mismatch appears rather than after full expansion
+    std::vector< std::shared_ptr<pq_string> > list;
+    for (const std::shared_ptr<pq_string> & tmp_str : tmp) {
+        add_ranges_to_string(tmp_str, list, label_ranges);
     }
+    tmp.swap(list);
 
     // rearrange terms so that they have standard range order ( ae;ea -> -ae;ae etc. )
     for (std::shared_ptr<pq_string> & tmp_str : tmp) {
@@ -437,10 +345,10 @@ void reorder_two_ranges(tensor & tens, int i1, int i2, int & sign) {
     if (       tens.label_ranges[i1] == "ext"
             && tens.label_ranges[i2] == "act" ) {
 
-            std::string tmp_label = tens.labels[i2];
+            pq_label tmp_label = tens.labels.id(i2);
 
-            tens.labels[i2] = tens.labels[i1];
-            tens.labels[i1] = tmp_label;
+            tens.labels.set(i2, tens.labels.id(i1));
+            tens.labels.set(i1, tmp_label);
 
             tens.label_ranges[i1] = "act";
             tens.label_ranges[i2] = "ext";
@@ -457,10 +365,10 @@ void reorder_three_ranges(amplitudes & amps, int i1, int i2, int i3, int & sign)
             && amps.label_ranges[i2] == "ext"
             && amps.label_ranges[i3] == "act" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i2];
-            amps.labels[i2] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i2));
+            amps.labels.set(i2, tmp_label);
 
             amps.label_ranges[i2] = "act";
             amps.label_ranges[i3] = "ext";
@@ -471,10 +379,10 @@ void reorder_three_ranges(amplitudes & amps, int i1, int i2, int i3, int & sign)
             && amps.label_ranges[i2] == "act"
             && amps.label_ranges[i3] == "act" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.label_ranges[i1] = "act";
             amps.label_ranges[i3] = "ext";
@@ -485,10 +393,10 @@ void reorder_three_ranges(amplitudes & amps, int i1, int i2, int i3, int & sign)
             && amps.label_ranges[i2] == "ext"
             && amps.label_ranges[i3] == "act" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.label_ranges[i1] = "act";
             amps.label_ranges[i3] = "ext";
@@ -499,10 +407,10 @@ void reorder_three_ranges(amplitudes & amps, int i1, int i2, int i3, int & sign)
             && amps.label_ranges[i2] == "act"
             && amps.label_ranges[i3] == "ext" ) {
 
-            std::string tmp_label = amps.labels[i2];
+            pq_label tmp_label = amps.labels.id(i2);
 
-            amps.labels[i2] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i2, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.label_ranges[i1] = "act";
             amps.label_ranges[i2] = "ext";
@@ -513,89 +421,195 @@ void reorder_three_ranges(amplitudes & amps, int i1, int i2, int i3, int & sign)
 
 }
 
-// do ranges in two strings differ? second string should be the map that could contain "all"
-bool do_ranges_differ(size_t start, size_t end, const std::string& range, const std::vector<std::string> &in1, const std::vector<std::string> &in2) {
-
-    // number of input ranges in current amplitude
-    int n1 = 0;
-    int n2 = 0;
-    int nall = 0;
-    for (size_t m = start; m < end; m++) {
-        if ( in1[m] == "all" ) {
-            printf("\n");
-            printf("    error: first string range should not include 'all'\n");
-            printf("\n");
-            exit(1);
+// a range constraint on one tensor. labels with a fixed range are stored as act_range or ext_range,
+// and summed labels by variable index. the labels of a delta function must share a range,
+// and neither half of an amplitude whose ranges are given in the label-range map may hold more
+// active or external labels than the map allows
+static constexpr int act_range = -1;
+static constexpr int ext_range = -2;
+
+struct range_constraint {
+    std::vector<int> labels;
+    bool is_delta = false;
+    size_t n_create = 0;
+    int max_act[2] = {0, 0};
+    int max_ext[2] = {0, 0};
+};
+
+// the range of a label in a range constraint, given the ranges assigned so far (0 if unassigned)
+static char constraint_range(int label, const std::vector<char> &ranges) {
+    if ( label == act_range ) return 'a';
+    if ( label == ext_range ) return 'e';
+    return ranges[label];
+}
+
+// map a tensor's labels to fixed ranges or variable indices
+static std::vector<int> range_constraint_labels(const std::vector<std::string> &labels, const std::vector<std::string> &label_ranges,
+                                                std::vector<std::string> &variables) {
+    std::vector<int> result;
+    for (size_t k = 0; k < labels.size(); k++) {
+        if ( label_ranges[k] == "act" ) {
+            result.push_back(act_range);
+        }else if ( label_ranges[k] == "ext" ) {
+            result.push_back(ext_range);
+        }else {
+            // summed labels are numbered in order of first appearance
+            size_t var = std::find(variables.begin(), variables.end(), labels[k]) - variables.begin();
+            if ( var == variables.size() ) variables.push_back(labels[k]);
+            result.push_back((int)var);
         }
-        if ( in1[m] == range ) n1++;
-        if ( in2[m] == range ) n2++;
-        if ( in2[m] == "all" ) nall++;
+    }
+    return result;
+}
+
+// can a range constraint still be satisfied, given the ranges assigned so far?
+static bool range_constraint_is_satisfiable(const range_constraint &constraint, const std::vector<char> &ranges) {
+
+    if ( constraint.is_delta ) {
+        char r0 = constraint_range(constraint.labels[0], ranges);
+        char r1 = constraint_range(constraint.labels[1], ranges);
+        return r0 == 0 || r1 == 0 || r0 == r1;
     }
 
-    if ( n1 == n2 ) return false;
-    if ( n1 <= n2 + nall ) return false;
+    // the number of active / external labels in each half only grows as ranges are assigned
+    int n_act[2] = {0, 0};
+    int n_ext[2] = {0, 0};
+    for (size_t k = 0; k < constraint.labels.size(); k++) {
+        size_t half = k < constraint.n_create ? 0 : 1;
+        char range = constraint_range(constraint.labels[k], ranges);
+        if ( range == 'a' ) n_act[half]++;
+        if ( range == 'e' ) n_ext[half]++;
+    }
+    for (size_t half = 0; half < 2; half++) {
+        if ( n_act[half] > constraint.max_act[half] ) return false;
+        if ( n_ext[half] > constraint.max_ext[half] ) return false;
+    }
     return true;
 }
 
+// assign ranges to summed labels, one label at a time, abandoning a branch as soon as one
+// of the tensors that contains the label has a forbidden range pattern
+static void assign_ranges(const std::shared_ptr<pq_string>& in, size_t var, const std::vector<std::string> &variables,
+                          const std::vector<range_constraint> &constraints,
+                          const std::vector<std::vector<size_t> > &constraints_for_variable,
+                          std::vector<char> &ranges, std::vector<std::shared_ptr<pq_string> > &list) {
+
+    if ( var == variables.size() ) {
+        std::shared_ptr<pq_string> newguy (new pq_string(in->vacuum));
+        newguy->copy(in.get());
+        for (size_t i = 0; i < variables.size(); i++) {
+            newguy->set_range_everywhere(variables[i], ranges[i] == 'a' ? "act" : "ext");
+        }
+        list.push_back(newguy);
+        return;
+    }
+
+    for (char range : {'a', 'e'}) {
+        ranges[var] = range;
+        bool allowed = true;
+        for (size_t c : constraints_for_variable[var]) {
+            if ( !range_constraint_is_satisfiable(constraints[c], ranges) ) {
+                allowed = false;
+                break;
+            }
+        }
+        if ( allowed ) {
+            assign_ranges(in, var + 1, variables, constraints, constraints_for_variable, ranges, list);
+        }
+    }
+    ranges[var] = 0;
+}
+
 // add label ranges to a string
-bool add_ranges_to_string(const std::shared_ptr<pq_string>& in, std::vector<std::shared_ptr<pq_string> > &list) {
+void add_ranges_to_string(const std::shared_ptr<pq_string>& in, std::vector<std::shared_ptr<pq_string> > &list,
+                          const std::unordered_map<std::string, std::vector<std::string>> &label_ranges) {
 
-    if ( in->skip ) return true;
+    if ( in->skip ) return;
 
-    bool all_ranges_added = false;
+    // summed labels, in the order that they appear in amplitudes and then integrals
+    std::vector<std::string> variables;
+    std::vector<range_constraint> constraints;
 
-    // amplitudes
     for (auto &amp_pair : in->amps) {
         char type = amp_pair.first;
-        std::vector<amplitudes> & amps = amp_pair.second;
-        for (amplitudes & amp : amps) {
-            for (size_t k = 0; k < amp.labels.size(); k++) {
-                if ( amp.label_ranges[k].empty() ) {
+        for (amplitudes & amp : amp_pair.second) {
+
+            std::vector<int> labels = range_constraint_labels(amp.labels, amp.label_ranges, variables);
 
-                    std::shared_ptr<pq_string> act (new pq_string(in->vacuum));
-                    std::shared_ptr<pq_string> ext (new pq_string(in->vacuum));
+            // amplitude type+order (ie 't' + '2' = "t2")
+            std::string amptype;
+            amptype.push_back(type);
+            int order = amp.n_create;
+            if (amp.n_annihilate > order) {
+                order = amp.n_annihilate;
+            }
+            amptype += std::to_string(order);
 
-                    act->copy(in.get());
-                    ext->copy(in.get());
+            // is this amplitude in the map? if not, we can assume full ranges are desired
+            auto amp_pos = label_ranges.find(amptype);
+            if ( amp_pos == label_ranges.end() ) continue;
 
-                    act->set_range_everywhere(amp.labels[k], "act");
-                    ext->set_range_everywhere(amp.labels[k], "ext");
+            // get desired ranges for this amplitude from map
+            const std::vector<std::string> & label_range = amp_pos->second;
 
-                    list.push_back(act);
-                    list.push_back(ext);
-                    return false;
-                }
+            // are the number of ranges provided by the user correct?
+            if (label_range.size() != amp.label_ranges.size() ) {
+                printf("\n");
+                printf("    error: something is wrong with the number of ranges for %s\n", amptype.c_str());
+                printf("\n");
+                exit(1);
             }
+
+            range_constraint constraint;
+            constraint.labels = labels;
+            constraint.n_create = amp.n_create;
+            for (size_t k = 0; k < label_range.size(); k++) {
+                size_t half = k < (size_t)amp.n_create ? 0 : 1;
+                if ( label_range[k] == "act" || label_range[k] == "all" ) constraint.max_act[half]++;
+                if ( label_range[k] == "ext" || label_range[k] == "all" ) constraint.max_ext[half]++;
+            }
+            constraints.push_back(constraint);
         }
     }
-
-    // integrals
     for (auto &int_pair : in->ints) {
-        std::string type = int_pair.first;
-        std::vector<integrals> & ints = int_pair.second;
-        for (integrals & integral : ints) {
-        for (size_t k = 0; k < integral.labels.size(); k++) {
-            if ( integral.label_ranges[k].empty() ) {
-
-                std::shared_ptr<pq_string> act (new pq_string(in->vacuum));
-                std::shared_ptr<pq_string> ext (new pq_string(in->vacuum));
+        for (integrals & integral : int_pair.second) {
+            range_constraint_labels(integral.labels, integral.label_ranges, variables);
+        }
+    }
 
-                act->copy(in.get());
-                ext->copy(in.get());
+    // delta functions. a label that appears only in delta functions never receives a range, and
+    // a delta function is forbidden if only one of its labels has one
+    for (delta_functions & delta : in->deltas) {
+        bool has_range[2];
+        for (size_t j = 0; j < 2; j++) {
+            has_range[j] = !delta.label_ranges[j].empty()
+                        || std::find(variables.begin(), variables.end(), delta.labels[j]) != variables.end();
+        }
+        if ( !has_range[0] && !has_range[1] ) continue;
+        if ( has_range[0] != has_range[1] ) return;
 
-                act->set_range_everywhere(integral.labels[k], "act");
-                ext->set_range_everywhere(integral.labels[k], "ext");
+        range_constraint constraint;
+        constraint.labels = range_constraint_labels(delta.labels, delta.label_ranges, variables);
+        constraint.is_delta = true;
+        constraints.push_back(constraint);
+    }
 
-                list.push_back(act);
-                list.push_back(ext);
-                return false;
-            }
+    std::vector<std::vector<size_t> > constraints_for_variable(variables.size());
+    for (size_t c = 0; c < constraints.size(); c++) {
+        for (int label : constraints[c].labels) {
+            if ( label < 0 ) continue;
+            std::vector<size_t> & list_for_label = constraints_for_variable[label];
+            if ( list_for_label.empty() || list_for_label.back() != c ) list_for_label.push_back(c);
         }
     }
-}
 
-    // must be done.
-    return true;
+    // the fixed ranges of the non-summed labels may already rule out a tensor
+    std::vector<char> ranges(variables.size(), 0);
+    for (const range_constraint & constraint : constraints) {
+        if ( !range_constraint_is_satisfiable(constraint, ranges) ) return;
+    }
+
+    assign_ranges(in, 0, variables, constraints, constraints_for_variable, ranges, list);
 }
 
 // reorder four label ranges ... cases to consider: aaba/abaa/baaa -> aaab; baab/abba/baba/bbaa/abab -> aabb; babb/bbab/bbba -> abbb
@@ -607,10 +621,10 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "ext"
             && amps.label_ranges[i4] == "act" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i3];
-            amps.labels[i3] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i3));
+            amps.labels.set(i3, tmp_label);
 
             amps.label_ranges[i3] = "act";
             amps.label_ranges[i4] = "ext";
@@ -622,10 +636,10 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "act"
             && amps.label_ranges[i4] == "act" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i2];
-            amps.labels[i2] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i2));
+            amps.labels.set(i2, tmp_label);
 
             amps.label_ranges[i2] = "act";
             amps.label_ranges[i4] = "ext";
@@ -637,10 +651,10 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "act"
             && amps.label_ranges[i4] == "act" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.label_ranges[i1] = "act";
             amps.label_ranges[i4] = "ext";
@@ -653,10 +667,10 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "act"
             && amps.label_ranges[i4] == "ext" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.label_ranges[i1] = "act";
             amps.label_ranges[i3] = "ext";
@@ -668,10 +682,10 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "ext"
             && amps.label_ranges[i4] == "act" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i2];
-            amps.labels[i2] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i2));
+            amps.labels.set(i2, tmp_label);
 
             amps.label_ranges[i2] = "act";
             amps.label_ranges[i4] = "ext";
@@ -683,10 +697,10 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "ext"
             && amps.label_ranges[i4] == "act" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.label_ranges[i1] = "act";
             amps.label_ranges[i4] = "ext";
@@ -698,18 +712,18 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "act"
             && amps.label_ranges[i4] == "act" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i2];
-            amps.labels[i2] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i2));
+            amps.labels.set(i2, tmp_label);
 
             amps.label_ranges[i2] = "act";
             amps.label_ranges[i4] = "ext";
 
-            tmp_label = amps.labels[i3];
+            tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.label_ranges[i1] = "act";
             amps.label_ranges[i3] = "ext";
@@ -719,10 +733,10 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "act"
             && amps.label_ranges[i4] == "ext" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i2];
-            amps.labels[i2] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i2));
+            amps.labels.set(i2, tmp_label);
 
             amps.label_ranges[i2] = "act";
             amps.label_ranges[i3] = "ext";
@@ -735,10 +749,10 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "ext"
             && amps.label_ranges[i4] == "ext" ) {
 
-            std::string tmp_label = amps.labels[i2];
+            pq_label tmp_label = amps.labels.id(i2);
 
-            amps.labels[i2] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i2, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.label_ranges[i1] = "act";
             amps.label_ranges[i2] = "ext";
@@ -750,10 +764,10 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "act"
             && amps.label_ranges[i4] == "ext" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.label_ranges[i1] = "act";
             amps.label_ranges[i3] = "ext";
@@ -765,10 +779,10 @@ void reorder_four_ranges(amplitudes & amps, int i1, int i2, int i3, int i4, int
             && amps.label_ranges[i3] == "ext"
             && amps.label_ranges[i4] == "act" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.label_ranges[i1] = "act";
             amps.label_ranges[i4] = "ext";
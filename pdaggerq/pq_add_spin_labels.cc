@@ -33,10 +33,10 @@ void reorder_three_spins(amplitudes & amps, int i1, int i2, int i3, int & sign)
             && amps.spin_labels[i2] == "b"
             && amps.spin_labels[i3] == "a" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
             
-            amps.labels[i3] = amps.labels[i2];
-            amps.labels[i2] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i2));
+            amps.labels.set(i2, tmp_label);
             
             amps.spin_labels[i2] = "a";
             amps.spin_labels[i3] = "b";
@@ -47,10 +47,10 @@ void reorder_three_spins(amplitudes & amps, int i1, int i2, int i3, int & sign)
             && amps.spin_labels[i2] == "a" 
             && amps.spin_labels[i3] == "a" ) {
             
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
             
-            amps.labels[i3] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
             
             amps.spin_labels[i1] = "a";
             amps.spin_labels[i3] = "b";
@@ -61,10 +61,10 @@ void reorder_three_spins(amplitudes & amps, int i1, int i2, int i3, int & sign)
             && amps.spin_labels[i2] == "b"
             && amps.spin_labels[i3] == "a" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.spin_labels[i1] = "a";
             amps.spin_labels[i3] = "b";
@@ -75,10 +75,10 @@ void reorder_three_spins(amplitudes & amps, int i1, int i2, int i3, int & sign)
             && amps.spin_labels[i2] == "a"
             && amps.spin_labels[i3] == "b" ) {
 
-            std::string tmp_label = amps.labels[i2];
+            pq_label tmp_label = amps.labels.id(i2);
 
-            amps.labels[i2] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i2, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.spin_labels[i1] = "a";
             amps.spin_labels[i2] = "b";
@@ -98,10 +98,10 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "b"
             && amps.spin_labels[i4] == "a" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i3];
-            amps.labels[i3] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i3));
+            amps.labels.set(i3, tmp_label);
 
             amps.spin_labels[i3] = "a";
             amps.spin_labels[i4] = "b";
@@ -113,10 +113,10 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "a"
             && amps.spin_labels[i4] == "a" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i2];
-            amps.labels[i2] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i2));
+            amps.labels.set(i2, tmp_label);
 
             amps.spin_labels[i2] = "a";
             amps.spin_labels[i4] = "b";
@@ -128,10 +128,10 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "a"
             && amps.spin_labels[i4] == "a" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.spin_labels[i1] = "a";
             amps.spin_labels[i4] = "b";
@@ -144,10 +144,10 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "a"
             && amps.spin_labels[i4] == "b" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.spin_labels[i1] = "a";
             amps.spin_labels[i3] = "b";
@@ -159,10 +159,10 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "b"
             && amps.spin_labels[i4] == "a" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i2];
-            amps.labels[i2] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i2));
+            amps.labels.set(i2, tmp_label);
 
             amps.spin_labels[i2] = "a";
             amps.spin_labels[i4] = "b";
@@ -174,10 +174,10 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "b"
             && amps.spin_labels[i4] == "a" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.spin_labels[i1] = "a";
             amps.spin_labels[i4] = "b";
@@ -189,18 +189,18 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "a"
             && amps.spin_labels[i4] == "a" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i2];
-            amps.labels[i2] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i2));
+            amps.labels.set(i2, tmp_label);
 
             amps.spin_labels[i2] = "a";
             amps.spin_labels[i4] = "b";
 
-            tmp_label = amps.labels[i3];
+            tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.spin_labels[i1] = "a";
             amps.spin_labels[i3] = "b";
@@ -210,10 +210,10 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "a"
             && amps.spin_labels[i4] == "b" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i2];
-            amps.labels[i2] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i2));
+            amps.labels.set(i2, tmp_label);
 
             amps.spin_labels[i2] = "a";
             amps.spin_labels[i3] = "b";
@@ -226,10 +226,10 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "b"
             && amps.spin_labels[i4] == "b" ) {
 
-            std::string tmp_label = amps.labels[i2];
+            pq_label tmp_label = amps.labels.id(i2);
 
-            amps.labels[i2] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i2, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.spin_labels[i1] = "a";
             amps.spin_labels[i2] = "b";
@@ -241,10 +241,10 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "a"
             && amps.spin_labels[i4] == "b" ) {
 
-            std::string tmp_label = amps.labels[i3];
+            pq_label tmp_label = amps.labels.id(i3);
 
-            amps.labels[i3] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i3, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.spin_labels[i1] = "a";
             amps.spin_labels[i3] = "b";
@@ -256,10 +256,10 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
             && amps.spin_labels[i3] == "b"
             && amps.spin_labels[i4] == "a" ) {
 
-            std::string tmp_label = amps.labels[i4];
+            pq_label tmp_label = amps.labels.id(i4);
 
-            amps.labels[i4] = amps.labels[i1];
-            amps.labels[i1] = tmp_label;
+            amps.labels.set(i4, amps.labels.id(i1));
+            amps.labels.set(i1, tmp_label);
 
             amps.spin_labels[i1] = "a";
             amps.spin_labels[i4] = "b";
@@ -270,65 +270,159 @@ void reorder_four_spins(amplitudes & amps, int i1, int i2, int i3, int i4, int &
 
 }
 
-// add spin labels to a string
-bool add_spins(const std::shared_ptr<pq_string>& in, std::vector<std::shared_ptr<pq_string> > &list) {
+// a spin constraint on one tensor: once every label has a spin, the number of alpha labels on the
+// left minus the number of alpha labels on the right must lie in [lo, hi]. labels with a fixed
+// spin are folded into left_a / right_a, and summed labels are listed by variable index
+struct spin_constraint {
+    int left_a = 0;
+    int right_a = 0;
+    std::vector<size_t> left;
+    std::vector<size_t> right;
+    int lo = 0;
+    int hi = 0;
+};
+
+// add a tensor's labels to a spin constraint
+static void add_spin_constraint(const std::vector<std::string> &labels, const std::vector<std::string> &spin_labels,
+                                size_t n_left, size_t n_right, std::vector<std::string> &variables,
+                                std::vector<spin_constraint> &constraints) {
+
+    spin_constraint constraint;
+    for (size_t k = 0; k < n_left + n_right; k++) {
+
+        bool is_left = k < n_left;
+
+        if ( !spin_labels[k].empty() ) {
+            if ( spin_labels[k] == "a" ) {
+                if ( is_left ) constraint.left_a++;
+                else           constraint.right_a++;
+            }
+            continue;
+        }
 
-    if ( in->skip ) return true;
+        // summed labels are numbered in order of first appearance
+        size_t var = std::find(variables.begin(), variables.end(), labels[k]) - variables.begin();
+        if ( var == variables.size() ) variables.push_back(labels[k]);
 
-    bool all_spins_added = false;
+        if ( is_left ) constraint.left.push_back(var);
+        else           constraint.right.push_back(var);
+    }
 
-    // amplitudes
-    for (auto &amp_pair : in->amps) {
-        char type = amp_pair.first;
-        std::vector<amplitudes> & amps = amp_pair.second;
-        for (auto & amp : amps) {
-            for (size_t k = 0; k < amp.labels.size(); k++) {
-                if ( amp.spin_labels[k].empty() ) {
+    // particle conserving: equal numbers of alpha (and beta) labels on each side. particle
+    // non-conserving: the larger side must have at least as many alpha and beta labels
+    int diff = (int)n_left - (int)n_right;
+    constraint.lo = std::min(0, diff);
+    constraint.hi = std::max(0, diff);
+
+    constraints.push_back(constraint);
+}
 
-                    std::shared_ptr<pq_string> sa (new pq_string(in->vacuum));
-                    std::shared_ptr<pq_string> sb (new pq_string(in->vacuum));
+// can a spin constraint still be satisfied, given the spins assigned so far?
+static bool spin_constraint_is_satisfiable(const spin_constraint &constraint, const std::vector<char> &spins) {
 
-                    sa->copy(in.get());
-                    sb->copy(in.get());
+    int left_a = constraint.left_a;
+    int left_free = 0;
+    for (size_t var : constraint.left) {
+        if ( spins[var] == 'a' )    left_a++;
+        else if ( spins[var] == 0 ) left_free++;
+    }
 
-                    sa->set_spin_everywhere(amp.labels[k], "a");
-                    sb->set_spin_everywhere(amp.labels[k], "b");
+    int right_a = constraint.right_a;
+    int right_free = 0;
+    for (size_t var : constraint.right) {
+        if ( spins[var] == 'a' )    right_a++;
+        else if ( spins[var] == 0 ) right_free++;
+    }
 
-                    list.push_back(sa);
-                    list.push_back(sb);
-                    return false;
-                }
+    // range of (left alpha) - (right alpha) over the remaining assignments
+    int min_diff = left_a - right_a - right_free;
+    int max_diff = left_a + left_free - right_a;
+
+    return max_diff >= constraint.lo && min_diff <= constraint.hi;
+}
+
+// assign spins to summed labels, one label at a time, abandoning a branch as soon as one
+// of the tensors that contains the label becomes spin forbidden
+static void assign_spins(const std::shared_ptr<pq_string>& in, size_t var, const std::vector<std::string> &variables,
+                         const std::vector<spin_constraint> &constraints,
+                         const std::vector<std::vector<size_t> > &constraints_for_variable,
+                         std::vector<char> &spins, std::vector<std::shared_ptr<pq_string> > &list) {
+
+    if ( var == variables.size() ) {
+        std::shared_ptr<pq_string> newguy (new pq_string(in->vacuum));
+        newguy->copy(in.get());
+        for (size_t i = 0; i < variables.size(); i++) {
+            newguy->set_spin_everywhere(variables[i], spins[i] == 'a' ? "a" : "b");
+        }
+        list.push_back(newguy);
+        return;
+    }
+
+    for (char spin : {'a', 'b'}) {
+        spins[var] = spin;
+        bool allowed = true;
+        for (size_t c : constraints_for_variable[var]) {
+            if ( !spin_constraint_is_satisfiable(constraints[c], spins) ) {
+                allowed = false;
+                break;
             }
         }
+        if ( allowed ) {
+            assign_spins(in, var + 1, variables, constraints, constraints_for_variable, spins, list);
+        }
     }
+    spins[var] = 0;
+}
 
-    // integrals
-    for (auto &ints_pair : in->ints) {
-        const std::string &type = ints_pair.first;
-        std::vector<integrals> & ints = ints_pair.second;
-        for (auto & integral : ints) {
-            for (size_t k = 0; k < integral.labels.size(); k++) {
-                if ( integral.spin_labels[k].empty() ) {
+// add spin labels to a string
+void add_spins(const std::shared_ptr<pq_string>& in, std::vector<std::shared_ptr<pq_string> > &list) {
 
-                    std::shared_ptr<pq_string> sa (new pq_string(in->vacuum));
-                    std::shared_ptr<pq_string> sb (new pq_string(in->vacuum));
+    if ( in->skip ) return;
 
-                    sa->copy(in.get());
-                    sb->copy(in.get());
+    // summed labels, in the order that they appear in amplitudes and then integrals
+    std::vector<std::string> variables;
+    std::vector<spin_constraint> constraints;
 
-                    sa->set_spin_everywhere(integral.labels[k], "a");
-                    sb->set_spin_everywhere(integral.labels[k], "b");
+    for (auto &amp_pair : in->amps) {
+        for (auto & amp : amp_pair.second) {
+            add_spin_constraint(amp.labels, amp.spin_labels, amp.n_create, amp.n_annihilate, variables, constraints);
+        }
+    }
+    for (auto &ints_pair : in->ints) {
+        for (auto & integral : ints_pair.second) {
+            size_t order = integral.labels.size() / 2;
+            add_spin_constraint(integral.labels, integral.spin_labels, order, order, variables, constraints);
+        }
+    }
 
-                    list.push_back(sa);
-                    list.push_back(sb);
-                    return false;
-                }
-            }
+    // delta functions. a label that appears only in delta functions never receives a spin, and
+    // a delta function is spin forbidden if only one of its labels has one
+    for (auto & delta : in->deltas) {
+        bool has_spin[2];
+        for (size_t j = 0; j < 2; j++) {
+            has_spin[j] = !delta.spin_labels[j].empty()
+                       || std::find(variables.begin(), variables.end(), delta.labels[j]) != variables.end();
+        }
+        if ( !has_spin[0] && !has_spin[1] ) continue;
+        if ( has_spin[0] != has_spin[1] ) return;
+        add_spin_constraint(delta.labels, delta.spin_labels, 1, 1, variables, constraints);
+    }
+
+    std::vector<std::vector<size_t> > constraints_for_variable(variables.size());
+    for (size_t c = 0; c < constraints.size(); c++) {
+        for (size_t var : constraints[c].left)  constraints_for_variable[var].push_back(c);
+        for (size_t var : constraints[c].right) constraints_for_variable[var].push_back(c);
+    }
+
+    // a tensor with no summed labels can be checked once, up front
+    std::vector<char> spins(variables.size(), 0);
+    for (const spin_constraint & constraint : constraints) {
+        if ( constraint.left.empty() && constraint.right.empty() && !spin_constraint_is_satisfiable(constraint, spins) ) {
+            return;
         }
     }
 
-    // must be done.
-    return true;
+    assign_spins(in, 0, variables, constraints, constraints_for_variable, spins, list);
 }
 
 // expand sums to include spin and zero terms where appropriate
@@ -974,143 +1068,14 @@ void spin_blocking(const std::shared_ptr<pq_string>& in, std::vector<std::shared
         }
     }
 
-    // now, expand sums 
-
-    bool done_adding_spins = false;
-    do {
-        std::vector< std::shared_ptr<pq_string> > list;
-        done_adding_spins = true;
-        for (std::shared_ptr<pq_string> & pq_str : tmp) {
-            bool am_i_done = add_spins(pq_str, list);
-            if ( !am_i_done ) done_adding_spins = false;
-        }
-        if ( !done_adding_spins ) {
-            tmp.clear();
-            for (std::shared_ptr<pq_string> & pq_str : list) {
-                if ( !pq_str->skip ) {
-                    tmp.push_back(pq_str);
-                }
-            }
-        }
-    }while(!done_adding_spins);
-
-    // kill terms that have mismatched spin 
-    for (auto & pq_str : tmp) {
-
-        if ( pq_str->skip ) continue;
-
-        bool killit = false;
-
-        // amplitudes
-        for (auto &amp_pair : pq_str->amps) {
-            char type = amp_pair.first;
-            std::vector<amplitudes> & amps = amp_pair.second;
-            for (auto & amp : amps) {
-
-                size_t n_create_a = 0;
-                size_t n_create_b = 0;
-
-                for (size_t l = 0; l < amp.n_create; l++) {
-                    if (amp.spin_labels[l] == "a" ) {
-                        n_create_a++;
-                    }else {
-                        n_create_b++;
-                    }
-                }
-
-                size_t n_annihilate_a = 0;
-                size_t n_annihilate_b = 0;
-
-                for (size_t l = 0; l < amp.n_annihilate; l++) {
-                    if (amp.spin_labels[l + amp.n_create] == "a" ) {
-                        n_annihilate_a++;
-                    }else {
-                        n_annihilate_b++;
-                    }
-                }
-
-                // particle conserving excitations:
-                if (amp.n_create == amp.n_annihilate) {
-                    if (n_create_a != n_annihilate_a || n_create_b != n_annihilate_b ) {
-                        killit = true;
-                        break;
-                    }
-                // particle non-conserving excitations:
-                }else if (amp.n_create > amp.n_annihilate) {
-                    if (n_create_a < n_annihilate_a || n_create_b < n_annihilate_b ) {
-                        killit = true;
-                        break;
-                    }
-                // particle non-conserving excitations:
-                }else if (amp.n_create < amp.n_annihilate) {
-                    if (n_create_a > n_annihilate_a || n_create_b > n_annihilate_b ) {
-                        killit = true;
-                        break;
-                    }
-                }
-
-            }
-            if ( killit ) break;
-        }
-        if ( killit ) {
-            pq_str->skip = true;
-            continue;
-        }
-
-        killit = false;
-
-        // integrals
-        for (auto &ints_pair : pq_str->ints) {
-            const std::string &type = ints_pair.first;
-            std::vector<integrals> & ints = ints_pair.second;
-            for (auto & integral : ints) {
-                size_t order = integral.labels.size() / 2;
-
-                int left_a = 0;
-                int left_b = 0;
-                int right_a = 0;
-                int right_b = 0;
-                for (size_t l = 0; l < order; l++) {
-                    if (integral.spin_labels[l] == "a" ) {
-                        left_a++;
-                    }else {
-                        left_b++;
-                    }
-                    if (integral.spin_labels[l + order] == "a" ) {
-                        right_a++;
-                    }else {
-                        right_b++;
-                    }
-                }
-                if (left_a != right_a || left_b != right_b ) {
-                    killit = true;
-                    break;
-                }
-
-            }
-            if ( killit ) break;
-        }
-        if ( killit ) {
-            pq_str->skip = true;
-            continue;
-        }
-
-        killit = false;
-
-        // delta functions 
-        for (size_t j = 0; j < in->deltas.size(); j++) {
-            if (pq_str->deltas[j].spin_labels[0] != pq_str->deltas[j].spin_labels[1] ) {
-                killit = true;
-                break;
-            }
-        }
-
-        if ( killit ) {
-            pq_str->skip = true;
-            continue;
-        }
+    // now, expand sums. spins are assigned one summed label at a time, so terms with mismatched
+    // spin are discarded as soon as the mismatch appears rather than after full expansion
+    std::vector< std::shared_ptr<pq_string> > list;
+    for (std::shared_ptr<pq_string> & pq_str : tmp) {
+        add_spins(pq_str, list);
     }
-    
+    tmp.swap(list);
+
     // rearrange terms so that they have standard spin order (abba -> -abab, etc.)
     for (auto & pq_str : tmp) {
 
@@ -1142,9 +1107,9 @@ void spin_blocking(const std::shared_ptr<pq_string>& in, std::vector<std::shared
                         amp.spin_labels[0] = "a";
                         amp.spin_labels[1] = "b";
 
-                        std::string tmp_label = amp.labels[0];
-                        amp.labels[0] = amp.labels[1];
-                        amp.labels[1] = tmp_label;
+                        pq_label tmp_label = amp.labels.id(0);
+                        amp.labels.set(0, amp.labels.id(1));
+                        amp.labels.set(1, tmp_label);
 
                         pq_str->sign *= -1;
                     }
@@ -1175,9 +1140,9 @@ void spin_blocking(const std::shared_ptr<pq_string>& in, std::vector<std::shared
                         amp.spin_labels[n_create + 0] = "a";
                         amp.spin_labels[n_create + 1] = "b";
 
-                        std::string tmp_label = amp.labels[n_create + 0];
-                        amp.labels[n_create + 0] = amp.labels[n_create + 1];
-                        amp.labels[n_create + 1] = tmp_label;
+                        pq_label tmp_label = amp.labels.id(n_create + 0);
+                        amp.labels.set(n_create + 0, amp.labels.id(n_create + 1));
+                        amp.labels.set(n_create + 1, tmp_label);
 
                         pq_str->sign *= -1;
                     }
@@ -1218,9 +1183,9 @@ void spin_blocking(const std::shared_ptr<pq_string>& in, std::vector<std::shared
                     && integral.spin_labels[2] == "b"
                     && integral.spin_labels[3] == "a" ) {
 
-                        std::string tmp_label = integral.labels[2];
-                    integral.labels[2] = integral.labels[3];
-                    integral.labels[3] = tmp_label;
+                        pq_label tmp_label = integral.labels.id(2);
+                    integral.labels.set(2, integral.labels.id(3));
+                    integral.labels.set(3, tmp_label);
 
                     integral.spin_labels[2] = "a";
                     integral.spin_labels[3] = "b";
@@ -1232,9 +1197,9 @@ void spin_blocking(const std::shared_ptr<pq_string>& in, std::vector<std::shared
                           && integral.spin_labels[2] == "a"
                           && integral.spin_labels[3] == "b" ) {
 
-                        std::string tmp_label = integral.labels[0];
-                    integral.labels[0] = integral.labels[1];
-                    integral.labels[1] = tmp_label;
+                        pq_label tmp_label = integral.labels.id(0);
+                    integral.labels.set(0, integral.labels.id(1));
+                    integral.labels.set(1, tmp_label);
 
                     integral.spin_labels[0] = "a";
                     integral.spin_labels[1] = "b";
@@ -1246,16 +1211,16 @@ void spin_blocking(const std::shared_ptr<pq_string>& in, std::vector<std::shared
                           && integral.spin_labels[2] == "b"
                           && integral.spin_labels[3] == "a" ) {
 
-                        std::string tmp_label = integral.labels[0];
-                    integral.labels[0] = integral.labels[1];
-                    integral.labels[1] = tmp_label;
+                        pq_label tmp_label = integral.labels.id(0);
+                    integral.labels.set(0, integral.labels.id(1));
+                    integral.labels.set(1, tmp_label);
 
                     integral.spin_labels[0] = "a";
                     integral.spin_labels[1] = "b";
 
-                        tmp_label = integral.labels[2];
-                    integral.labels[2] = integral.labels[3];
-                    integral.labels[3] = tmp_label;
+                        tmp_label = integral.labels.id(2);
+                    integral.labels.set(2, integral.labels.id(3));
+                    integral.labels.set(3, tmp_label);
 
                     integral.spin_labels[2] = "a";
                     integral.spin_labels[3] = "b";
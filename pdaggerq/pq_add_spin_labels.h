@@ -38,8 +38,8 @@
 
 namespace pdaggerq {
 
-/// add spin labels to a string
-bool add_spins(const std::shared_ptr<pq_string>& in, std::vector<std::shared_ptr<pq_string> > &list);
+/// add spin labels to a string, generating every spin assignment for its summed labels that is allowed by its tensors
+void add_spins(const std::shared_ptr<pq_string>& in, std::vector<std::shared_ptr<pq_string> > &list);
 
 /// expand sums to include spin and zero terms where appropriate
 void spin_blocking(const std::shared_ptr<pq_string>& in, std::vector<std::shared_ptr<pq_string> > &spin_blocked, const std::unordered_map<std::string, std::string> &spin_map);
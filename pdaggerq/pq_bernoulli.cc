@@ -250,6 +250,306 @@ void eliminate_operator_portions(std::shared_ptr<pq_string> &in, int bernoulli_e
     }
 }
 
+// an exact fraction, used to build the Bernoulli coefficients so that they match the
+// hand-written values (e.g., 1.0 / 12.0) to the last bit
+struct bernoulli_fraction {
+    int64_t num = 0;
+    int64_t den = 1;
+};
+
+static bernoulli_fraction make_fraction(__int128 num, __int128 den) {
+
+    if ( den < 0 ) {
+        num = -num;
+        den = -den;
+    }
+    __int128 a = num < 0 ? -num : num;
+    __int128 b = den;
+    while ( b != 0 ) {
+        __int128 c = a % b;
+        a = b;
+        b = c;
+    }
+    if ( a > 1 ) {
+        num /= a;
+        den /= a;
+    }
+    if ( num > INT64_MAX || num < -INT64_MAX || den > INT64_MAX ) {
+        printf("\n");
+        printf("    error: Bernoulli coefficients at this order are too large to represent\n");
+        printf("\n");
+        exit(1);
+    }
+    return {(int64_t)num, (int64_t)den};
+}
+
+static bernoulli_fraction operator*(const bernoulli_fraction &a, const bernoulli_fraction &b) {
+    return make_fraction((__int128)a.num * b.num, (__int128)a.den * b.den);
+}
+
+static bernoulli_fraction operator+(const bernoulli_fraction &a, const bernoulli_fraction &b) {
+    return make_fraction((__int128)a.num * b.den + (__int128)b.num * a.den, (__int128)a.den * b.den);
+}
+
+// B_L / L! for L = 0, 1, ..., order (with B_1 = -1/2)
+static std::vector<bernoulli_fraction> bernoulli_over_factorial(int order) {
+
+    // B_m = -1/(m+1) sum_{k<m} binomial(m+1, k) B_k
+    std::vector<bernoulli_fraction> bernoulli = {{1, 1}};
+    for (int m = 1; m <= order; m++) {
+        bernoulli_fraction sum;
+        bernoulli_fraction binomial = {1, 1};
+        for (int k = 0; k < m; k++) {
+            sum = sum + binomial * bernoulli[k];
+            binomial = binomial * make_fraction(m + 1 - k, k + 1);
+        }
+        bernoulli.push_back(sum * make_fraction(-1, m + 1));
+    }
+
+    bernoulli_fraction factorial = {1, 1};
+    for (int m = 1; m <= order; m++) {
+        factorial = factorial * make_fraction(1, m);
+        bernoulli[m] = bernoulli[m] * factorial;
+    }
+    return bernoulli;
+}
+
+// add the commutators for every way of splitting the remaining commutators into segments
+static void add_bernoulli_segments(int remaining, const bernoulli_fraction &coefficient, std::vector<std::string> &portions,
+                                   const std::vector<bernoulli_fraction> &segment_factor, std::vector<bernoulli_commutator> &commutators) {
+
+    if ( remaining == 0 ) {
+
+        // the outermost commutator is never projected
+        portions.back() = "A";
+        double factor = (double)coefficient.num / (double)coefficient.den;
+
+        // a leading segment of length one applies to both V and V_R
+        if ( portions[0] == "A" ) {
+            commutators.push_back({factor, portions});
+            portions[0] = "R";
+            commutators.push_back({factor, portions});
+            portions[0] = "A";
+        }else {
+            commutators.push_back({factor, portions});
+        }
+        return;
+    }
+
+    for (int length = 1; length <= remaining; length++) {
+
+        // odd Bernoulli numbers beyond B_1 vanish
+        if ( segment_factor[length].num == 0 ) continue;
+
+        for (int k = 1; k < length; k++) {
+            portions.push_back("A");
+        }
+        portions.push_back("R");
+
+        add_bernoulli_segments(remaining - length, coefficient * segment_factor[length], portions, segment_factor, commutators);
+
+        portions.resize(portions.size() - length);
+    }
+}
+
+// the nested commutators that make up the Bernoulli expansion at a given order
+std::vector<bernoulli_commutator> get_bernoulli_commutators(int order) {
+
+    std::vector<bernoulli_commutator> commutators;
+    if ( order < 1 ) return commutators;
+
+    std::vector<bernoulli_fraction> bernoulli = bernoulli_over_factorial(order);
+
+    // segments after the first contribute -B_L / L!, with B_1 taken as -1/2
+    std::vector<bernoulli_fraction> segment_factor(order + 1);
+    for (int length = 1; length <= order; length++) {
+        segment_factor[length] = bernoulli[length] * make_fraction(-1, 1);
+    }
+
+    for (int length = 1; length <= order; length++) {
+
+        // the leading segment contributes 1/2 for V and V_R or B_L / L! for V_N
+        bernoulli_fraction coefficient = length == 1 ? segment_factor[1] : bernoulli[length];
+        if ( coefficient.num == 0 ) continue;
+
+        std::vector<std::string> portions;
+        portions.push_back(length == 1 ? "A" : "N");
+        for (int k = 1; k < length; k++) {
+            portions.push_back("A");
+        }
+        portions.push_back("R");
+
+        add_bernoulli_segments(order - length, coefficient, portions, segment_factor, commutators);
+    }
+
+    return commutators;
+}
+
+// is an operator one of those that eliminate_operator_portions looks at (integrals and t amplitudes)?
+static bool is_portion_tensor(const std::string &op) {
+    if ( op.substr(0, 2) == "te" || op.substr(0, 2) == "td" ) {
+        return op.find(',') == std::string::npos;
+    }
+    char c = op.empty() ? ' ' : op[0];
+    return c == 'h' || c == 'H' || c == 'f' || c == 'F' || c == 'g' || c == 'G' || c == 'j' || c == 'J';
+}
+
+// count the legs that an operator offers to the rest of a fully contracted string. index 0 holds
+// excitation-type legs (virtual creators, occupied annihilators) and index 1 holds de-excitation-type
+// legs (occupied creators, virtual annihilators). returns false if they cannot be determined from the
+// operator name alone
+static bool count_operator_legs(std::string op, const std::string &left_operators_type, const std::string &right_operators_type,
+                                int n_create[2], int n_annihilate[2]) {
+
+    removeSpaces(op);
+
+    if ( op.empty() || op == "1" ) return true;
+
+    if ( op.substr(0, 2) == "te" || op.substr(0, 2) == "td" ) {
+        std::string rank = op.substr(2);
+        if ( rank.empty() || rank.find_first_not_of("0123456789") != std::string::npos ) return false;
+        int n = std::stoi(rank);
+        int type = op[1] == 'e' ? 0 : 1;
+        n_create[type] += n;
+        n_annihilate[type] += n;
+        return true;
+    }
+
+    // rn creates virtual and annihilates occupied orbitals, and ln does the opposite. operators
+    // that also carry photons (e.g., r1,1) are left alone
+    if ( op[0] == 'r' || op[0] == 'R' || op[0] == 'l' || op[0] == 'L' ) {
+        std::string rank = op.substr(1);
+        if ( rank.empty() || rank.find_first_not_of("0123456789") != std::string::npos ) return false;
+        int n = std::stoi(rank);
+        if ( n == 0 ) return true;
+
+        bool is_right = op[0] == 'r' || op[0] == 'R';
+        const std::string &type = is_right ? right_operators_type : left_operators_type;
+        int n_occ = n;
+        int n_vir = n;
+        if ( type == "IP" ) n_vir--;
+        if ( type == "DIP" ) n_vir -= 2;
+        if ( type == "EA" ) n_occ--;
+        if ( type == "DEA" ) n_occ -= 2;
+
+        if ( is_right ) {
+            n_create[0] += n_vir;
+            n_annihilate[0] += n_occ;
+        }else {
+            n_create[1] += n_occ;
+            n_annihilate[1] += n_vir;
+        }
+        return true;
+    }
+
+    // en(p,q,...,r,s) creates its first n labels and annihilates its last n
+    if ( (op[0] == 'e' || op[0] == 'E') && op.size() > 3 && op[2] == '(' && op.back() == ')' ) {
+        if ( op[1] < '1' || op[1] > '4' ) return false;
+        int n = op[1] - '0';
+
+        std::vector<std::string> labels;
+        std::string list = op.substr(3, op.size() - 4);
+        size_t pos;
+        while ( (pos = list.find(',')) != std::string::npos ) {
+            labels.push_back(list.substr(0, pos));
+            list.erase(0, pos + 1);
+        }
+        labels.push_back(list);
+        if ( (int)labels.size() != 2 * n ) return false;
+
+        for (int k = 0; k < 2 * n; k++) {
+            bool is_creator = k < n;
+            if ( is_occ(labels[k]) ) {
+                if ( is_creator ) n_create[1]++;
+                else              n_annihilate[0]++;
+            }else if ( is_vir(labels[k]) ) {
+                if ( is_creator ) n_create[0]++;
+                else              n_annihilate[1]++;
+            }else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool is_creator = op.substr(0, 3) == "a*(";
+    bool is_annihilator = op.substr(0, 2) == "a(";
+    if ( (!is_creator && !is_annihilator) || op.back() != ')' ) return false;
+
+    std::string label = op.substr(is_creator ? 3 : 2);
+    label.pop_back();
+
+    if ( is_occ(label) ) {
+        if ( is_creator ) n_create[1]++;
+        else              n_annihilate[0]++;
+    }else if ( is_vir(label) ) {
+        if ( is_creator ) n_create[0]++;
+        else              n_annihilate[1]++;
+    }else {
+        return false;
+    }
+    return true;
+}
+
+// can every term generated by a product of operators be shown to be eliminated by eliminate_operator_portions?
+bool operator_portions_vanish(const std::vector<std::string> &left_operator,
+                              const std::vector<std::string> &ops,
+                              const std::vector<std::string> &right_operator,
+                              const std::string &left_operators_type,
+                              const std::string &right_operators_type,
+                              int bernoulli_excitation_level) {
+
+    if ( ops.empty() ) return false;
+
+    // every operator in the product must carry the same number of portions
+    std::vector<std::vector<std::string> > portions;
+    std::vector<std::string> base_names;
+    for (const std::string & op : ops) {
+        portions.push_back(get_operator_portions_as_vector(op));
+        base_names.push_back(get_operator_base_name(op));
+        if ( portions.back().size() != portions[0].size() ) return false;
+    }
+    size_t n_portions = portions[0].size();
+
+    for (size_t i = 0; i < n_portions; i++) {
+        for (const std::string target_portion : {"N", "R"}) {
+
+            int n_create[2] = {0, 0};
+            int n_annihilate[2] = {0, 0};
+            bool found = false;
+            bool known = true;
+
+            for (size_t k = 0; k < ops.size() && known; k++) {
+                if ( portions[k][i] == target_portion ) {
+                    found = true;
+                    known = is_portion_tensor(base_names[k]);
+                }else {
+                    known = count_operator_legs(base_names[k], left_operators_type, right_operators_type, n_create, n_annihilate);
+                }
+            }
+            for (const std::string & op : left_operator) {
+                if ( known ) known = count_operator_legs(op, left_operators_type, right_operators_type, n_create, n_annihilate);
+            }
+            for (const std::string & op : right_operator) {
+                if ( known ) known = count_operator_legs(op, left_operators_type, right_operators_type, n_create, n_annihilate);
+            }
+            if ( !found || !known ) continue;
+
+            // legs of a single type cannot be contracted with each other, so each one is contracted
+            // with the portion. the portion's unrepeated bra labels then mirror the outside
+            // annihilators, and its labels are either all excitation or all de-excitation like
+            bool has_excitation_legs = n_create[0] + n_annihilate[0] > 0;
+            bool has_deexcitation_legs = n_create[1] + n_annihilate[1] > 0;
+            if ( has_excitation_legs && has_deexcitation_legs ) continue;
+
+            int nt_bra = n_annihilate[0] + n_annihilate[1];
+            std::string portion_type = nt_bra > bernoulli_excitation_level ? "R" : "N";
+            if ( portion_type != target_portion ) return true;
+        }
+    }
+    return false;
+}
+
 // bernoulli expansion involves operator portions. strip these off 
 // and return them as a string
 std::string get_operator_portions_as_string(const std::string& op) {
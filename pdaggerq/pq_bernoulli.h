@@ -56,6 +56,56 @@ std::vector<std::string> get_operator_portions_as_vector(const std::string& op);
  */
 std::string get_operator_base_name(std::string op);
 
+/**
+ *
+ * one nested commutator in the Bernoulli expansion of a similarity-transformed operator,
+ * factor * [[[V_{p0}, sigma]_{p1}, sigma]_{p2} ... , sigma]_{pn}, where each portion is
+ * "N", "R", or "A" (no restriction)
+ *
+ */
+struct bernoulli_commutator {
+    double factor;
+    std::vector<std::string> portions;
+};
+
+/**
+ *
+ * the nested commutators that make up the Bernoulli expansion at a given order. the expansion is
+ * a sum over ways of splitting the n commutators into segments; the R projection closes every
+ * segment but the last, and each segment of length L contributes a factor of B_L / L! (B_L is a
+ * Bernoulli number). a leading segment of length 1 applies to V and V_R, and a longer leading
+ * segment applies to V_N
+ *
+ * @param order: the number of nested commutators
+ * @return: the commutators and their factors
+ *
+ */
+std::vector<bernoulli_commutator> get_bernoulli_commutators(int order);
+
+/**
+ *
+ * can every term generated by a product of operators be shown to be eliminated by
+ * eliminate_operator_portions without bringing the product to normal order (for bernoulli)?
+ * this is the case when, for some portion, the operators outside of that portion are all of
+ * excitation type or all of de-excitation type, which fixes the labels that the portion can
+ * carry in a fully contracted (fermi vacuum) term
+ *
+ * @param left_operator: operators that appear to the left of ops (no portions)
+ * @param ops: the operator product, e.g., {"j2{A,R,A}", "te1{A,R,A}", "td2{A,A,A}"}
+ * @param right_operator: operators that appear to the right of ops (no portions)
+ * @param left_operators_type: the type of the left-hand operators (EE, IP, EA, DIP, DEA), which sets the rank of ln
+ * @param right_operators_type: the type of the right-hand operators (EE, IP, EA, DIP, DEA), which sets the rank of rn
+ * @param bernoulli_excitation_level: the maximum excitation level for "N" type portions
+ * @return: true if the product contributes nothing
+ *
+ */
+bool operator_portions_vanish(const std::vector<std::string> &left_operator,
+                              const std::vector<std::string> &ops,
+                              const std::vector<std::string> &right_operator,
+                              const std::string &left_operators_type,
+                              const std::string &right_operators_type,
+                              int bernoulli_excitation_level);
+
 /// eliminate terms based on operator portions (for bernoulli)
 void eliminate_operator_portions(std::shared_ptr<pq_string> &in, int bernoulli_excitation_level);
 
@@ -30,6 +30,10 @@
 #include <string>
 #include <cctype>
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
@@ -40,8 +44,14 @@
 #include "pq_add_label_ranges.h"
 #include "pq_add_spin_labels.h"
 #include "pq_cumulant_expansion.h"
+#include "pq_pool.h"
+#include "pq_serialize.h"
 #include "../pq_graph/include/pq_graph.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace py = pybind11;
 using namespace pybind11::literals;
 
@@ -49,12 +59,32 @@ namespace pdaggerq {
 
 std::vector<int> empty_list = {};
 
+// read-only view of one column of a pq_term_arrays object. python sees it through the buffer
+// protocol, so numpy.asarray(arrays.factors) does not copy the data
+template <class T>
+struct pq_array_view {
+    const std::vector<T> * data;
+};
+
+template <class T>
+static void export_array_view(py::module& m, const char * name) {
+    py::class_<pq_array_view<T> >(m, name, py::buffer_protocol())
+        .def_buffer([](pq_array_view<T> &self) {
+            return py::buffer_info(const_cast<T *>(self.data->data()), sizeof(T), py::format_descriptor<T>::format(),
+                                   1, {(py::ssize_t)self.data->size()}, {(py::ssize_t)sizeof(T)}, true);
+        })
+        .def("__len__", [](const pq_array_view<T> &self) { return self.data->size(); });
+}
+
 void export_pq_helper(py::module& m) {
+    // calls that can run for a long time release the GIL, so that independent pq_helper objects
+    // can be driven from several python threads at once
     py::class_<pdaggerq::pq_helper, std::shared_ptr<pdaggerq::pq_helper> >(m, "pq_helper")
-        .def(py::init< std::string >())
+        .def(py::init< const std::string &, const std::string & >(), py::arg("vacuum_type") = "", py::arg("engine") = "")
         .def("set_print_level", &pq_helper::set_print_level)
         .def("set_unitary_cc", &pq_helper::set_unitary_cc)
         .def("set_bernoulli_excitation_level", &pq_helper::set_bernoulli_excitation_level)
+        .def("set_prune_operator_portions", &pq_helper::set_prune_operator_portions)
         .def("set_left_operators", &pq_helper::set_left_operators)
         .def("set_right_operators", &pq_helper::set_right_operators)
         .def("set_left_operators_type", &pq_helper::set_left_operators_type)
@@ -62,11 +92,18 @@ void export_pq_helper(py::module& m) {
         .def("get_right_operators_type", &pq_helper::get_right_operators_type)
         .def("get_left_operators_type", &pq_helper::get_left_operators_type)
         .def("set_find_paired_permutations", &pq_helper::set_find_paired_permutations)
-        .def("simplify", &pq_helper::simplify)
+        .def("simplify", &pq_helper::simplify, py::call_guard<py::gil_scoped_release>())
         .def("clear", &pq_helper::clear)
-        .def("clone", &pq_helper::clone)
-        .def("save", &pq_helper::serialize)
-        .def("load", &pq_helper::deserialize)
+        .def("clone", &pq_helper::clone, py::call_guard<py::gil_scoped_release>())
+        .def("set_cache_directory", &pq_helper::set_cache_directory)
+        .def("save", &pq_helper::serialize, py::call_guard<py::gil_scoped_release>())
+        .def("load",
+            [](pq_helper& self, const std::string &filename, const std::unordered_map<std::string, std::string> &spin_labels) {
+                if ( spin_labels.empty() ) self.deserialize(filename);
+                else self.deserialize(filename, spin_labels);
+            },
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("filename"), py::arg("spin_labels") = std::unordered_map<std::string, std::string>() )
         .def("set_use_rdms",
             [](pq_helper& self, const bool & do_use_rdms, const std::vector<int> & ignore_cumulant) {
                 return self.set_use_rdms(do_use_rdms, ignore_cumulant);
@@ -103,36 +140,75 @@ void export_pq_helper(py::module& m) {
                 } else return self.strings();
 
             },
+            py::call_guard<py::gil_scoped_release>(),
             py::arg("spin_labels") = std::unordered_map<std::string, std::string>{{"DUMMY",""}},
             py::arg("label_ranges") = std::unordered_map<std::string, std::vector<std::string>>{{"DUMMY",{""}}} )
         .def("block_by_spin",
             [](pq_helper& self, const std::unordered_map<std::string, std::string> &spin_labels) {
                 self.block_by_spin(spin_labels);
             },
+            py::call_guard<py::gil_scoped_release>(),
             py::arg("spin_labels") = std::unordered_map<std::string, std::string>() )
         .def("block_by_range",
             [](pq_helper& self, const std::unordered_map<std::string, std::vector<std::string> > &label_ranges) {
                 self.block_by_range(label_ranges);
             },
+            py::call_guard<py::gil_scoped_release>(),
             py::arg("spin_labels") = std::unordered_map<std::string, std::string>() )
         .def("add_st_operator",
             [](pq_helper& self, double factor, 
                                 const std::vector<std::string> &targets, 
                                 const std::vector<std::string> &ops, 
-                                bool do_operators_commute) {
-                return self.add_st_operator(factor, targets, ops, do_operators_commute);
+                                bool do_operators_commute,
+                                bool connected_only) {
+                return self.add_st_operator(factor, targets, ops, do_operators_commute, connected_only);
             },
-            py::arg("factor"), py::arg("targets"), py::arg("ops"), py::arg("do_operators_commute") = true )
-        .def("get_st_operator_terms", &pq_helper::get_st_operator_terms)
-        .def("add_bernoulli_operator", &pq_helper::add_bernoulli_operator)
-        .def("add_anticommutator", &pq_helper::add_anticommutator)
-        .def("add_commutator", &pq_helper::add_commutator)
-        .def("add_double_commutator", &pq_helper::add_double_commutator)
-        .def("add_triple_commutator", &pq_helper::add_triple_commutator)
-        .def("add_quadruple_commutator", &pq_helper::add_quadruple_commutator)
-        .def("add_quintuple_commutator", &pq_helper::add_quintuple_commutator)
-        .def("add_hextuple_commutator", &pq_helper::add_hextuple_commutator)
-        .def("add_operator_product", &pq_helper::add_operator_product);
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("factor"), py::arg("targets"), py::arg("ops"), py::arg("do_operators_commute") = true,
+            py::arg("connected_only") = false )
+        .def("get_st_operator_terms", &pq_helper::get_st_operator_terms,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("factor"), py::arg("targets"), py::arg("ops"), py::arg("do_operators_commute") = true,
+            py::arg("connected_only") = false )
+        .def("add_bernoulli_operator", &pq_helper::add_bernoulli_operator, py::call_guard<py::gil_scoped_release>())
+        .def("add_anticommutator", &pq_helper::add_anticommutator, py::call_guard<py::gil_scoped_release>())
+        .def("add_commutator", &pq_helper::add_commutator, py::call_guard<py::gil_scoped_release>())
+        .def("add_double_commutator", &pq_helper::add_double_commutator, py::call_guard<py::gil_scoped_release>())
+        .def("add_triple_commutator", &pq_helper::add_triple_commutator, py::call_guard<py::gil_scoped_release>())
+        .def("add_quadruple_commutator", &pq_helper::add_quadruple_commutator, py::call_guard<py::gil_scoped_release>())
+        .def("add_quintuple_commutator", &pq_helper::add_quintuple_commutator, py::call_guard<py::gil_scoped_release>())
+        .def("add_hextuple_commutator", &pq_helper::add_hextuple_commutator, py::call_guard<py::gil_scoped_release>())
+        .def("add_nested_commutator", &pq_helper::add_nested_commutator, py::call_guard<py::gil_scoped_release>())
+        .def("add_operator_product", &pq_helper::add_operator_product, py::call_guard<py::gil_scoped_release>())
+        .def("term_arrays", &pq_helper::term_arrays, py::call_guard<py::gil_scoped_release>());
+
+    export_array_view<double>(m, "pq_array_float64");
+    export_array_view<int64_t>(m, "pq_array_int64");
+    export_array_view<int32_t>(m, "pq_array_int32");
+    export_array_view<uint32_t>(m, "pq_array_uint32");
+
+    // each column keeps the pq_term_arrays object that owns it alive
+    py::class_<pq_term_arrays, std::shared_ptr<pq_term_arrays> >(m, "pq_term_arrays")
+        .def_property_readonly("factors", [](const pq_term_arrays &self) { return pq_array_view<double>{&self.factors}; }, py::keep_alive<0, 1>())
+        .def_property_readonly("tensor_offsets", [](const pq_term_arrays &self) { return pq_array_view<int64_t>{&self.tensor_offsets}; }, py::keep_alive<0, 1>())
+        .def_property_readonly("permutation_offsets", [](const pq_term_arrays &self) { return pq_array_view<int64_t>{&self.permutation_offsets}; }, py::keep_alive<0, 1>())
+        .def_property_readonly("tensor_types", [](const pq_term_arrays &self) { return pq_array_view<int32_t>{&self.tensor_types}; }, py::keep_alive<0, 1>())
+        .def_property_readonly("label_offsets", [](const pq_term_arrays &self) { return pq_array_view<int64_t>{&self.label_offsets}; }, py::keep_alive<0, 1>())
+        .def_property_readonly("labels", [](const pq_term_arrays &self) { return pq_array_view<uint32_t>{&self.labels}; }, py::keep_alive<0, 1>())
+        .def_property_readonly("label_blocks", [](const pq_term_arrays &self) { return pq_array_view<int32_t>{&self.label_blocks}; }, py::keep_alive<0, 1>())
+        .def_property_readonly("permutation_types", [](const pq_term_arrays &self) { return pq_array_view<int32_t>{&self.permutation_types}; }, py::keep_alive<0, 1>())
+        .def_property_readonly("permutation_label_offsets", [](const pq_term_arrays &self) { return pq_array_view<int64_t>{&self.permutation_label_offsets}; }, py::keep_alive<0, 1>())
+        .def_property_readonly("permutation_labels", [](const pq_term_arrays &self) { return pq_array_view<uint32_t>{&self.permutation_labels}; }, py::keep_alive<0, 1>())
+        .def_readonly("tensor_names", &pq_term_arrays::tensor_names)
+        .def_readonly("block_names", &pq_term_arrays::block_names)
+        .def("label_names",
+            [](const pq_term_arrays &self) {
+                std::map<uint32_t, std::string> names;
+                for (pq_label id : self.labels) names.emplace(id, label_name(id));
+                for (pq_label id : self.permutation_labels) names.emplace(id, label_name(id));
+                return names;
+            })
+        .def("__len__", [](const pq_term_arrays &self) { return self.factors.size(); });
 
     //py::class_<pdaggerq::pq_operator_terms, std::shared_ptr<pdaggerq::pq_operator_terms> >(m, "pq_operator_terms")
     //    .def(py::init< double, std::vector<std::string> >())
@@ -143,6 +219,19 @@ void export_pq_helper(py::module& m) {
         .def("factor", &pq_operator_terms::get_factor)
         .def("operators", &pq_operator_terms::get_operators);
 
+    // counters for strings created while bringing operators to normal order. they are summed over
+    // every thread (and every pq_helper) in the process
+    m.def("allocation_counts", []() {
+        pq_allocation_counts counts = allocation_counts();
+        return std::map<std::string, size_t>{
+            {"transient_strings", counts.transient_strings},
+            {"copied_strings", counts.copied_strings},
+            {"pool_chunks", counts.pool_chunks},
+            {"promoted_strings", counts.promoted_strings}
+        };
+    });
+    m.def("reset_allocation_counts", &reset_allocation_counts);
+
     // add pq graph class for optimizing, visualizing, and generating code from pq_helper
     PQGraph::export_pq_graph(m);
 }
@@ -152,7 +241,7 @@ PYBIND11_MODULE(_pdaggerq, m) {
     export_pq_helper(m);
 }
 
-pq_helper::pq_helper(const std::string &vacuum_type)
+pq_helper::pq_helper(const std::string &vacuum_type, const std::string &engine_type)
 {
 
     if ( vacuum_type.empty() ) {
@@ -168,6 +257,23 @@ pq_helper::pq_helper(const std::string &vacuum_type)
         exit(1);
     }
 
+    if ( engine_type.empty() || engine_type == "SWAP" || engine_type == "swap" ) {
+        engine = "SWAP";
+    }else if ( engine_type == "WICK" || engine_type == "wick" ) {
+        if ( vacuum != "FERMI" ) {
+            printf("\n");
+            printf("    error: the wick engine is only available for the fermi vacuum\n");
+            printf("\n");
+            exit(1);
+        }
+        engine = "WICK";
+    }else {
+        printf("\n");
+        printf("    error: invalid engine (%s)\n", engine_type.c_str());
+        printf("\n");
+        exit(1);
+    }
+
     use_rdms = false;
 
     print_level = 0;
@@ -178,6 +284,9 @@ pq_helper::pq_helper(const std::string &vacuum_type)
     // default maximum excitation order for "N" type operators in Bernoulli expansion for UCC
     bernoulli_excitation_level = 2;
 
+    // skip operator products whose Bernoulli portions rule out every term before normal ordering them
+    prune_operator_portions = true;
+
     // by default, do not look for paired permutations (until parsers catch up)
     find_paired_permutations = false;
 
@@ -193,6 +302,7 @@ pq_helper::pq_helper(const pq_helper &other) {
 
     // copy data
     this->vacuum                    = other.vacuum;
+    this->engine                    = other.engine;
     this->print_level               = other.print_level;
     this->use_rdms                  = other.use_rdms;
     this->ignore_cumulant_rdms      = other.ignore_cumulant_rdms;
@@ -201,6 +311,15 @@ pq_helper::pq_helper(const pq_helper &other) {
     this->right_operators_type      = other.right_operators_type;
     this->left_operators_type       = other.left_operators_type;
     this->find_paired_permutations  = other.find_paired_permutations;
+    this->bernoulli_excitation_level = other.bernoulli_excitation_level;
+    this->prune_operator_portions   = other.prune_operator_portions;
+    this->pruned_excitation_level   = other.pruned_excitation_level;
+    this->is_spin_blocked           = other.is_spin_blocked;
+    this->is_range_blocked          = other.is_range_blocked;
+    this->pending_products          = other.pending_products;
+    this->cache_directory           = other.cache_directory;
+    this->cache_history             = other.cache_history;
+    this->cache_history_valid       = other.cache_history_valid;
 
     // deep copy pointers to pq_strings
     ordered.clear();
@@ -287,15 +406,61 @@ void pq_helper::set_unitary_cc(bool is_unitary) {
 
 // is the cluster operator antihermitian for ucc? default false
 void pq_helper::set_bernoulli_excitation_level(int excitation_level) {
+    // strings that were pruned with another level would not match what simplify() eliminates
+    if ( pruned_excitation_level >= 0 && excitation_level != pruned_excitation_level ) {
+        throw std::runtime_error("the bernoulli excitation level cannot change after bernoulli operators were pruned with level "
+                                 + std::to_string(pruned_excitation_level) + "; call simplify() first, set the level before "
+                                 "adding the operators, or disable set_prune_operator_portions");
+    }
     bernoulli_excitation_level = excitation_level;
 }
 
+// skip bernoulli operator products that operator_portions_vanish rules out? default true
+void pq_helper::set_prune_operator_portions(bool do_prune) {
+    prune_operator_portions = do_prune;
+}
+
+// identical operator products from an expansion are combined, and products whose factors cancel
+// are dropped, so each distinct product is brought to normal order only once. the first
+// occurrence of each product sets its position in the list
+static std::vector<pq_operator_terms> merge_operator_terms(const std::vector<pq_operator_terms> &terms) {
+
+    std::vector<pq_operator_terms> merged;
+    std::vector<double> largest;
+    std::unordered_map<std::string, size_t> position;
+
+    for (const pq_operator_terms & term : terms) {
+        std::string key = std::to_string(term.n_connected_targets);
+        for (const std::string & op : term.operators) {
+            key += '\n';
+            key += op;
+        }
+        auto it = position.find(key);
+        if ( it == position.end() ) {
+            position.emplace(key, merged.size());
+            merged.push_back(term);
+            largest.push_back(fabs(term.factor));
+        }else {
+            merged[it->second].factor += term.factor;
+            largest[it->second] = std::max(largest[it->second], fabs(term.factor));
+        }
+    }
+
+    std::vector<pq_operator_terms> kept;
+    kept.reserve(merged.size());
+    for (size_t i = 0; i < merged.size(); i++) {
+        if ( fabs(merged[i].factor) <= 1e-12 * largest[i] ) continue;
+        kept.push_back(merged[i]);
+    }
+    return kept;
+}
+
 void pq_helper::add_anticommutator(double factor,
                                    const std::vector<std::string> &op0,
                                    const std::vector<std::string> &op1){
 
-    add_operator_product(factor, concatinate_operators({op0, op1}) );
-    add_operator_product(factor, concatinate_operators({op1, op0}) );
+    add_operator_products({pq_operator_terms(factor, concatinate_operators({op0, op1})),
+                           pq_operator_terms(factor, concatinate_operators({op1, op0}))});
 
 }
 
@@ -304,9 +469,7 @@ void pq_helper::add_commutator(double factor,
                                const std::vector<std::string> &op1){
 
     std::vector<pq_operator_terms> ops = get_commutator_terms(factor, op0, op1);
-    for (auto op : ops){
-        add_operator_product(op.factor, op.operators);
-    }
+    add_operator_products(ops);
 }
 
 std::vector<pq_operator_terms> pq_helper::get_commutator_terms(double factor,
@@ -327,9 +490,7 @@ void pq_helper::add_double_commutator(double factor,
                                       const std::vector<std::string> &op2){
 
     std::vector<pq_operator_terms> ops = get_double_commutator_terms(factor, op0, op1, op2);
-    for (auto op : ops){
-        add_operator_product(op.factor, op.operators);
-    }
+    add_operator_products(ops);
 }
 
 std::vector<pq_operator_terms> pq_helper::get_double_commutator_terms(double factor,
@@ -354,9 +515,7 @@ void pq_helper::add_triple_commutator(double factor,
                                         const std::vector<std::string> &op3){
 
     std::vector<pq_operator_terms> ops = get_triple_commutator_terms(factor, op0, op1, op2, op3);
-    for (auto op : ops){
-        add_operator_product(op.factor, op.operators);
-    }
+    add_operator_products(ops);
 }
 
 std::vector<pq_operator_terms> pq_helper::get_triple_commutator_terms(double factor,
@@ -387,9 +546,7 @@ void pq_helper::add_quadruple_commutator(double factor,
                                          const std::vector<std::string> &op4){
 
     std::vector<pq_operator_terms> ops = get_quadruple_commutator_terms(factor, op0, op1, op2, op3, op4);
-    for (auto op : ops){
-        add_operator_product(op.factor, op.operators);
-    }
+    add_operator_products(ops);
 }
 
 std::vector<pq_operator_terms> pq_helper::get_quadruple_commutator_terms(double factor,
@@ -476,9 +633,7 @@ void pq_helper::add_quintuple_commutator(double factor,
                                          const std::vector<std::string> &op5){
 
     std::vector<pq_operator_terms> ops = get_quintuple_commutator_terms(factor, op0, op1, op2, op3, op4, op5);
-    for (auto op : ops){
-        add_operator_product(op.factor, op.operators);
-    }
+    add_operator_products(ops);
 }
 
 std::vector<pq_operator_terms> pq_helper::get_hextuple_commutator_terms(double factor,
@@ -560,6 +715,38 @@ std::vector<pq_operator_terms> pq_helper::get_hextuple_commutator_terms(double f
     return ops;  
 }
 
+std::vector<pq_operator_terms> pq_helper::get_nested_commutator_terms(double factor,
+                                                                      const std::vector<std::vector<std::string> > &ops){
+
+    std::vector<pq_operator_terms> terms;
+    if ( ops.empty() ) return terms;
+
+    terms.push_back(pq_operator_terms(factor, ops[0]));
+
+    // [X, op] = X op - op X, applied once per level
+    for (size_t level = 1; level < ops.size(); level++) {
+        size_t n = terms.size();
+        for (size_t i = 0; i < n; i++) {
+            terms.push_back(pq_operator_terms(-terms[i].factor, concatinate_operators({ops[level], terms[i].operators})));
+            terms[i].operators = concatinate_operators({terms[i].operators, ops[level]});
+        }
+    }
+
+    return terms;
+}
+
+void pq_helper::add_nested_commutator(double factor, const std::vector<std::vector<std::string> > &ops){
+
+    if ( ops.size() < 2 ) {
+        printf("\n");
+        printf("    error: a nested commutator requires at least two operators\n");
+        printf("\n");
+        exit(1);
+    }
+
+    add_operator_products(merge_operator_terms(get_nested_commutator_terms(factor, ops)));
+}
+
 void pq_helper::add_hextuple_commutator(double factor,
                                         const std::vector<std::string> &op0,
                                         const std::vector<std::string> &op1,
@@ -570,16 +757,61 @@ void pq_helper::add_hextuple_commutator(double factor,
                                         const std::vector<std::string> &op6){
 
     std::vector<pq_operator_terms> ops = get_hextuple_commutator_terms(factor, op0, op1, op2, op3, op4, op5, op6);
-    for (auto op : ops){
-        add_operator_product(op.factor, op.operators);
-    }
+    add_operator_products(ops);
 }
 
 // add a string of operators
 void pq_helper::add_operator_product(double factor, std::vector<std::string>  in){
+    add_operator_products({pq_operator_terms(factor, in)});
+}
+
+// add a sum of operator products
+void pq_helper::add_operator_products(const std::vector<pq_operator_terms> &terms){
 
-    // check if there is a fluctuation potential operator 
-    // that needs to be split into multiple terms
+    // without a cache directory nothing is recorded, so the history no longer describes the strings
+    if ( cache_directory.empty() ) {
+        cache_history.clear();
+        cache_history_valid = false;
+        generate_operator_products(terms);
+        return;
+    }
+
+    // record the products and the settings that affect them (for the cache key)
+    std::ostringstream description;
+    description.precision(17);
+    description << "add " << left_operators_type << " " << right_operators_type << " "
+                << is_unitary_cc << find_paired_permutations << "\n";
+    for (const auto * operators : {&left_operators, &right_operators}) {
+        for (const std::vector<std::string> & product : *operators) {
+            description << "  |";
+            for (const std::string & op : product) description << " " << op;
+            description << "\n";
+        }
+        description << "  ;\n";
+    }
+    for (const pq_operator_terms & term : terms) {
+        description << "  " << term.factor;
+        for (const std::string & op : term.operators) description << " " << op;
+        if ( term.n_connected_targets > 0 ) description << " ; connected " << term.n_connected_targets;
+        description << "\n";
+    }
+    cache_history += description.str();
+
+    // with a cache directory, normal ordering waits for simplify(), which may not need it
+    if ( cache_history_valid ) {
+        pending_products.push_back({terms, left_operators, right_operators, left_operators_type,
+                                    right_operators_type, is_unitary_cc, find_paired_permutations});
+        return;
+    }
+
+    generate_operator_products(terms);
+}
+
+// the products are expanded serially, and the strings for each (left operator, product, right
+// operator) combination are then built and brought to normal order in parallel. each combination
+// fills its own list, and the lists are appended to ordered in the same order that a serial loop
+// would produce
+void pq_helper::generate_operator_products(const std::vector<pq_operator_terms> &terms){
 
     // left operators 
     // this is not handled correctly now that left operators can be sums of products of operators ... just exit with an error
@@ -627,6 +859,107 @@ void pq_helper::add_operator_product(double factor, std::vector<std::string>  in
         tmp.clear();
     }
 
+    // if unitary cc, t can't show up in right or left operator lists (yet)
+    if ( is_unitary_cc ) {
+        for (size_t i = 0; i < left_operators.size(); i++) {
+            for (size_t j = 0; j < left_operators[i].size(); j++) {
+                if ( left_operators[i][j].substr(0,1) == "t" || left_operators[i][j].substr(0,1) == "T" ||
+                     left_operators[i][j].substr(0,2) == "t{" || left_operators[i][j].substr(0,2) == "T{" ){
+
+                    printf("\n");
+                    printf("    error: unitary cluster operators cannot appear in the bra state\n");
+                    printf("\n");
+                    exit(1);
+
+                }
+            }
+        }
+        for (size_t i = 0; i < right_operators.size(); i++) {
+            for (size_t j = 0; j < right_operators[i].size(); j++) {
+                if ( right_operators[i][j].substr(0,1) == "t" || right_operators[i][j].substr(0,1) == "T" ||
+                     right_operators[i][j].substr(0,2) == "t{" || right_operators[i][j].substr(0,2) == "T{" ){
+
+                    printf("\n");
+                    printf("    error: unitary cluster operators cannot appear in the ket state\n");
+                    printf("\n");
+                    exit(1);
+
+                }
+            }
+        }
+    }
+
+    if ( (int)left_operators.size() == 0 ) {
+        std::vector<std::string> junk;
+        junk.emplace_back("1");
+        left_operators.push_back(junk);
+    }
+    if ( (int)right_operators.size() == 0 ) {
+        std::vector<std::string> junk;
+        junk.emplace_back("1");
+        right_operators.push_back(junk);
+    }
+
+    // split fluctuation potential and cluster operators
+    std::vector<pq_operator_terms> products;
+    for (const pq_operator_terms & term : terms) {
+        size_t first = products.size();
+        expand_operator_product(term.factor, term.operators, products);
+        for (size_t i = first; i < products.size(); i++) {
+            products[i].n_connected_targets = term.n_connected_targets;
+        }
+    }
+
+    // bernoulli products are pruned with the current excitation level, so simplify() must use the same one
+    if ( vacuum == "FERMI" && prune_operator_portions ) {
+        for (const pq_operator_terms & product : products) {
+            if ( product.operators.empty() || get_operator_portions_as_vector(product.operators[0]).empty() ) continue;
+            pruned_excitation_level = bernoulli_excitation_level;
+            break;
+        }
+    }
+
+    size_t n_left = left_operators.size();
+    size_t n_right = right_operators.size();
+    size_t n_tasks = products.size() * n_left * n_right;
+
+    std::vector< std::vector< std::shared_ptr<pq_string> > > lists(n_tasks);
+
+    // output from print_level > 0 is only readable if strings are processed one at a time. with
+    // fewer combinations than threads, the combinations are built one at a time so that the loops
+    // over their strings (which would be nested, and serial, in this region) get every thread
+    size_t n_threads = 1;
+#ifdef _OPENMP
+    n_threads = (size_t)omp_get_max_threads();
+#endif
+    #pragma omp parallel for schedule(dynamic) if(print_level == 0 && n_tasks > 1 && n_tasks >= n_threads)
+    for (size_t task = 0; task < n_tasks; task++) {
+        size_t product = task / (n_left * n_right);
+        size_t left    = (task / n_right) % n_left;
+        size_t right   = task % n_right;
+        add_operator_product_to_list(products[product].factor, left_operators[left], products[product].operators, right_operators[right],
+                                     products[product].n_connected_targets, lists[task]);
+    }
+
+    std::vector< std::shared_ptr<pq_string> > added;
+    for (const std::vector< std::shared_ptr<pq_string> > & list : lists) {
+        for (const std::shared_ptr<pq_string> & pq_str : list) {
+            added.push_back(pq_str);
+        }
+    }
+
+    // strings are consolidated as they are added for the true vacuum. strings added earlier are
+    // consolidated with these by simplify()
+    if ( vacuum == "TRUE" ) {
+        alphabetize(added);
+        cleanup(added, find_paired_permutations);
+    }
+    ordered.insert(ordered.end(), added.begin(), added.end());
+}
+
+// split fluctuation potential and cluster operators in a product of operators
+void pq_helper::expand_operator_product(double factor, std::vector<std::string> in, std::vector<pq_operator_terms> &products){
+
     int count = 0;
     bool found_v = false;
     std::vector<std::string> tmp_in;
@@ -657,7 +990,7 @@ void pq_helper::add_operator_product(double factor, std::vector<std::string>  in
         for (const auto & op : tmp_in) {
             in.push_back(op);
         }
-        add_operator_product(factor, in);
+        expand_operator_product(factor, in, products);
 
         // term 2
         in.clear();
@@ -669,42 +1002,11 @@ void pq_helper::add_operator_product(double factor, std::vector<std::string>  in
         for (int i = count + 1; i < (int)tmp_in.size(); i++) {
             in.push_back(tmp_in[i]);
         }
-        add_operator_product(factor, in);
+        expand_operator_product(factor, in, products);
         
         return;
     }
 
-    // now check for t and add de-excitation operators if doing unitary cc
-    // first, if unitary cc, t can't show up in right or left operator lists (yet)
-    if ( is_unitary_cc ) {
-        for (size_t i = 0; i < left_operators.size(); i++) {
-            for (size_t j = 0; j < left_operators[i].size(); j++) {
-                if ( left_operators[i][j].substr(0,1) == "t" || left_operators[i][j].substr(0,1) == "T" ||
-                     left_operators[i][j].substr(0,2) == "t{" || left_operators[i][j].substr(0,2) == "T{" ){
-
-                    printf("\n");
-                    printf("    error: unitary cluster operators cannot appear in the bra state\n");
-                    printf("\n");
-                    exit(1);
-
-                }
-            }
-        }
-        for (size_t i = 0; i < right_operators.size(); i++) {
-            for (size_t j = 0; j < right_operators[i].size(); j++) {
-                if ( right_operators[i][j].substr(0,1) == "t" || right_operators[i][j].substr(0,1) == "T" ||
-                     right_operators[i][j].substr(0,2) == "t{" || right_operators[i][j].substr(0,2) == "T{" ){
-
-                    printf("\n");
-                    printf("    error: unitary cluster operators cannot appear in the ket state\n");
-                    printf("\n");
-                    exit(1);
-
-                }
-            }
-        }
-    }
-
     // now either rename cluster operators or split them into two, depending on whether we're unitary or not
     count = 0;
     bool found_t = false;
@@ -726,628 +1028,762 @@ void pq_helper::add_operator_product(double factor, std::vector<std::string>  in
         // term 1 (excitation)
 
         in[count].insert(1, "e", 1);
-        add_operator_product(factor, in);
+        expand_operator_product(factor, in, products);
 
         // term 2 (de-excitation)
         if ( is_unitary_cc ) {
 
             in[count][1] = 'd';
-            add_operator_product(-factor, in);
+            expand_operator_product(-factor, in, products);
         }
         return;
     }
 
-    // apply any extra operators on left or right:
-    std::vector<std::string> save;
-    for (const std::string & op : in) {
-        save.push_back(op);
+    products.emplace_back(factor, in);
+}
+
+// build a string from a product of operators and bring it to normal order
+void pq_helper::add_operator_product_to_list(double factor,
+                                             const std::vector<std::string> &left_operator,
+                                             const std::vector<std::string> &save,
+                                             const std::vector<std::string> &right_operator,
+                                             size_t n_connected_targets,
+                                             std::vector<std::shared_ptr<pq_string> > &list) const {
+
+    // skip products whose bernoulli operator portions already rule out every fully contracted term
+    if ( vacuum == "FERMI" && prune_operator_portions &&
+         operator_portions_vanish(left_operator, save, right_operator, left_operators_type, right_operators_type, bernoulli_excitation_level) ) {
+        return;
     }
 
-    if ( (int)left_operators.size() == 0 ) {
-        std::vector<std::string> junk;
-        junk.emplace_back("1");
-        left_operators.push_back(junk);
+    std::shared_ptr<pq_string> newguy (new pq_string(vacuum));
+
+    std::vector<std::string> tmp_string;
+
+    bool has_w0       = false;
+
+    int occ_label_count = 0;
+    int vir_label_count = 0;
+    int gen_label_count = 0;
+
+    // apply any extra operators on left or right:
+    std::vector<std::string> tmp = left_operator;
+    for (const std::string & op : save) {
+        tmp.push_back(op);
     }
-    if ( (int)right_operators.size() == 0 ) {
-        std::vector<std::string> junk;
-        junk.emplace_back("1");
-        right_operators.push_back(junk);
+    for (const std::string & op : right_operator) {
+        tmp.push_back(op);
     }
 
-    // build strings
-    double original_factor = factor;
-
-    for (std::vector<std::string> & left_operator : left_operators) {
-        for (std::vector<std::string> & right_operator : right_operators) {
+    // which operator each entry in tmp_string comes from: 0 for the first n_connected_targets
+    // operators in save, 1, 2, ... for the remaining operators in save, and -1 otherwise
+    std::vector<int> vertex_of;
+    int vertex = -1;
+    size_t n_left = left_operator.size();
 
-            std::shared_ptr<pq_string> newguy (new pq_string(vacuum));
+    for (size_t position = 0; position < tmp.size(); position++) {
 
-            factor = original_factor;
+        std::string & op_including_portions = tmp[position];
 
-            std::vector<std::string> tmp_string;
+        vertex_of.resize(tmp_string.size(), vertex);
+        vertex = -1;
+        if ( position >= n_left && position < n_left + save.size() ) {
+            vertex = position < n_left + n_connected_targets ? 0 : (int)(position - n_left - n_connected_targets) + 1;
+        }
 
-            bool has_w0       = false;
+        // bernoulli expansion requires operator portion specification. split into base name and portion
+        std::string op = get_operator_base_name(op_including_portions);
+        std::vector<std::string> op_portions = get_operator_portions_as_vector(op_including_portions);
 
-            int occ_label_count = 0;
-            int vir_label_count = 0;
-            int gen_label_count = 0;
+        // blank string
+        if ( op.empty() ) continue;
 
-            // apply any extra operators on left or right:
-            std::vector<std::string> tmp = left_operator;
-            for (const std::string & op : save) {
-                tmp.push_back(op);
-            }
-            for (const std::string & op : right_operator) {
-                tmp.push_back(op);
-            }
+        // Stephen: removed so that we can distinguish lower- and uppercase indices
+        // lowercase indices
+        // std::transform(op.begin(), op.end(), op.begin(), [](unsigned char c){ return std::tolower(c); });
 
-            for (std::string & op_including_portions : tmp) {
+        // remove spaces
+        removeSpaces(op);
 
-                // bernoulli expansion requires operator portion specification. split into base name and portion
-                std::string op = get_operator_base_name(op_including_portions);
-                std::vector<std::string> op_portions = get_operator_portions_as_vector(op_including_portions);
-                
-                // blank string
-                if ( op.empty() ) continue;
+        // remove parentheses
+        removeParentheses(op);
 
-                // Stephen: removed so that we can distinguish lower- and uppercase indices
-                // lowercase indices
-                // std::transform(op.begin(), op.end(), op.begin(), [](unsigned char c){ return std::tolower(c); });
+        if (op.substr(0, 1) == "h" || op.substr(0, 1) == "H") { // one-electron operator
 
-                // remove spaces
-                removeSpaces(op);
+            std::string idx1 = "p" + std::to_string(gen_label_count++);
+            std::string idx2 = "p" + std::to_string(gen_label_count++);
 
-                // remove parentheses
-                removeParentheses(op);
+            // index 1
+            tmp_string.push_back(idx1+"*");
 
-                if (op.substr(0, 1) == "h" || op.substr(0, 1) == "H") { // one-electron operator
+            // index 2
+            tmp_string.push_back(idx2);
 
-                    std::string idx1 = "p" + std::to_string(gen_label_count++);
-                    std::string idx2 = "p" + std::to_string(gen_label_count++);
+            // integrals
+            newguy->set_integrals("core", {idx1, idx2}, op_portions);
 
-                    // index 1
-                    tmp_string.push_back(idx1+"*");
+        }else if (op.substr(0, 1) == "f" || op.substr(0, 1) == "F") { // fock operator
 
-                    // index 2
-                    tmp_string.push_back(idx2);
+            std::string idx1 = "p" + std::to_string(gen_label_count++);
+            std::string idx2 = "p" + std::to_string(gen_label_count++);
 
-                    // integrals
-                    newguy->set_integrals("core", {idx1, idx2}, op_portions);
+            // index 1
+            tmp_string.push_back(idx1+"*");
 
-                }else if (op.substr(0, 1) == "f" || op.substr(0, 1) == "F") { // fock operator
+            // index 2
+            tmp_string.push_back(idx2);
 
-                    std::string idx1 = "p" + std::to_string(gen_label_count++);
-                    std::string idx2 = "p" + std::to_string(gen_label_count++);
+            // integrals
+            newguy->set_integrals("fock", {idx1, idx2}, op_portions);
 
-                    // index 1
-                    tmp_string.push_back(idx1+"*");
+        }else if (op.substr(0, 2) == "d+" || op.substr(0, 2) == "D+") { // one-electron operator (dipole + boson creator)
 
-                    // index 2
-                    tmp_string.push_back(idx2);
+            std::string idx1 = "p" + std::to_string(gen_label_count++);
+            std::string idx2 = "p" + std::to_string(gen_label_count++);
 
-                    // integrals
-                    newguy->set_integrals("fock", {idx1, idx2}, op_portions);
+            // index 1
+            tmp_string.push_back(idx1+"*");
 
-                }else if (op.substr(0, 2) == "d+" || op.substr(0, 2) == "D+") { // one-electron operator (dipole + boson creator)
+            // index 2
+            tmp_string.push_back(idx2);
 
-                    std::string idx1 = "p" + std::to_string(gen_label_count++);
-                    std::string idx2 = "p" + std::to_string(gen_label_count++);
+            // integrals
+            newguy->set_integrals("d+", {idx1, idx2}, op_portions);
 
-                    // index 1
-                    tmp_string.push_back(idx1+"*");
+            // boson operator
+            newguy->is_boson_dagger.push_back(true);
 
-                    // index 2
-                    tmp_string.push_back(idx2);
+        }else if (op.substr(0, 2) == "d-" || op.substr(0, 2) == "D-") { // one-electron operator (dipole + boson annihilator)
 
-                    // integrals
-                    newguy->set_integrals("d+", {idx1, idx2}, op_portions);
+            std::string idx1 = "p" + std::to_string(gen_label_count++);
+            std::string idx2 = "p" + std::to_string(gen_label_count++);
 
-                    // boson operator
-                    newguy->is_boson_dagger.push_back(true);
+            // index 1
+            tmp_string.push_back(idx1+"*");
 
-                }else if (op.substr(0, 2) == "d-" || op.substr(0, 2) == "D-") { // one-electron operator (dipole + boson annihilator)
+            // index 2
+            tmp_string.push_back(idx2);
 
-                    std::string idx1 = "p" + std::to_string(gen_label_count++);
-                    std::string idx2 = "p" + std::to_string(gen_label_count++);
+            // integrals
+            newguy->set_integrals("d-", {idx1, idx2}, op_portions);
 
-                    // index 1
-                    tmp_string.push_back(idx1+"*");
+            // boson operator
+            newguy->is_boson_dagger.push_back(false);
 
-                    // index 2
-                    tmp_string.push_back(idx2);
+        }else if (op.substr(0, 1) == "g" || op.substr(0, 1) == "G") { // general two-electron operator
 
-                    // integrals
-                    newguy->set_integrals("d-", {idx1, idx2}, op_portions);
+            //factor *= 0.25;
 
-                    // boson operator
-                    newguy->is_boson_dagger.push_back(false);
+            std::string idx1 = "p" + std::to_string(gen_label_count++);
+            std::string idx2 = "p" + std::to_string(gen_label_count++);
+            std::string idx3 = "p" + std::to_string(gen_label_count++);
+            std::string idx4 = "p" + std::to_string(gen_label_count++);
 
-                }else if (op.substr(0, 1) == "g" || op.substr(0, 1) == "G") { // general two-electron operator
+            tmp_string.push_back(idx1+"*");
+            tmp_string.push_back(idx2+"*");
+            tmp_string.push_back(idx3);
+            tmp_string.push_back(idx4);
 
-                    //factor *= 0.25;
+            newguy->set_integrals("two_body", {idx1, idx2, idx4, idx3}, op_portions);
 
-                    std::string idx1 = "p" + std::to_string(gen_label_count++);
-                    std::string idx2 = "p" + std::to_string(gen_label_count++);
-                    std::string idx3 = "p" + std::to_string(gen_label_count++);
-                    std::string idx4 = "p" + std::to_string(gen_label_count++);
+        }else if (op.substr(0, 1) == "j" || op.substr(0, 1) == "J") { // fluctuation potential
 
-                    tmp_string.push_back(idx1+"*");
-                    tmp_string.push_back(idx2+"*");
-                    tmp_string.push_back(idx3);
-                    tmp_string.push_back(idx4);
+            if (op.substr(1, 1) == "1" ){
 
-                    newguy->set_integrals("two_body", {idx1, idx2, idx4, idx3}, op_portions);
+                factor *= -1.0;
 
-                }else if (op.substr(0, 1) == "j" || op.substr(0, 1) == "J") { // fluctuation potential
+                std::string idx1 = "p" + std::to_string(gen_label_count++);
+                std::string idx2 = "p" + std::to_string(gen_label_count++);
 
-                    if (op.substr(1, 1) == "1" ){
+                // index 1
+                tmp_string.push_back(idx1+"*");
 
-                        factor *= -1.0;
+                // index 2
+                tmp_string.push_back(idx2);
 
-                        std::string idx1 = "p" + std::to_string(gen_label_count++);
-                        std::string idx2 = "p" + std::to_string(gen_label_count++);
+                // integrals
+                newguy->set_integrals("occ_repulsion", {idx1, idx2}, op_portions);
 
-                        // index 1
-                        tmp_string.push_back(idx1+"*");
+            }else if (op.substr(1, 1) == "2" ){
 
-                        // index 2
-                        tmp_string.push_back(idx2);
+                factor *= 0.25;
 
-                        // integrals
-                        newguy->set_integrals("occ_repulsion", {idx1, idx2}, op_portions);
+                std::string idx1 = "p" + std::to_string(gen_label_count++);
+                std::string idx2 = "p" + std::to_string(gen_label_count++);
+                std::string idx3 = "p" + std::to_string(gen_label_count++);
+                std::string idx4 = "p" + std::to_string(gen_label_count++);
 
-                    }else if (op.substr(1, 1) == "2" ){
+                tmp_string.push_back(idx1+"*");
+                tmp_string.push_back(idx2+"*");
+                tmp_string.push_back(idx3);
+                tmp_string.push_back(idx4);
 
-                        factor *= 0.25;
+                newguy->set_integrals("eri", {idx1, idx2, idx4, idx3}, op_portions);
 
-                        std::string idx1 = "p" + std::to_string(gen_label_count++);
-                        std::string idx2 = "p" + std::to_string(gen_label_count++);
-                        std::string idx3 = "p" + std::to_string(gen_label_count++);
-                        std::string idx4 = "p" + std::to_string(gen_label_count++);
+            }
 
-                        tmp_string.push_back(idx1+"*");
-                        tmp_string.push_back(idx2+"*");
-                        tmp_string.push_back(idx3);
-                        tmp_string.push_back(idx4);
+        }else if (op.substr(0, 1) == "t"){
 
-                        newguy->set_integrals("eri", {idx1, idx2, idx4, idx3}, op_portions);
+            int n = std::stoi(op.substr(2));
+            std::vector<std::string> labels;
 
-                    }
+            if ( n == 0 ){
 
-                }else if (op.substr(0, 1) == "t"){
+                // nothing to do
 
-                    int n = std::stoi(op.substr(2));
-                    std::vector<std::string> labels;
+            }else {
 
-                    if ( n == 0 ){
+                std::vector<std::string> op_left;
+                std::vector<std::string> op_right;
+                std::vector<std::string> label_left;
+                std::vector<std::string> label_right;
 
-                        // nothing to do
+                // excitation:
+                if ( op.substr(0,2) == "te" ) {
 
-                    }else {
+                    for (int id = 0; id < n; id++) {
 
-                        std::vector<std::string> op_left;
-                        std::vector<std::string> op_right;
-                        std::vector<std::string> label_left;
-                        std::vector<std::string> label_right;
- 
-                        // excitation:
-                        if ( op.substr(0,2) == "te" ) {
+                        std::string idx1 = "v" + std::to_string(vir_label_count++);
+                        std::string idx2 = "o" + std::to_string(occ_label_count++);
 
-                            for (int id = 0; id < n; id++) {
+                        op_left.push_back(idx1+"*");
+                        op_right.push_back(idx2);
 
-                                std::string idx1 = "v" + std::to_string(vir_label_count++);
-                                std::string idx2 = "o" + std::to_string(occ_label_count++);
+                        label_left.push_back(idx1);
+                        label_right.push_back(idx2);
+                    }
+                }else if ( op.substr(0,2) == "td" ) {
 
-                                op_left.push_back(idx1+"*");
-                                op_right.push_back(idx2);
+                    // de-excitation:
+                    for (int id = 0; id < n; id++) {
 
-                                label_left.push_back(idx1);
-                                label_right.push_back(idx2);
-                            }
-                        }else if ( op.substr(0,2) == "td" ) {
+                        std::string idx1 = "v" + std::to_string(vir_label_count++);
+                        std::string idx2 = "o" + std::to_string(occ_label_count++);
 
-                            // de-excitation:
-                            for (int id = 0; id < n; id++) {
+                        op_left.push_back(idx2+"*");
+                        op_right.push_back(idx1);
 
-                                std::string idx1 = "v" + std::to_string(vir_label_count++);
-                                std::string idx2 = "o" + std::to_string(occ_label_count++);
+                        // do not transpose de-excitation amplitude labels
+                        //label_left.push_back(idx1);
+                        //label_right.push_back(idx2);
+                        // transpose de-excitation amplitude labels
+                        label_left.push_back(idx2);
+                        label_right.push_back(idx1);
+                    }
+                }else {
+                    printf("\n");
+                    printf("    invalid operator type: %s\n", op.c_str());
+                    printf("\n");
+                    exit(1);
+                }
 
-                                op_left.push_back(idx2+"*");
-                                op_right.push_back(idx1);
+                // a*b*...
+                for (int id = 0; id < n; id++) {
+                    tmp_string.push_back(op_left[id]);
+                }
+                // op*j*...
+                for (int id = 0; id < n; id++) {
+                    tmp_string.push_back(op_right[id]);
+                }
 
-                                // do not transpose de-excitation amplitude labels
-                                //label_left.push_back(idx1);
-                                //label_right.push_back(idx2);
-                                // transpose de-excitation amplitude labels
-                                label_left.push_back(idx2);
-                                label_right.push_back(idx1);
-                            }
-                        }else {
-                            printf("\n");
-                            printf("    invalid operator type: %s\n", op.c_str());
-                            printf("\n");
-                            exit(1);
-                        }
+                // tn(ab...
+                for (int id = 0; id < n; id++) {
+                    labels.push_back(label_left[id]);
+                }
+                // tn(ab......ji)
+                for (int id = n-1; id >= 0; id--) {
+                    labels.push_back(label_right[id]);
+                }
 
-                        // a*b*...
-                        for (int id = 0; id < n; id++) {
-                            tmp_string.push_back(op_left[id]);
-                        }
-                        // op*j*...
-                        for (int id = 0; id < n; id++) {
-                            tmp_string.push_back(op_right[id]);
-                        }
+                // factor = 1/(n!)^2
+                double my_factor = 1.0;
+                for (int id = 0; id < n; id++) {
+                    my_factor *= (id+1);
+                }
+                factor *= 1.0 / my_factor / my_factor;
+            }
 
-                        // tn(ab...
-                        for (int id = 0; id < n; id++) {
-                            labels.push_back(label_left[id]);
-                        }
-                        // tn(ab......ji)
-                        for (int id = n-1; id >= 0; id--) {
-                            labels.push_back(label_right[id]);
+            int n_ph = 0;
+            if (op.size() > 3 ) {
+                if ( op.substr(3,1) == ",") {
+                    n_ph = std::stoi(op.substr(4));
+                    if ( op.substr(0,2) == "te" ) {
+                        // excitation
+                        for (int ph = 0; ph < n_ph; ph++) {
+                            newguy->is_boson_dagger.push_back(true);
                         }
-
-                        // factor = 1/(n!)^2
-                        double my_factor = 1.0;
-                        for (int id = 0; id < n; id++) {
-                            my_factor *= (id+1);
+                    }else if ( op.substr(0,2) == "td" ) {
+                        // de-excitation
+                        for (int ph = 0; ph < n_ph; ph++) {
+                            newguy->is_boson_dagger.push_back(false);
                         }
-                        factor *= 1.0 / my_factor / my_factor;
                     }
+                }
+            }
+            newguy->set_amplitudes('t', n, n, n_ph, labels, op_portions);
 
-                    int n_ph = 0;
-                    if (op.size() > 3 ) {
-                        if ( op.substr(3,1) == ",") {
-                            n_ph = std::stoi(op.substr(4));
-                            if ( op.substr(0,2) == "te" ) {
-                                // excitation
-                                for (int ph = 0; ph < n_ph; ph++) {
-                                    newguy->is_boson_dagger.push_back(true);
-                                }
-                            }else if ( op.substr(0,2) == "td" ) {
-                                // de-excitation
-                                for (int ph = 0; ph < n_ph; ph++) {
-                                    newguy->is_boson_dagger.push_back(false);
-                                }
-                            }
-                        }
-                    }
-                    newguy->set_amplitudes('t', n, n, n_ph, labels, op_portions);
+        }else if (op.substr(0, 1) == "w" || op.substr(0, 1) == "W"){ // w0 B*B
 
-                }else if (op.substr(0, 1) == "w" || op.substr(0, 1) == "W"){ // w0 B*B
+            if (op.substr(1, 1) == "0" ){
 
-                    if (op.substr(1, 1) == "0" ){
+                has_w0 = true;
 
-                        has_w0 = true;
+                newguy->is_boson_dagger.push_back(true);
+                newguy->is_boson_dagger.push_back(false);
 
-                        newguy->is_boson_dagger.push_back(true);
-                        newguy->is_boson_dagger.push_back(false);
+            }else {
+                printf("\n");
+                printf("    error: only w0 is supported\n");
+                printf("\n");
+                exit(1);
+            }
 
-                    }else {
-                        printf("\n");
-                        printf("    error: only w0 is supported\n");
-                        printf("\n");
-                        exit(1);
-                    }
+        }else if (op.substr(0, 2) == "b+" || op.substr(0, 2) == "B+"){ // B*
 
-                }else if (op.substr(0, 2) == "b+" || op.substr(0, 2) == "B+"){ // B*
+                newguy->is_boson_dagger.push_back(true);
 
-                        newguy->is_boson_dagger.push_back(true);
+        }else if (op.substr(0, 2) == "b-" || op.substr(0, 2) == "B-"){ // B
 
-                }else if (op.substr(0, 2) == "b-" || op.substr(0, 2) == "B-"){ // B
+                newguy->is_boson_dagger.push_back(false);
 
-                        newguy->is_boson_dagger.push_back(false);
+        }else if (op.substr(0, 1) == "r" || op.substr(0, 1) == "R"){
 
-                }else if (op.substr(0, 1) == "r" || op.substr(0, 1) == "R"){
 
+            int n = std::stoi(op.substr(1));
+            int n_annihilate = n;
+            int n_create     = n;
+            std::vector<std::string> labels;
 
-                    int n = std::stoi(op.substr(1));
-                    int n_annihilate = n;
-                    int n_create     = n;
-                    std::vector<std::string> labels;
+            if ( n == 0 ){
 
-                    if ( n == 0 ){
+                // nothing to do
 
-                        // nothing to do
+            }else {
 
-                    }else {
+                if ( right_operators_type == "IP" ) n_create--;
+                if ( right_operators_type == "DIP" ) n_create -= 2;
+                if ( right_operators_type == "EA" ) n_annihilate--;
+                if ( right_operators_type == "DEA" ) n_annihilate -= 2;
 
-                        if ( right_operators_type == "IP" ) n_create--;
-                        if ( right_operators_type == "DIP" ) n_create -= 2;
-                        if ( right_operators_type == "EA" ) n_annihilate--;
-                        if ( right_operators_type == "DEA" ) n_annihilate -= 2;
+                std::vector<std::string> op_left;
+                std::vector<std::string> op_right;
+                std::vector<std::string> label_left;
+                std::vector<std::string> label_right;
+                for (int id = 0; id < n_create; id++) {
+                    std::string idx1 = "v" + std::to_string(vir_label_count++);
+                    op_left.push_back(idx1+"*");
+                    label_left.push_back(idx1);
+                }
+                for (int id = 0; id < n_annihilate; id++) {
+                    std::string idx2 = "o" + std::to_string(occ_label_count++);
+                    op_right.push_back(idx2);
+                    label_right.push_back(idx2);
+                }
+                // a*b*...
+                for (int id = 0; id < n_create; id++) {
+                    tmp_string.push_back(op_left[id]);
+                }
+                // ij...
+                for (int id = 0; id < n_annihilate; id++) {
+                    tmp_string.push_back(op_right[id]);
+                }
 
-                        std::vector<std::string> op_left;
-                        std::vector<std::string> op_right;
-                        std::vector<std::string> label_left;
-                        std::vector<std::string> label_right;
-                        for (int id = 0; id < n_create; id++) {
-                            std::string idx1 = "v" + std::to_string(vir_label_count++);
-                            op_left.push_back(idx1+"*");
-                            label_left.push_back(idx1);
-                        }
-                        for (int id = 0; id < n_annihilate; id++) {
-                            std::string idx2 = "o" + std::to_string(occ_label_count++);
-                            op_right.push_back(idx2);
-                            label_right.push_back(idx2);
-                        }
-                        // a*b*...
-                        for (int id = 0; id < n_create; id++) {
-                            tmp_string.push_back(op_left[id]);
-                        }
-                        // ij...
-                        for (int id = 0; id < n_annihilate; id++) {
-                            tmp_string.push_back(op_right[id]);
-                        }
+                // tn(ab...
+                for (int id = 0; id < n_create; id++) {
+                    labels.push_back(label_left[id]);
+                }
+                // tn(ab......ji)
+                for (int id = n_annihilate-1; id >= 0; id--) {
+                    labels.push_back(label_right[id]);
+                }
 
-                        // tn(ab...
-                        for (int id = 0; id < n_create; id++) {
-                            labels.push_back(label_left[id]);
-                        }
-                        // tn(ab......ji)
-                        for (int id = n_annihilate-1; id >= 0; id--) {
-                            labels.push_back(label_right[id]);
-                        }
+                // factor = 1/(n!)^2
+                double my_factor_create = 1.0;
+                double my_factor_annihilate = 1.0;
+                for (int id = 0; id < n_create; id++) {
+                    my_factor_create *= (id+1);
+                }
+                for (int id = 0; id < n_annihilate; id++) {
+                    my_factor_annihilate *= (id+1);
+                }
+                factor *= 1.0 / my_factor_create / my_factor_annihilate;
+            }
 
-                        // factor = 1/(n!)^2
-                        double my_factor_create = 1.0;
-                        double my_factor_annihilate = 1.0;
-                        for (int id = 0; id < n_create; id++) {
-                            my_factor_create *= (id+1);
-                        }
-                        for (int id = 0; id < n_annihilate; id++) {
-                            my_factor_annihilate *= (id+1);
-                        }
-                        factor *= 1.0 / my_factor_create / my_factor_annihilate;
+            int n_ph = 0;
+            if (op.size() > 2 ) {
+                if ( op.substr(2,1) == ",") {
+                    n_ph = std::stoi(op.substr(3));
+                    for (int ph = 0; ph < n_ph; ph++) {
+                        newguy->is_boson_dagger.push_back(true);
                     }
+                }
+            }
+            newguy->set_amplitudes('r', n_create, n_annihilate, n_ph, labels, op_portions);
 
-                    int n_ph = 0;
-                    if (op.size() > 2 ) {
-                        if ( op.substr(2,1) == ",") {
-                            n_ph = std::stoi(op.substr(3));
-                            for (int ph = 0; ph < n_ph; ph++) {
-                                newguy->is_boson_dagger.push_back(true);
-                            }
-                        }
-                    }
-                    newguy->set_amplitudes('r', n_create, n_annihilate, n_ph, labels, op_portions);
-
-                }else if (op.substr(0, 1) == "l" || op.substr(0, 1) == "L"){
-
-                    int n = std::stoi(op.substr(1));
-                    int n_annihilate = n;
-                    int n_create     = n;
-                    std::vector<std::string> labels;
-
-                    if ( n == 0 ){
-
-                        // nothing to do
-
-                    }else {
-                        
-                        if ( left_operators_type == "IP" ) n_annihilate--;
-                        if ( left_operators_type == "DIP" ) n_annihilate -= 2;
-                        if ( left_operators_type == "EA" ) n_create--;
-                        if ( left_operators_type == "DEA" ) n_create -= 2;
-
-                        std::vector<std::string> op_left;
-                        std::vector<std::string> op_right;
-                        std::vector<std::string> label_left;
-                        std::vector<std::string> label_right;
-                        for (int id = 0; id < n_create; id++) {
-                            std::string idx1 = "o" + std::to_string(occ_label_count++);
-                            op_left.push_back(idx1+"*");
-                            label_left.push_back(idx1);
-                        }
-                        for (int id = 0; id < n_annihilate; id++) {
-                            std::string idx2 = "v" + std::to_string(vir_label_count++);
-                            op_right.push_back(idx2);
-                            label_right.push_back(idx2);
-                        }
-                        // op*j*...
-                        for (int id = 0; id < n_create; id++) {
-                            tmp_string.push_back(op_left[id]);
-                        }
-                        // ab...
-                        for (int id = 0; id < n_annihilate; id++) {
-                            tmp_string.push_back(op_right[id]);
-                        }
+        }else if (op.substr(0, 1) == "l" || op.substr(0, 1) == "L"){
 
-                        // tn(ij... 
-                        for (int id = 0; id < n_create; id++) {
-                            labels.push_back(label_left[id]);
-                        }
-                        // tn(ij......ba)
-                        for (int id = n_annihilate-1; id >= 0; id--) {
-                            labels.push_back(label_right[id]);
-                        }
-                        
-                        // factor = 1/(n!)^2
-                        double my_factor_create = 1.0;
-                        double my_factor_annihilate = 1.0;
-                        for (int id = 0; id < n_create; id++) {
-                            my_factor_create *= (id+1);
-                        }
-                        for (int id = 0; id < n_annihilate; id++) {
-                            my_factor_annihilate *= (id+1);
-                        }
-                        factor *= 1.0 / my_factor_create / my_factor_annihilate;
-                    
-                    }
+            int n = std::stoi(op.substr(1));
+            int n_annihilate = n;
+            int n_create     = n;
+            std::vector<std::string> labels;
 
-                    int n_ph = 0;
-                    if (op.size() > 2 ) {
-                        if ( op.substr(2,1) == ",") {
-                            n_ph = std::stoi(op.substr(3));
-                            for (int ph = 0; ph < n_ph; ph++) {
-                                newguy->is_boson_dagger.push_back(false);
-                            }
-                        }
-                    }
-                    newguy->set_amplitudes('l', n_create, n_annihilate, n_ph, labels, op_portions);
+            if ( n == 0 ){
 
-                }else if (op.substr(0, 1) == "e" || op.substr(0, 1) == "E"){
+                // nothing to do
 
+            }else {
 
-                    if (op.substr(1, 1) == "1" ){
+                if ( left_operators_type == "IP" ) n_annihilate--;
+                if ( left_operators_type == "DIP" ) n_annihilate -= 2;
+                if ( left_operators_type == "EA" ) n_create--;
+                if ( left_operators_type == "DEA" ) n_create -= 2;
 
-                        // find comma
-                        size_t pos = op.find(',');
-                        if ( pos == std::string::npos ) {
-                            printf("\n");
-                            printf("    error in e1 operator definition\n");
-                            printf("\n");
-                            exit(1);
-                        }
-                        size_t len = pos - 2; 
-
-                        // index 1
-                        tmp_string.push_back(op.substr(2, len) + "*");
-
-                        // index 2
-                        tmp_string.push_back(op.substr(pos + 1));
-
-                    }else if (op.substr(1, 1) == "2" ){
-
-                        // count indices
-                        size_t pos = 0;
-                        int ncomma = 0;
-                        std::vector<size_t> commas;
-                        pos = op.find(',', pos + 1);
-                        commas.push_back(pos);
-                        while( pos != std::string::npos){
-                            pos = op.find(',', pos + 1);
-                            commas.push_back(pos);
-                            ncomma++;
-                        }
+                std::vector<std::string> op_left;
+                std::vector<std::string> op_right;
+                std::vector<std::string> label_left;
+                std::vector<std::string> label_right;
+                for (int id = 0; id < n_create; id++) {
+                    std::string idx1 = "o" + std::to_string(occ_label_count++);
+                    op_left.push_back(idx1+"*");
+                    label_left.push_back(idx1);
+                }
+                for (int id = 0; id < n_annihilate; id++) {
+                    std::string idx2 = "v" + std::to_string(vir_label_count++);
+                    op_right.push_back(idx2);
+                    label_right.push_back(idx2);
+                }
+                // op*j*...
+                for (int id = 0; id < n_create; id++) {
+                    tmp_string.push_back(op_left[id]);
+                }
+                // ab...
+                for (int id = 0; id < n_annihilate; id++) {
+                    tmp_string.push_back(op_right[id]);
+                }
 
-                        if ( ncomma != 3 ) {
-                            printf("\n");
-                            printf("    error in e2 definition\n");
-                            printf("\n");
-                            exit(1);
-                        }
+                // tn(ij... 
+                for (int id = 0; id < n_create; id++) {
+                    labels.push_back(label_left[id]);
+                }
+                // tn(ij......ba)
+                for (int id = n_annihilate-1; id >= 0; id--) {
+                    labels.push_back(label_right[id]);
+                }
 
-                        tmp_string.push_back(op.substr(2, commas[0] - 2) + "*");
-                        tmp_string.push_back(op.substr(commas[0] + 1, commas[1] - commas[0] - 1) + "*");
-                        tmp_string.push_back(op.substr(commas[1] + 1, commas[2] - commas[1] - 1));
-                        tmp_string.push_back(op.substr(commas[2] + 1));
-
-                    }else if (op.substr(1, 1) == "3" ){
-
-                        // count indices
-                        size_t pos = 0;
-                        int ncomma = 0;
-                        std::vector<size_t> commas;
-                        pos = op.find(',', pos + 1);
-                        commas.push_back(pos);
-                        while( pos != std::string::npos){
-                            pos = op.find(',', pos + 1);
-                            commas.push_back(pos);
-                            ncomma++;
-                        }
+                // factor = 1/(n!)^2
+                double my_factor_create = 1.0;
+                double my_factor_annihilate = 1.0;
+                for (int id = 0; id < n_create; id++) {
+                    my_factor_create *= (id+1);
+                }
+                for (int id = 0; id < n_annihilate; id++) {
+                    my_factor_annihilate *= (id+1);
+                }
+                factor *= 1.0 / my_factor_create / my_factor_annihilate;
 
-                        if ( ncomma != 5 ) {
-                            printf("\n");
-                            printf("    error in e3 definition\n");
-                            printf("\n");
-                            exit(1);
-                        }
+            }
 
-                        tmp_string.push_back(op.substr(2, commas[0] - 2) + "*");
-                        tmp_string.push_back(op.substr(commas[0] + 1, commas[1] - commas[0] - 1) + "*");
-                        tmp_string.push_back(op.substr(commas[1] + 1, commas[2] - commas[1] - 1) + "*");
-                        tmp_string.push_back(op.substr(commas[2] + 1, commas[3] - commas[2] - 1));
-                        tmp_string.push_back(op.substr(commas[3] + 1, commas[4] - commas[3] - 1));
-                        tmp_string.push_back(op.substr(commas[4] + 1));
-
-                    }else if (op.substr(1, 1) == "4" ){
-
-                        // count indices
-                        size_t pos = 0;
-                        int ncomma = 0;
-                        std::vector<size_t> commas;
-                        pos = op.find(',', pos + 1);
-                        commas.push_back(pos);
-                        while( pos != std::string::npos){
-                            pos = op.find(',', pos + 1);
-                            commas.push_back(pos);
-                            ncomma++;
-                        }
+            int n_ph = 0;
+            if (op.size() > 2 ) {
+                if ( op.substr(2,1) == ",") {
+                    n_ph = std::stoi(op.substr(3));
+                    for (int ph = 0; ph < n_ph; ph++) {
+                        newguy->is_boson_dagger.push_back(false);
+                    }
+                }
+            }
+            newguy->set_amplitudes('l', n_create, n_annihilate, n_ph, labels, op_portions);
 
-                        if ( ncomma != 7 ) {
-                            printf("\n");
-                            printf("    error in e4 definition\n");
-                            printf("\n");
-                            exit(1);
-                        }
+        }else if (op.substr(0, 1) == "e" || op.substr(0, 1) == "E"){
 
-                        tmp_string.push_back(op.substr(2, commas[0] - 2) + "*");
-                        tmp_string.push_back(op.substr(commas[0] + 1, commas[1] - commas[0] - 1) + "*");
-                        tmp_string.push_back(op.substr(commas[1] + 1, commas[2] - commas[1] - 1) + "*");
-                        tmp_string.push_back(op.substr(commas[2] + 1, commas[3] - commas[2] - 1) + "*");
-                        tmp_string.push_back(op.substr(commas[3] + 1, commas[4] - commas[3] - 1));
-                        tmp_string.push_back(op.substr(commas[4] + 1, commas[5] - commas[4] - 1));
-                        tmp_string.push_back(op.substr(commas[5] + 1, commas[6] - commas[5] - 1));
-                        tmp_string.push_back(op.substr(commas[6] + 1));
-
-                    }else {
-                        printf("\n");
-                        printf("    error: only e1, e2, e3, and e4 operators are supported\n");
-                        printf("\n");
-                        exit(1);
-                    }
 
-                }else if (op.substr(0, 1) == "1" ) { // unit operator ... do nothing
+            if (op.substr(1, 1) == "1" ){
+
+                // find comma
+                size_t pos = op.find(',');
+                if ( pos == std::string::npos ) {
+                    printf("\n");
+                    printf("    error in e1 operator definition\n");
+                    printf("\n");
+                    exit(1);
+                }
+                size_t len = pos - 2; 
+
+                // index 1
+                tmp_string.push_back(op.substr(2, len) + "*");
 
-                }else if (op.substr(0, 1) == "a" || op.substr(0, 1) == "A"){ // single creator / annihilator
+                // index 2
+                tmp_string.push_back(op.substr(pos + 1));
 
+            }else if (op.substr(1, 1) == "2" ){
 
-                    if (op.substr(1, 1) == "*" ){ // creator
+                // count indices
+                size_t pos = 0;
+                int ncomma = 0;
+                std::vector<size_t> commas;
+                pos = op.find(',', pos + 1);
+                commas.push_back(pos);
+                while( pos != std::string::npos){
+                    pos = op.find(',', pos + 1);
+                    commas.push_back(pos);
+                    ncomma++;
+                }
 
-                        tmp_string.push_back(op.substr(1) + "*");
+                if ( ncomma != 3 ) {
+                    printf("\n");
+                    printf("    error in e2 definition\n");
+                    printf("\n");
+                    exit(1);
+                }
 
-                    }else { // annihilator
+                tmp_string.push_back(op.substr(2, commas[0] - 2) + "*");
+                tmp_string.push_back(op.substr(commas[0] + 1, commas[1] - commas[0] - 1) + "*");
+                tmp_string.push_back(op.substr(commas[1] + 1, commas[2] - commas[1] - 1));
+                tmp_string.push_back(op.substr(commas[2] + 1));
 
-                        tmp_string.push_back(op.substr(1));
+            }else if (op.substr(1, 1) == "3" ){
 
-                    }
+                // count indices
+                size_t pos = 0;
+                int ncomma = 0;
+                std::vector<size_t> commas;
+                pos = op.find(',', pos + 1);
+                commas.push_back(pos);
+                while( pos != std::string::npos){
+                    pos = op.find(',', pos + 1);
+                    commas.push_back(pos);
+                    ncomma++;
+                }
 
-                }else {
-                        printf("\n");
-                        printf("    error: undefined string\n");
-                        printf("\n");
-                        exit(1);
+                if ( ncomma != 5 ) {
+                    printf("\n");
+                    printf("    error in e3 definition\n");
+                    printf("\n");
+                    exit(1);
                 }
-            }
 
-            newguy->factor = factor;
+                tmp_string.push_back(op.substr(2, commas[0] - 2) + "*");
+                tmp_string.push_back(op.substr(commas[0] + 1, commas[1] - commas[0] - 1) + "*");
+                tmp_string.push_back(op.substr(commas[1] + 1, commas[2] - commas[1] - 1) + "*");
+                tmp_string.push_back(op.substr(commas[2] + 1, commas[3] - commas[2] - 1));
+                tmp_string.push_back(op.substr(commas[3] + 1, commas[4] - commas[3] - 1));
+                tmp_string.push_back(op.substr(commas[4] + 1));
 
-            for (const std::string & op : tmp_string) {
-                newguy->string.push_back(op);
-            }
+            }else if (op.substr(1, 1) == "4" ){
+
+                // count indices
+                size_t pos = 0;
+                int ncomma = 0;
+                std::vector<size_t> commas;
+                pos = op.find(',', pos + 1);
+                commas.push_back(pos);
+                while( pos != std::string::npos){
+                    pos = op.find(',', pos + 1);
+                    commas.push_back(pos);
+                    ncomma++;
+                }
+
+                if ( ncomma != 7 ) {
+                    printf("\n");
+                    printf("    error in e4 definition\n");
+                    printf("\n");
+                    exit(1);
+                }
 
-            newguy->has_w0 = has_w0;
+                tmp_string.push_back(op.substr(2, commas[0] - 2) + "*");
+                tmp_string.push_back(op.substr(commas[0] + 1, commas[1] - commas[0] - 1) + "*");
+                tmp_string.push_back(op.substr(commas[1] + 1, commas[2] - commas[1] - 1) + "*");
+                tmp_string.push_back(op.substr(commas[2] + 1, commas[3] - commas[2] - 1) + "*");
+                tmp_string.push_back(op.substr(commas[3] + 1, commas[4] - commas[3] - 1));
+                tmp_string.push_back(op.substr(commas[4] + 1, commas[5] - commas[4] - 1));
+                tmp_string.push_back(op.substr(commas[5] + 1, commas[6] - commas[5] - 1));
+                tmp_string.push_back(op.substr(commas[6] + 1));
 
-            // make sure factor > 0
-            if ( newguy->factor < 0.0 ) {
-                newguy->factor = fabs(newguy->factor);
-                newguy->sign *= -1;
+            }else {
+                printf("\n");
+                printf("    error: only e1, e2, e3, and e4 operators are supported\n");
+                printf("\n");
+                exit(1);
             }
 
-            if (vacuum == "TRUE") {
-                add_new_string_true_vacuum(newguy, ordered, print_level, find_paired_permutations);
-            } else {
-                add_new_string_fermi_vacuum(newguy, ordered, print_level, find_paired_permutations, occ_label_count, vir_label_count);
+        }else if (op.substr(0, 1) == "1" ) { // unit operator ... do nothing
+
+        }else if (op.substr(0, 1) == "a" || op.substr(0, 1) == "A"){ // single creator / annihilator
+
+
+            if (op.substr(1, 1) == "*" ){ // creator
+
+                tmp_string.push_back(op.substr(1) + "*");
+
+            }else { // annihilator
+
+                tmp_string.push_back(op.substr(1));
+
             }
+
+        }else {
+                printf("\n");
+                printf("    error: undefined string\n");
+                printf("\n");
+                exit(1);
         }
     }
+
+    vertex_of.resize(tmp_string.size(), vertex);
+
+    newguy->factor = factor;
+
+    for (const std::string & op : tmp_string) {
+        newguy->string.push_back(op);
+    }
+
+    newguy->has_w0 = has_w0;
+
+    // make sure factor > 0
+    if ( newguy->factor < 0.0 ) {
+        newguy->factor = fabs(newguy->factor);
+        newguy->sign *= -1;
+    }
+
+    // contractions that leave a cluster operator disconnected from the transformed operator are
+    // never generated
+    if ( n_connected_targets > 0 && save.size() > n_connected_targets ) {
+        add_new_string_fermi_vacuum(newguy, list, print_level, find_paired_permutations, occ_label_count, vir_label_count, true, &vertex_of);
+        return;
+    }
+
+    if (vacuum == "TRUE") {
+        add_new_string_true_vacuum(newguy, list, print_level, find_paired_permutations);
+    } else {
+        add_new_string_fermi_vacuum(newguy, list, print_level, find_paired_permutations, occ_label_count, vir_label_count, engine == "WICK");
+    }
+}
+
+void pq_helper::set_cache_directory(const std::string &directory) {
+    cache_directory = directory;
+    if ( directory.empty() ) {
+        generate_pending_products();
+    }
+}
+
+// bring recorded operator products to normal order under the settings they were added with
+void pq_helper::generate_pending_products() {
+
+    if ( pending_products.empty() ) return;
+
+    std::vector<std::vector<std::string> > current_left_operators = left_operators;
+    std::vector<std::vector<std::string> > current_right_operators = right_operators;
+    std::string current_left_operators_type = left_operators_type;
+    std::string current_right_operators_type = right_operators_type;
+    bool current_is_unitary_cc = is_unitary_cc;
+    bool current_find_paired_permutations = find_paired_permutations;
+
+    for (const pending_operator_products & pending : pending_products) {
+        left_operators = pending.left_operators;
+        right_operators = pending.right_operators;
+        left_operators_type = pending.left_operators_type;
+        right_operators_type = pending.right_operators_type;
+        is_unitary_cc = pending.is_unitary_cc;
+        find_paired_permutations = pending.find_paired_permutations;
+        generate_operator_products(pending.terms);
+    }
+    pending_products.clear();
+
+    left_operators = current_left_operators;
+    right_operators = current_right_operators;
+    left_operators_type = current_left_operators_type;
+    right_operators_type = current_right_operators_type;
+    is_unitary_cc = current_is_unitary_cc;
+    find_paired_permutations = current_find_paired_permutations;
+}
+
+// 64-bit FNV-1a hash of a string
+static uint64_t fnv1a_hash(const std::string &in) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : in) {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// the version of the cached results. this must change whenever a change to pdaggerq could
+// change the strings produced for a given set of operator products, so results saved by one
+// build are never used by another
+static const std::string pq_cache_version = std::string("pdaggerq cache 1, format ")
+    + std::to_string(pq_file_version) + ", built " + __DATE__ + " " + __TIME__;
+
+std::string pq_helper::cache_description() const {
+    return pq_cache_version + "\n" + vacuum + " " + engine + "\n" + cache_history;
 }
 
 void pq_helper::simplify() {
 
+    if ( cache_directory.empty() || !cache_history_valid ) {
+        if ( !ordered.empty() ) {
+            cache_history.clear();
+            cache_history_valid = false;
+        }
+        generate_pending_products();
+        simplify_strings();
+        return;
+    }
+
+    // the result is determined by the vacuum, the engine, everything added since the last
+    // clear(), and the settings used here
+    std::ostringstream description;
+    description << "simplify " << use_rdms << is_unitary_cc << find_paired_permutations << " "
+                << bernoulli_excitation_level;
+    for (int n : ignore_cumulant_rdms) description << " " << n;
+    description << "\n";
+    cache_history += description.str();
+
+    std::string full_description = cache_description();
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)fnv1a_hash(full_description));
+    std::string filename = cache_directory + "/pq_" + key + ".bin";
+
+    // reuse a cached result. the file holds the full description of the products it was built
+    // from, which must match ours (a file from another build or a colliding key is a miss and is
+    // overwritten). only the strings are taken from it, so the settings of this pq_helper are
+    // left alone
+    pq_helper cached(vacuum);
+    if ( std::ifstream(filename, std::ios::binary).good() && cached.deserialize_cached(filename, full_description) ) {
+        ordered = std::move(cached.ordered);
+        ordered_blocked = std::move(cached.ordered_blocked);
+        consolidated.clear();
+        pending_products.clear();
+        pruned_excitation_level = -1;
+        for (const std::shared_ptr<pq_string> & pq_str : ordered) {
+            pq_str->is_simplified = true;
+        }
+        return;
+    }
+
+    generate_pending_products();
+    simplify_strings();
+
+    // write to a temporary file first so that a concurrent run never reads a partial result. the
+    // cache is only an optimization, so a directory that cannot be written is skipped
+    std::string tmp_filename = filename + "." + std::to_string(getpid()) + ".tmp";
+    if ( !write_serialized(tmp_filename) || std::rename(tmp_filename.c_str(), filename.c_str()) != 0 ) {
+        std::remove(tmp_filename.c_str());
+    }
+}
+
+void pq_helper::simplify_strings() {
+
+    // strings that survived an earlier call to simplify() have been through the steps below
+    // already, so they only need to be consolidated with the strings added since
+    std::vector< std::shared_ptr<pq_string> > simplified;
+    std::vector< std::shared_ptr<pq_string> > added;
+    for (const std::shared_ptr<pq_string> & pq_str : ordered) {
+        if ( pq_str->is_simplified ) simplified.push_back(pq_str);
+        else                         added.push_back(pq_str);
+    }
+
     // eliminate strings based on delta functions and use delta functions to alter integral / amplitude labels
-    for (std::shared_ptr<pq_string> & pq_str : ordered) {
+    for (std::shared_ptr<pq_string> & pq_str : added) {
 
         if ( pq_str->skip ) continue;
 
@@ -1370,7 +1806,7 @@ void pq_helper::simplify() {
                 // check if first label is occupied or not. if so, reverse order and flip sign
                 if ( pq_str->amps['t'][j].labels.size() == 0 ) continue;
                 if ( is_occ(pq_str->amps['t'][j].labels[0]) ) {
-                    std::reverse(pq_str->amps['t'][j].labels.begin(), pq_str->amps['t'][j].labels.end());
+                    pq_str->amps['t'][j].labels.reverse();
                 }
             }
         }
@@ -1395,10 +1831,10 @@ void pq_helper::simplify() {
 
             std::vector<std::string> rdm_labels;
             for (size_t i = 0; i < n_create; i++) {
-                rdm_labels.push_back(pq_str->symbol[i]);
+                rdm_labels.push_back(label_name(pq_str->symbol[i]));
             }
             for (size_t i = 0; i < n_annihilate; i++) {
-                rdm_labels.push_back(pq_str->symbol[n - i - 1]);
+                rdm_labels.push_back(label_name(pq_str->symbol[n - i - 1]));
             }
 
             // TODO: we're assuming no photons ... 
@@ -1409,11 +1845,16 @@ void pq_helper::simplify() {
     }
 
     // replace rdms with cumulant expansion, ignoring the n-body cumulant
-    cumulant_expansion(ordered, ignore_cumulant_rdms);
+    cumulant_expansion(added, ignore_cumulant_rdms);
 
     // try to cancel similar terms
-    cleanup(ordered, find_paired_permutations);
+    ordered = std::move(simplified);
+    cleanup(ordered, added, consolidated, find_paired_permutations);
 
+    for (const std::shared_ptr<pq_string> & pq_str : ordered) {
+        pq_str->is_simplified = true;
+    }
+    pruned_excitation_level = -1; // the pruned strings have been through eliminate_operator_portions
 }
 
 // block labels by orbital spaces
@@ -1421,22 +1862,27 @@ void pq_helper::block_by_range(const std::unordered_map<std::string, std::vector
     ordered_blocked.clear();
 
     // add ranges to labels
-    pq_string::is_range_blocked = true;
-    if ( pq_string::is_spin_blocked ) {
+    is_range_blocked = true;
+    if ( is_spin_blocked ) {
         printf("\n");
         printf("    error: cannot simultaneously block by spin and by range\n");
         printf("\n");
         exit(1);
     }
 
-    std::vector< std::shared_ptr<pq_string> > range_blocked;
+    // strings are blocked independently and collected in their original order
+    std::vector< std::vector< std::shared_ptr<pq_string> > > lists(ordered.size());
 
-    for (auto & pq_str : ordered) {
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < ordered.size(); i++) {
+        const std::shared_ptr<pq_string> & pq_str = ordered[i];
         if ( !pq_str->symbol.empty() ) continue;
         if ( !pq_str->is_boson_dagger.empty() ) continue;
-        std::vector< std::shared_ptr<pq_string> > tmp;
-        add_label_ranges(pq_str, tmp, label_ranges);
-        for (const auto & op : tmp) {
+        add_label_ranges(pq_str, lists[i], label_ranges);
+    }
+
+    for (const std::vector< std::shared_ptr<pq_string> > & list : lists) {
+        for (const auto & op : list) {
             ordered_blocked.push_back(op);
         }
     }
@@ -1447,20 +1893,27 @@ void pq_helper::block_by_spin(const std::unordered_map<std::string, std::string>
     ordered_blocked.clear();
 
     // perform spin tracing
-    pq_string::is_spin_blocked = true;
-    if ( pq_string::is_range_blocked ) {
+    is_spin_blocked = true;
+    if ( is_range_blocked ) {
         printf("\n");
         printf("    error: cannot simultaneously block by spin and by range\n");
         printf("\n");
         exit(1);
     }
 
-    for (std::shared_ptr<pq_string> & pq_str : ordered) {
+    // strings are blocked independently and collected in their original order
+    std::vector< std::vector< std::shared_ptr<pq_string> > > lists(ordered.size());
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < ordered.size(); i++) {
+        const std::shared_ptr<pq_string> & pq_str = ordered[i];
         if (!pq_str->symbol.empty()) continue;
         if (!pq_str->is_boson_dagger.empty()) continue;
-        std::vector<std::shared_ptr<pq_string> > tmp_ordered;
-        spin_blocking(pq_str, tmp_ordered, spin_labels);
-        for (const std::shared_ptr<pq_string> & tmp_pq_str : tmp_ordered) {
+        spin_blocking(pq_str, lists[i], spin_labels);
+    }
+
+    for (const std::vector< std::shared_ptr<pq_string> > & list : lists) {
+        for (const std::shared_ptr<pq_string> & tmp_pq_str : list) {
             ordered_blocked.push_back(tmp_pq_str);
         }
     }
@@ -1468,12 +1921,19 @@ void pq_helper::block_by_spin(const std::unordered_map<std::string, std::string>
 
 std::vector<std::vector<std::string> > pq_helper::strings() const {
 
-    bool is_blocked = pq_string::is_spin_blocked || pq_string::is_range_blocked;
+    if ( !pending_products.empty() ) {
+        printf("\n");
+        printf("    error: strings() called before simplify() with a cache directory set\n");
+        printf("\n");
+        exit(1);
+    }
+
+    bool is_blocked = is_spin_blocked || is_range_blocked;
     const auto &reference = is_blocked ? ordered_blocked : ordered;
 
     std::vector<std::vector<std::string> > list;
     for (const std::shared_ptr<pq_string> & pq_str : reference) {
-        std::vector<std::string> my_string = pq_str->get_string();
+        std::vector<std::string> my_string = pq_str->get_string(is_spin_blocked, is_range_blocked);
         if ( (int)my_string.size() > 0 ) {
             list.push_back(my_string);
         }
@@ -1483,31 +1943,230 @@ std::vector<std::vector<std::string> > pq_helper::strings() const {
 
 }
 
+// the terms are laid out in the order used by pq_string::get_string, so term_arrays() and
+// strings() describe the same strings
+pq_term_arrays pq_helper::term_arrays() const {
+
+    if ( !pending_products.empty() ) {
+        printf("\n");
+        printf("    error: term_arrays() called before simplify() with a cache directory set\n");
+        printf("\n");
+        exit(1);
+    }
+
+    bool is_blocked = is_spin_blocked || is_range_blocked;
+    const auto &reference = is_blocked ? ordered_blocked : ordered;
+
+    pq_term_arrays arrays;
+    arrays.tensor_offsets.push_back(0);
+    arrays.permutation_offsets.push_back(0);
+    arrays.label_offsets.push_back(0);
+    arrays.permutation_label_offsets.push_back(0);
+
+    // names and labels are looked up once per distinct string
+    std::unordered_map<std::string, int32_t> tensor_ids;
+    std::unordered_map<std::string, int32_t> block_ids;
+    std::unordered_map<std::string, pq_label> label_ids;
+
+    auto tensor_id = [&](const std::string &name) {
+        auto it = tensor_ids.find(name);
+        if ( it != tensor_ids.end() ) return it->second;
+        int32_t id = (int32_t)arrays.tensor_names.size();
+        arrays.tensor_names.push_back(name);
+        tensor_ids.emplace(name, id);
+        return id;
+    };
+    auto block_id = [&](const std::string &name) {
+        auto it = block_ids.find(name);
+        if ( it != block_ids.end() ) return it->second;
+        int32_t id = (int32_t)arrays.block_names.size();
+        arrays.block_names.push_back(name);
+        block_ids.emplace(name, id);
+        return id;
+    };
+    auto label_id = [&](const std::string &name) {
+        auto it = label_ids.find(name);
+        if ( it != label_ids.end() ) return it->second;
+        pq_label id = intern_label(name);
+        label_ids.emplace(name, id);
+        return id;
+    };
+
+    auto add_tensor = [&](const std::string &name, const tensor * in) {
+        arrays.tensor_types.push_back(tensor_id(name));
+        if ( in != nullptr ) {
+            for (size_t i = 0; i < in->labels.size(); i++) {
+                arrays.labels.push_back(label_id(in->labels[i]));
+                int32_t block = -1;
+                if ( is_spin_blocked && i < in->spin_labels.size() ) {
+                    block = block_id(in->spin_labels[i]);
+                }else if ( is_range_blocked && i < in->label_ranges.size() ) {
+                    block = block_id(in->label_ranges[i]);
+                }
+                arrays.label_blocks.push_back(block);
+            }
+        }
+        arrays.label_offsets.push_back((int64_t)arrays.labels.size());
+    };
+
+    auto add_permutations = [&](int32_t type, const std::vector<std::string> &labels, size_t n_labels) {
+        for (size_t i = 0; i + n_labels <= labels.size(); i += n_labels) {
+            arrays.permutation_types.push_back(type);
+            for (size_t j = i; j < i + n_labels; j++) {
+                arrays.permutation_labels.push_back(label_id(labels[j]));
+            }
+            arrays.permutation_label_offsets.push_back((int64_t)arrays.permutation_labels.size());
+        }
+    };
+
+    for (const std::shared_ptr<pq_string> & pq_str : reference) {
+
+        if ( pq_str->skip ) continue;
+
+        arrays.factors.push_back(pq_str->sign * pq_str->factor);
+
+        add_permutations(0, pq_str->permutations, 2);
+        add_permutations(1, pq_str->paired_permutations_2, 4);
+        add_permutations(3, pq_str->paired_permutations_6, 6);
+        add_permutations(2, pq_str->paired_permutations_3, 6);
+
+        // creation / annihilation operators
+        for (size_t i = 0; i < pq_str->symbol.size(); i++) {
+            arrays.tensor_types.push_back(tensor_id(pq_str->is_dagger[i] ? "a*" : "a"));
+            arrays.labels.push_back(pq_str->symbol[i]);
+            arrays.label_blocks.push_back(-1);
+            arrays.label_offsets.push_back((int64_t)arrays.labels.size());
+        }
+
+        for (const delta_functions & delta : pq_str->deltas) {
+            add_tensor("d", &delta);
+        }
+        for (const auto & [type, ints] : pq_str->ints) {
+            for (const integrals & integral : ints) {
+                add_tensor(type, &integral);
+            }
+        }
+        for (const auto & [type, amps] : pq_str->amps) {
+            for (const amplitudes & amp : amps) {
+                std::string name(1, type);
+                name += std::to_string(std::max(amp.n_create, amp.n_annihilate));
+                if ( amp.n_ph > 0 ) {
+                    name += "_" + std::to_string(amp.n_ph) + "p";
+                }
+                add_tensor(name, &amp);
+            }
+        }
+
+        // bosons
+        for (bool is_bdag : pq_str->is_boson_dagger) {
+            add_tensor(is_bdag ? "B*" : "B", nullptr);
+        }
+        if ( pq_str->has_w0 ) {
+            add_tensor("w0", nullptr);
+        }
+
+        arrays.tensor_offsets.push_back((int64_t)arrays.tensor_types.size());
+        arrays.permutation_offsets.push_back((int64_t)arrays.permutation_types.size());
+    }
+
+    return arrays;
+}
+
 void pq_helper::clear() {
     ordered.clear();
+    consolidated.clear();
     ordered_blocked.clear();
-    pq_string::is_spin_blocked = false;
-    pq_string::is_range_blocked = false;
+    pending_products.clear();
+    pruned_excitation_level = -1;
+    cache_history.clear();
+    cache_history_valid = true;
+    is_spin_blocked = false;
+    is_range_blocked = false;
 }
 
 void pq_helper::add_st_operator(double factor, 
                                 const std::vector<std::string> &targets,
                                 const std::vector<std::string> &ops,
-                                bool do_operators_commute = true){
+                                bool do_operators_commute,
+                                bool connected_only){
+
+    std::vector<pq_operator_terms> st_terms = get_st_operator_terms(factor, targets, ops, do_operators_commute, connected_only);
+    add_operator_products(st_terms);
+}
+
+// add the products targets * ops[i] * ops[j] * ... with first <= i <= j <= ... and up to four operators
+// from ops. each product appears once, with a factor 1 / (m1! m2! ...), where m1, m2, ... are the number
+// of times each operator appears
+static void add_connected_products(double factor,
+                                   const std::vector<std::string> &targets,
+                                   const std::vector<std::string> &ops,
+                                   size_t first,
+                                   int multiplicity,
+                                   std::vector<std::string> &product,
+                                   std::vector<pq_operator_terms> &terms) {
+
+    if ( product.size() == targets.size() + 4 ) return;
 
-    std::vector<pq_operator_terms> st_terms = get_st_operator_terms(factor, targets, ops, do_operators_commute);
-    for (auto term : st_terms){
-        add_operator_product(term.factor, term.operators);
+    for (size_t i = first; i < ops.size(); i++) {
+
+        int my_multiplicity = ( i == first && product.size() > targets.size() ) ? multiplicity + 1 : 1;
+        double my_factor = factor / my_multiplicity;
+
+        product.push_back(ops[i]);
+
+        terms.emplace_back(my_factor, product);
+        terms.back().n_connected_targets = targets.size();
+
+        add_connected_products(my_factor, targets, ops, i, my_multiplicity, product, terms);
+
+        product.pop_back();
     }
 }
 
-std::vector<pq_operator_terms> pq_helper::get_st_operator_terms(double factor, const std::vector<std::string> &targets,const std::vector<std::string> &ops, bool do_operators_commute = true){
+std::vector<pq_operator_terms> pq_helper::get_st_operator_terms(double factor, const std::vector<std::string> &targets,const std::vector<std::string> &ops, bool do_operators_commute, bool connected_only){
 
     int dim = (int)ops.size();
 
     std::vector<pq_operator_terms> st_terms;
     st_terms.push_back(pq_operator_terms(factor, targets));
 
+    if ( connected_only ) {
+
+        // exp(-T) f exp(T) = (f exp(T))_C only holds for commuting, excitation-only cluster operators, and
+        // the connectivity of a term is determined from its delta functions (i.e., fermionic contractions)
+        if ( vacuum != "FERMI" || is_unitary_cc || !do_operators_commute ) {
+            printf("\n");
+            printf("    error: connected-term generation requires the fermi vacuum and commuting, non-unitary cluster operators\n");
+            printf("\n");
+            exit(1);
+        }
+        for (const std::string & op : ops) {
+            std::string base = get_operator_base_name(op);
+            if ( ( base.substr(0, 1) != "t" && base.substr(0, 1) != "T" ) || base.find(',') != std::string::npos ) {
+                printf("\n");
+                printf("    error: connected-term generation is only supported for fermionic cluster operators\n");
+                printf("\n");
+                exit(1);
+            }
+        }
+        for (const std::string & op : targets) {
+            std::string base = get_operator_base_name(op);
+            std::string prefix = base.substr(0, 2);
+            std::transform(prefix.begin(), prefix.end(), prefix.begin(), ::tolower);
+            if ( prefix.substr(0, 1) == "w" || prefix == "b+" || prefix == "b-" || prefix == "d+" || prefix == "d-" ) {
+                printf("\n");
+                printf("    error: connected-term generation does not support bosonic operators\n");
+                printf("\n");
+                exit(1);
+            }
+        }
+
+        std::vector<std::string> product = targets;
+        add_connected_products(factor, targets, ops, 0, 0, product, st_terms);
+
+        return st_terms;
+    }
+
     for (int i = 0; i < dim; i++) {
         std::vector<pq_operator_terms> tmp = get_commutator_terms(factor, targets, {ops[i]});
         st_terms.insert(std::end(st_terms), std::begin(tmp), std::end(tmp));
@@ -1635,7 +2294,7 @@ std::vector<pq_operator_terms> pq_helper::get_st_operator_terms(double factor, c
         }
     }
 
-    return st_terms;
+    return merge_operator_terms(st_terms);
 }
 
 void pq_helper::add_bernoulli_operator(double factor,
@@ -1644,1917 +2303,60 @@ void pq_helper::add_bernoulli_operator(double factor,
                                        const int max_order) {
 
     std::vector<pq_operator_terms> bernoulli_terms = get_bernoulli_operator_terms(factor, targets, ops, max_order);
-    for (auto term : bernoulli_terms){
-        add_operator_product(term.factor, term.operators);
-    }
+    add_operator_products(bernoulli_terms);
 }
 
 std::vector<pq_operator_terms> pq_helper::get_bernoulli_operator_terms(double factor, const std::vector<std::string> &targets,const std::vector<std::string> &ops, const int max_order) {
 
-    if ( max_order > 6 ) {
-        printf("\n");
-        printf("    error: Bernoulli terms beyond 6th-order are not yet implemented.\n");
-        printf("\n");
-        exit(1);
-    }
-
-    int dim = (int)ops.size();
-
     std::vector<pq_operator_terms> bernoulli_terms;
 
     // zeroth-order terms: v
     bernoulli_terms.push_back(pq_operator_terms(factor, targets));
 
-    if ( max_order == 0 ) {
-        return bernoulli_terms;
-    }
-
-    // first-order terms: 1/2 [v, sigma] + 1/2 [v_R, sigma]
-
-    std::vector<pq_operator_terms> tmp = get_bernoulli_operator_terms_1(factor, targets, ops);
-    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-
-    if ( max_order == 1 ) {
-        return bernoulli_terms;
-    }
-
-    // second-order terms: 1/12 [[V_N, sigma], sigma] + 1/4 [[V, sigma]_R, sigma] + 1/4 [[V_R, sigma]_R, sigma]
-    tmp.clear();
-    tmp = get_bernoulli_operator_terms_2(factor, targets, ops);
-    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-
-    if ( max_order == 2 ) {
-        return bernoulli_terms;
-    }
-
-    // third-order terms: 
-    tmp.clear();
-    tmp = get_bernoulli_operator_terms_3(factor, targets, ops);
-    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-
-    if ( max_order == 3 ) {
-        return bernoulli_terms;
-    }
-
-    // fourth-order terms: 
-    tmp.clear();
-    tmp = get_bernoulli_operator_terms_4(factor, targets, ops);
-    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-
-
-    if ( max_order == 4 ) {
-        return bernoulli_terms;
-    }
-
-    // fifth-order terms: 
-    tmp.clear();
-    tmp = get_bernoulli_operator_terms_5(factor, targets, ops);
-    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-
-    if ( max_order == 5 ) {
-        return bernoulli_terms;
-    }
-
-    // sixth-order terms: 
-    tmp.clear();
-    tmp = get_bernoulli_operator_terms_6(factor, targets, ops);
-    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-
-    return bernoulli_terms;
-}
-
-// first-order bernoulli terms: 1/2 [v, sigma] + 1/2 [v_R, sigma]
-std::vector<pq_operator_terms> pq_helper::get_bernoulli_operator_terms_1(double factor, const std::vector<std::string> &targets,const std::vector<std::string> &ops) {
-
-    std::vector<pq_operator_terms> bernoulli_terms;
-
-    // mutable copies of targets and ops
-    std::vector<std::string> b_targets;
-    std::vector<std::string> b_ops;
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops.push_back(op + "{A,A}");
-    }
-
-    int dim = (int)ops.size();
-
-    for (int i = 0; i < dim; i++) {
-        std::vector<pq_operator_terms> tmp = get_commutator_terms(0.5 * factor, b_targets, {b_ops[i]});
-        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-    }
-
-    b_targets.clear();
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,A}");
-    }
-
-    b_ops.clear();
-    for (auto op: ops){
-        b_ops.push_back(op + "{A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        std::vector<pq_operator_terms> tmp = get_commutator_terms(0.5 * factor, b_targets, {b_ops[i]});
-        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-    }
-
-    return bernoulli_terms;
-}
-
-// second-order bernoulli terms: 1/12 [[V_N, sigma], sigma] + 1/4 [[V, sigma]_R, sigma] + 1/4 [[V_R, sigma]_R, sigma]
-std::vector<pq_operator_terms> pq_helper::get_bernoulli_operator_terms_2(double factor, const std::vector<std::string> &targets,const std::vector<std::string> &ops) {
-
-    std::vector<pq_operator_terms> bernoulli_terms;
-
-    // mutable copies of targets and ops
-    std::vector<std::string> b_targets;
-    std::vector<std::string> b_ops1;
-    std::vector<std::string> b_ops2;
-
-    // 1/12 [[V_N, sigma], sigma]
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,A}");
-        b_ops2.push_back(op + "{A,A,A}");
-    }
-
-    int dim = (int)ops.size();
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            std::vector<pq_operator_terms> tmp = get_double_commutator_terms(1.0 / 12.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]});
-            bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        }
-    }
-
-    // 1/4 [[V, sigma]_R, sigma]
-    b_targets.clear();
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,A}");
-    }
-
-    b_ops1.clear();
-    b_ops2.clear();
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A}");
-        b_ops2.push_back(op + "{A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            std::vector<pq_operator_terms> tmp = get_double_commutator_terms(1.0 / 4.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]});
-            bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        }
-    }
-
-    // 1/4 [[V_R, sigma]_R, sigma]
-    b_targets.clear();
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,A}");
-    }
-
-    b_ops1.clear();
-    b_ops2.clear();
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A}");
-        b_ops2.push_back(op + "{A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            std::vector<pq_operator_terms> tmp = get_double_commutator_terms(1.0 / 4.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]});
-            bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        }
-    }
-
-    return bernoulli_terms;
-}
-
-// third-order bernoulli terms
-std::vector<pq_operator_terms> pq_helper::get_bernoulli_operator_terms_3(double factor, const std::vector<std::string> &targets,const std::vector<std::string> &ops) {
-
-    std::vector<pq_operator_terms> bernoulli_terms;
-
-    // mutable copies of targets and ops
-    std::vector<std::string> b_targets;
-    std::vector<std::string> b_ops1;
-    std::vector<std::string> b_ops2;
-    std::vector<std::string> b_ops3;
+    size_t dim = ops.size();
+    if ( dim == 0 ) return bernoulli_terms;
 
-    // 1/24 [[[V_N, sigma], sigma]_R, sigma]
+    for (int order = 1; order <= max_order; order++) {
+        for (const bernoulli_commutator & commutator : get_bernoulli_commutators(order)) {
 
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,A}");
-    }
+            // the targets carry every portion. the kth operator in the commutator is not part of
+            // the first k portions, so it carries "A" for those
+            std::vector<std::vector<std::string> > b_ops(order + 1);
+            for (int k = 0; k <= order; k++) {
+                std::string portions = "{";
+                for (int l = 0; l <= order; l++) {
+                    if ( l > 0 ) portions += ",";
+                    portions += l < k ? "A" : commutator.portions[l];
+                }
+                portions += "}";
 
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,A}");
-        b_ops2.push_back(op + "{A,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A}");
-    }
+                const std::vector<std::string> & source = k == 0 ? targets : ops;
+                for (const std::string & op : source) {
+                    b_ops[k].push_back(op + portions);
+                }
+            }
 
-    int dim = (int)ops.size();
+            // sum over the operators at each level of the commutator
+            std::vector<size_t> choice(order, 0);
+            while ( true ) {
 
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                std::vector<pq_operator_terms> tmp = get_triple_commutator_terms(1.0 / 24.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]});
+                std::vector<std::vector<std::string> > nested = {b_ops[0]};
+                for (int k = 1; k <= order; k++) {
+                    nested.push_back({b_ops[k][choice[k - 1]]});
+                }
+                std::vector<pq_operator_terms> tmp = get_nested_commutator_terms(commutator.factor * factor, nested);
                 bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
+
+                int level = order - 1;
+                while ( level >= 0 && ++choice[level] == dim ) {
+                    choice[level--] = 0;
+                }
+                if ( level < 0 ) break;
             }
         }
     }
 
-    // 1/8 [[[V_R, sigma]_R, sigma]_R, sigma]
-
-    b_targets.clear();
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,A}");
-    }
-
-    b_ops1.clear();
-    b_ops2.clear();
-    b_ops3.clear();
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                std::vector<pq_operator_terms> tmp = get_triple_commutator_terms(1.0 / 8.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]});
-                bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-            }
-        }
-    }
-
-    // 1/8 [[[V, sigma]_R, sigma]_R, sigma]
-
-    b_targets.clear();
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,A}");
-    }
-
-    b_ops1.clear();
-    b_ops2.clear();
-    b_ops3.clear();
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                std::vector<pq_operator_terms> tmp = get_triple_commutator_terms(1.0 / 8.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]});
-                bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-            }
-        }
-    }
-
-    // -1/24 [[[V, sigma]_R, sigma], sigma]
-
-    b_targets.clear();
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,A,A}");
-    }
-
-    b_ops1.clear();
-    b_ops2.clear();
-    b_ops3.clear();
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,A}");
-        b_ops2.push_back(op + "{A,A,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                std::vector<pq_operator_terms> tmp = get_triple_commutator_terms(-1.0 / 24.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]});
-                bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-            }
-        }
-    }
-
-    // -1/24 [[[V_R, sigma]_R, sigma], sigma]
-
-    b_targets.clear();
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,A,A}");
-    }
-
-    b_ops1.clear();
-    b_ops2.clear();
-    b_ops3.clear();
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,A}");
-        b_ops2.push_back(op + "{A,A,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                std::vector<pq_operator_terms> tmp = get_triple_commutator_terms(-1.0 / 24.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]});
-                bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-            }
-        }
-    }
-
-    return bernoulli_terms;
-}
-
-// fourth-order bernoulli terms
-std::vector<pq_operator_terms> pq_helper::get_bernoulli_operator_terms_4(double factor, const std::vector<std::string> &targets,const std::vector<std::string> &ops) {
-
-    std::vector<pq_operator_terms> bernoulli_terms;
-
-    // mutable copies of targets and ops
-    std::vector<std::string> b_targets;
-    std::vector<std::string> b_ops1;
-    std::vector<std::string> b_ops2;
-    std::vector<std::string> b_ops3;
-    std::vector<std::string> b_ops4;
-
-
-    // 1/16 [[[[V_R, sigma]_R, sigma]_R, sigma]_R, sigma]
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A}");
-    }
-
-    int dim = (int)ops.size();
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    std::vector<pq_operator_terms> tmp = get_quadruple_commutator_terms(1.0 / 16.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]});
-                    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-                }
-            }
-        }
-    }
-
-    // 1/16 [[[[V, sigma]_R, sigma]_R, sigma]_R, sigma]
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    std::vector<pq_operator_terms> tmp = get_quadruple_commutator_terms(1.0 / 16.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]});
-                    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-                }
-            }
-        }
-    }
-
-    // 1/48 [[[[V_N, sigma], sigma]_R, sigma]_R, sigma]
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    std::vector<pq_operator_terms> tmp = get_quadruple_commutator_terms(1.0 / 48.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]});
-                    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-                }
-            }
-        }
-    }
-
-
-    // -1/48 [[[[V, sigma]_R, sigma], sigma]_R, sigma]
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,A}");
-        b_ops2.push_back(op + "{A,A,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    std::vector<pq_operator_terms> tmp = get_quadruple_commutator_terms(-1.0 / 48.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]});
-                    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-                }
-            }
-        }
-    }
-
-
-    // -1/48 [[[[V_R, sigma]_R, sigma], sigma]_R, sigma]
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,A}");
-        b_ops2.push_back(op + "{A,A,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    std::vector<pq_operator_terms> tmp = get_quadruple_commutator_terms(-1.0 / 48.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]});
-                    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-                }
-            }
-        }
-    }
-
-
-    // -1/144 [[[[V_N, sigma], sigma]_R, sigma], sigma]
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    std::vector<pq_operator_terms> tmp = get_quadruple_commutator_terms(-1.0 / 144.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]});
-                    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-                }
-            }
-        }
-    }
-
-
-    // -1/48 [[[[V, sigma]_R, sigma]_R, sigma], sigma]
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    std::vector<pq_operator_terms> tmp = get_quadruple_commutator_terms(-1.0 / 48.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]});
-                    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-                }
-            }
-        }
-    }
-
-
-    // -1/48 [[[[V_R, sigma]_R, sigma]_R, sigma], sigma]
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    std::vector<pq_operator_terms> tmp = get_quadruple_commutator_terms(-1.0 / 48.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]});
-                    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-                }
-            }
-        }
-    }
-
-
-    // -1/720 [[[[V_N, sigma], sigma], sigma], sigma]
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,A,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,A,A,A}");
-        b_ops2.push_back(op + "{A,A,A,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    std::vector<pq_operator_terms> tmp = get_quadruple_commutator_terms(-1.0 / 720.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]});
-                    bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-                }
-            }
-        }
-    }
-
-    return bernoulli_terms;
-}
-
-// fifth-order bernoulli terms
-std::vector<pq_operator_terms> pq_helper::get_bernoulli_operator_terms_5(double factor, const std::vector<std::string> &targets,const std::vector<std::string> &ops) {
-
-    std::vector<pq_operator_terms> bernoulli_terms;
-
-    // mutable copies of targets and ops
-    std::vector<std::string> b_targets;
-    std::vector<std::string> b_ops1;
-    std::vector<std::string> b_ops2;
-    std::vector<std::string> b_ops3;
-    std::vector<std::string> b_ops4;
-    std::vector<std::string> b_ops5;
-
-    //  1/32   [[[[[V_A, sigma]_R, sigma]_R, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    int dim = (int)ops.size();
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(1.0 / 32.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-    //  1/32   [[[[[V_R, sigma]_R, sigma]_R, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(1.0 / 32.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-    // -1/96   [[[[[V_A, sigma]_R, sigma]_A, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,A,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,R,A}");
-        b_ops2.push_back(op + "{A,A,A,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(-1.0 / 96.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    // -1/96   [[[[[V_R, sigma]_R, sigma]_A, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,A,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,R,A}");
-        b_ops2.push_back(op + "{A,A,A,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(-1.0 / 96.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    // -1/96   [[[[[V_A, sigma]_R, sigma]_R, sigma]_A, sigma]_R, sigma]_A 
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A,R,A}");
-        b_ops2.push_back(op + "{A,A,R,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(-1.0 / 96.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    // -1/96   [[[[[V_R, sigma]_R, sigma]_R, sigma]_A, sigma]_R, sigma]_A 
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A,R,A}");
-        b_ops2.push_back(op + "{A,A,R,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(-1.0 / 96.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    // -1/96   [[[[[V_A, sigma]_R, sigma]_R, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(-1.0 / 96.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    // -1/96   [[[[[V_R, sigma]_R, sigma]_R, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(-1.0 / 96.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    //  1/288  [[[[[V_A, sigma]_R, sigma]_A, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,A,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,A,A}");
-        b_ops2.push_back(op + "{A,A,A,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(1.0 / 288.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    //  1/288  [[[[[V_R, sigma]_R, sigma]_A, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,A,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,A,A}");
-        b_ops2.push_back(op + "{A,A,A,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(1.0 / 288.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    //  1/1440 [[[[[V_A, sigma]_R, sigma]_A, sigma]_A, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,A,A,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,A,A,A}");
-        b_ops2.push_back(op + "{A,A,A,A,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(1.0 / 1440.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    //  1/1440 [[[[[V_R, sigma]_R, sigma]_A, sigma]_A, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,A,A,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,A,A,A}");
-        b_ops2.push_back(op + "{A,A,A,A,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(1.0 / 1440.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    // -1/1440 [[[[[V_N, sigma]_A, sigma]_A, sigma]_A, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,A,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,A,A,R,A}");
-        b_ops2.push_back(op + "{A,A,A,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(-1.0 / 1440.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    //  1/96   [[[[[V_N, sigma]_A, sigma]_R, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(1.0 / 96.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    // -1/288  [[[[[V_N, sigma]_A, sigma]_R, sigma]_A, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,A,R,A}");
-        b_ops2.push_back(op + "{A,A,R,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(-1.0 / 288.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-    // -1/288  [[[[[V_N, sigma]_A, sigma]_R, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_quintuple_commutator_terms(-1.0 / 288.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-		    }
-                }
-            }
-        }
-    }
-
-
-
-
-    return bernoulli_terms;
-}
-
-// sixth-order bernoulli terms
-std::vector<pq_operator_terms> pq_helper::get_bernoulli_operator_terms_6(double factor, const std::vector<std::string> &targets,const std::vector<std::string> &ops) {
-
-    std::vector<pq_operator_terms> bernoulli_terms;
-
-    // mutable copies of targets and ops
-    std::vector<std::string> b_targets;
-    std::vector<std::string> b_ops1;
-    std::vector<std::string> b_ops2;
-    std::vector<std::string> b_ops3;
-    std::vector<std::string> b_ops4;
-    std::vector<std::string> b_ops5;
-    std::vector<std::string> b_ops6;
-
-
-    //     1/64    [[[[[[V_A, sigma]_R, sigma]_R, sigma]_R, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,R,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    int dim = (int)ops.size();
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 64.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/64    [[[[[[V_R, sigma]_R, sigma]_R, sigma]_R, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,R,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 64.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/192   [[[[[[V_A, sigma]_R, sigma]_A, sigma]_R, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,A,R,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,R,R,A}");
-        b_ops2.push_back(op + "{A,A,A,R,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 192.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/192   [[[[[[V_R, sigma]_R, sigma]_A, sigma]_R, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,A,R,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,R,R,A}");
-        b_ops2.push_back(op + "{A,A,A,R,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 192.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/192   [[[[[[V_A, sigma]_R, sigma]_R, sigma]_A, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,A,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,A,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 192.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/192   [[[[[[V_R, sigma]_R, sigma]_R, sigma]_A, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,A,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,A,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 192.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/192   [[[[[[V_A, sigma]_R, sigma]_R, sigma]_R, sigma]_A, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,R,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,A,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 192.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/192   [[[[[[V_R, sigma]_R, sigma]_R, sigma]_R, sigma]_A, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,R,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,A,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 192.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/576   [[[[[[V_A, sigma]_R, sigma]_A, sigma]_R, sigma]_A, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,A,R,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,A,R,A}");
-        b_ops2.push_back(op + "{A,A,A,R,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 576.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/576   [[[[[[V_R, sigma]_R, sigma]_A, sigma]_R, sigma]_A, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,A,R,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,A,R,A}");
-        b_ops2.push_back(op + "{A,A,A,R,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 576.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/2880  [[[[[[V_A, sigma]_R, sigma]_A, sigma]_A, sigma]_A, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,A,A,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,A,A,R,A}");
-        b_ops2.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 2880.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/2880  [[[[[[V_R, sigma]_R, sigma]_A, sigma]_A, sigma]_A, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,A,A,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,A,A,R,A}");
-        b_ops2.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 2880.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/192   [[[[[[V_A, sigma]_R, sigma]_R, sigma]_R, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,R,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,R,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 192.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/192   [[[[[[V_R, sigma]_R, sigma]_R, sigma]_R, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,R,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,R,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,R,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 192.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/576   [[[[[[V_A, sigma]_R, sigma]_A, sigma]_R, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,A,R,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,R,A,A}");
-        b_ops2.push_back(op + "{A,A,A,R,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 576.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/576   [[[[[[V_R, sigma]_R, sigma]_A, sigma]_R, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,A,R,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,A,R,R,A,A}");
-        b_ops2.push_back(op + "{A,A,A,R,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 576.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/576   [[[[[[V_A, sigma]_R, sigma]_R, sigma]_A, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,A,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,A,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 576.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/576   [[[[[[V_R, sigma]_R, sigma]_R, sigma]_A, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,A,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,A,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 576.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/2880  [[[[[[V_A, sigma]_R, sigma]_R, sigma]_A, sigma]_A, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{A,R,R,A,A,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A,A,A,A}");
-        b_ops2.push_back(op + "{A,A,R,A,A,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 2880.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/2880  [[[[[[V_R, sigma]_R, sigma]_R, sigma]_A, sigma]_A, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{R,R,R,A,A,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,R,R,A,A,A,A}");
-        b_ops2.push_back(op + "{A,A,R,A,A,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 2880.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/30240 [[[[[[V_N, sigma]_A, sigma]_A, sigma]_A, sigma]_A, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,A,A,A,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops2.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 30240.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/2880  [[[[[[V_N, sigma]_A, sigma]_A, sigma]_A, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,A,A,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops2.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 2880.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/192   [[[[[[V_N, sigma]_A, sigma]_R, sigma]_R, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,R,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,R,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 192.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/576   [[[[[[V_N, sigma]_A, sigma]_R, sigma]_A, sigma]_R, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,A,R,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,A,R,R,A}");
-        b_ops2.push_back(op + "{A,A,R,A,R,R,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 576.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/576   [[[[[[V_N, sigma]_A, sigma]_R, sigma]_R, sigma]_A, sigma]_R, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,R,A,R,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,R,A,R,A}");
-        b_ops2.push_back(op + "{A,A,R,R,A,R,A}");
-        b_ops3.push_back(op + "{A,A,A,R,A,R,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,R,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 576.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/8640  [[[[[[V_N, sigma]_A, sigma]_A, sigma]_A, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,A,A,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops2.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 8640.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //    -1/576   [[[[[[V_N, sigma]_A, sigma]_R, sigma]_R, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,R,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,R,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,R,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,R,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(-1.0 / 576.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/1728  [[[[[[V_N, sigma]_A, sigma]_R, sigma]_A, sigma]_R, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,A,R,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,A,R,A,A}");
-        b_ops2.push_back(op + "{A,A,R,A,R,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,R,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 1728.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-    //     1/8640  [[[[[[V_N, sigma]_A, sigma]_R, sigma]_A, sigma]_A, sigma]_A, sigma]_A
-
-    for (auto target: targets){
-        b_targets.push_back(target + "{N,A,R,A,A,A,A}");
-    }
-
-    for (auto op: ops){
-        b_ops1.push_back(op + "{A,A,R,A,A,A,A}");
-        b_ops2.push_back(op + "{A,A,R,A,A,A,A}");
-        b_ops3.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops4.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops5.push_back(op + "{A,A,A,A,A,A,A}");
-        b_ops6.push_back(op + "{A,A,A,A,A,A,A}");
-    }
-
-    for (int i = 0; i < dim; i++) {
-        for (int j = 0; j < dim; j++) {
-            for (int k = 0; k < dim; k++) {
-                for (int l = 0; l < dim; l++) {
-                    for (int l = 0; l < dim; l++) {
-                        std::vector<pq_operator_terms> tmp = get_hextuple_commutator_terms(1.0 / 8640.0 * factor, b_targets, {b_ops1[i]}, {b_ops2[j]}, {b_ops3[k]}, {b_ops4[l]}, {b_ops5[l]}, {b_ops6[l]});
-                        bernoulli_terms.insert(std::end(bernoulli_terms), std::begin(tmp), std::end(tmp));
-        	    }
-                }
-            }
-        }
-    }
-
-
-
-    return bernoulli_terms;
+    return merge_operator_terms(bernoulli_terms);
 }
 
 } // End namespaces
@@ -25,9 +25,12 @@
 #define PQ_HELPER_H
 
 #include "pq_string.h"
+#include "pq_utils.h"
 
 namespace pdaggerq {
 
+class pq_mapped_file;
+
 class pq_operator_terms {
   public:
     pq_operator_terms(double in_factor, std::vector<std::string> in_operators):
@@ -38,6 +41,60 @@ class pq_operator_terms {
     double get_factor() { return factor; }
     double factor;
     std::vector<std::string> operators;
+
+    /**
+     *
+     * when nonzero, only terms in which each operator after the first n_connected_targets
+     * operators is contracted with at least one of those operators are generated
+     *
+     */
+    size_t n_connected_targets = 0;
+};
+
+/**
+ *
+ * the final strings of a pq_helper as flat numeric arrays (see pq_helper::term_arrays). term t
+ * holds tensors tensor_offsets[t] to tensor_offsets[t+1] - 1 and permutation operators
+ * permutation_offsets[t] to permutation_offsets[t+1] - 1. tensor n has labels
+ * label_offsets[n] to label_offsets[n+1] - 1, and permutation operator n has labels
+ * permutation_label_offsets[n] to permutation_label_offsets[n+1] - 1. tensors appear in the
+ * same order as in pq_helper::strings()
+ *
+ */
+class pq_term_arrays {
+  public:
+
+    // one per term: the signed factor
+    std::vector<double> factors;
+
+    // n_terms + 1 entries
+    std::vector<int64_t> tensor_offsets;
+    std::vector<int64_t> permutation_offsets;
+
+    // one per tensor: the position of its name in tensor_names (e.g., "eri", "fock", "t2",
+    // "t1_1p", "d" for delta functions, "a*" / "a" for fermion operators, "B*" / "B", "w0")
+    std::vector<int32_t> tensor_types;
+
+    // n_tensors + 1 entries
+    std::vector<int64_t> label_offsets;
+
+    // one per tensor label: the interned label (see pq_label.h), and the position of its spin
+    // label or label range in block_names (-1 for strings that are not blocked)
+    std::vector<uint32_t> labels;
+    std::vector<int32_t> label_blocks;
+
+    // one per permutation operator: 0 for P, 1 for PP2, 2 for PP3, 3 for PP6
+    std::vector<int32_t> permutation_types;
+
+    // n_permutations + 1 entries
+    std::vector<int64_t> permutation_label_offsets;
+
+    // the interned labels permuted by each operator
+    std::vector<uint32_t> permutation_labels;
+
+    // names for tensor_types and label_blocks
+    std::vector<std::string> tensor_names;
+    std::vector<std::string> block_names;
 };
 
 class pq_helper {
@@ -49,9 +106,11 @@ class pq_helper {
      * constructor
      *
      * @param vacuum_type: normal order is defined with respect to the TRUE vacuum or the FERMI vacuum
+     * @param engine: how strings are brought to normal order: by pairwise operator SWAPs (default) or,
+     *                for the FERMI vacuum only, by enumerating full contractions directly (WICK)
      *
      */
-    explicit pq_helper(const std::string &vacuum_type = "");
+    explicit pq_helper(const std::string &vacuum_type = "", const std::string &engine = "");
 
     /**
      *
@@ -195,9 +254,24 @@ class pq_helper {
      *
      * @param excitation_level: the maximum excitation level for "N" type operators (default 2)
      *
+     * a std::runtime_error is thrown if bernoulli products were pruned with another level and
+     * have not been through simplify() yet
+     *
      */
     void set_bernoulli_excitation_level(int excitation_level);
 
+    /**
+     *
+     * set whether operator products in the Bernoulli expansion that cannot contribute (see
+     * operator_portions_vanish) are skipped before they are brought to normal order. the
+     * products are pruned with the current bernoulli excitation level, which then cannot change
+     * until simplify() has been called; with that, the final strings are the same either way
+     *
+     * @param do_prune: true/false (default true)
+     *
+     */
+    void set_prune_operator_portions(bool do_prune);
+
     /**
      *
      * set whether we should search for paired ov permutations that arise in ccsdt
@@ -234,6 +308,16 @@ class pq_helper {
      */
     void add_operator_product(double factor, std::vector<std::string> in);
 
+    /**
+     *
+     * add a sum of operator products. strings for the individual products are built and
+     * brought to normal order in parallel, and the results are added in the order of terms
+     *
+     * @param terms: the operator products and their factors
+     *
+     */
+    void add_operator_products(const std::vector<pq_operator_terms> &terms);
+
     /**
      *
      * add a similarity-transformed operator using the BCH expansion and four nested commutators
@@ -242,12 +326,14 @@ class pq_helper {
      * @param targets: a list of strings defining the operator product to be transformed (here, f)
      * @param ops: a list of strings defining a sum of operators that define the transformation (here, T)
      * @param do_operators_commute: do the operators that define the similarity transformation commute?
+     * @param connected_only: generate the connected products (f exp(T))_C directly rather than the nested commutators
      *
      */
     void add_st_operator(double factor, 
                          const std::vector<std::string> &targets,
                          const std::vector<std::string> &ops,
-                         bool do_operators_commute);
+                         bool do_operators_commute,
+                         bool connected_only = false);
 
     /**
      *
@@ -257,12 +343,17 @@ class pq_helper {
      * @param targets: a list of strings defining the operator product to be transformed (here, f)
      * @param ops: a list of strings defining a sum of operators that define the transformation (here, T)
      * @param do_operators_commute: do the operators that define the similarity transformation commute?
+     * @param connected_only: generate the connected products (f exp(T))_C directly rather than the nested commutators.
+     *                        each product f T_i T_j ... appears once, and the product is brought to normal order
+     *                        with the wick engine, which only enumerates contractions in which every T is contracted
+     *                        with f. this mode requires the fermi vacuum and fermionic, non-unitary cluster operators
      *
      */
     std::vector<pq_operator_terms> get_st_operator_terms(double factor, 
                                                          const std::vector<std::string> &targets,
                                                          const std::vector<std::string> &ops,
-                                                         bool do_operators_commute);
+                                                         bool do_operators_commute,
+                                                         bool connected_only = false);
 
     /**
      *
@@ -282,7 +373,8 @@ class pq_helper {
     /**
      *
      * generate list of terms resulting from the Bernoulli-number representation of the similarity-transformed operator expanded
-     * to a order max_order
+     * to a order max_order. the nested commutators at each order are generated by get_bernoulli_commutators, so any order is
+     * supported
      *
      * @param targets: a list of strings defining the operator product to be transformed (here, f)
      * @param ops: a list of strings defining a sum of operators that define the transformation (here, T)
@@ -293,78 +385,6 @@ class pq_helper {
                                                                 const std::vector<std::string> &targets,
                                                                 const std::vector<std::string> &ops,
                                                                 const int max_order);
-    /**
-     *
-     * generate list of first-order terms from the Bernoulli-number representation of the similarity-transformed operator
-     *
-     * @param targets: a list of strings defining the operator product to be transformed (here, f)
-     * @param ops: a list of strings defining a sum of operators that define the transformation (here, T)
-     *
-     */
-    std::vector<pq_operator_terms> get_bernoulli_operator_terms_1(double factor, 
-                                                                  const std::vector<std::string> &targets,
-                                                                  const std::vector<std::string> &ops);
-
-    /**
-     *
-     * generate list of second-order terms from the Bernoulli-number representation of the similarity-transformed operator
-     *
-     * @param targets: a list of strings defining the operator product to be transformed (here, f)
-     * @param ops: a list of strings defining a sum of operators that define the transformation (here, T)
-     *
-     */
-    std::vector<pq_operator_terms> get_bernoulli_operator_terms_2(double factor, 
-                                                                  const std::vector<std::string> &targets,
-                                                                  const std::vector<std::string> &ops);
-
-    /**
-     *
-     * generate list of third-order terms from the Bernoulli-number representation of the similarity-transformed operator
-     *
-     * @param targets: a list of strings defining the operator product to be transformed (here, f)
-     * @param ops: a list of strings defining a sum of operators that define the transformation (here, T)
-     *
-     */
-    std::vector<pq_operator_terms> get_bernoulli_operator_terms_3(double factor, 
-                                                                  const std::vector<std::string> &targets,
-                                                                  const std::vector<std::string> &ops);
-
-    /**
-     *
-     * generate list of fourth-order terms from the Bernoulli-number representation of the similarity-transformed operator
-     *
-     * @param targets: a list of strings defining the operator product to be transformed (here, f)
-     * @param ops: a list of strings defining a sum of operators that define the transformation (here, T)
-     *
-     */
-    std::vector<pq_operator_terms> get_bernoulli_operator_terms_4(double factor, 
-                                                                  const std::vector<std::string> &targets,
-                                                                  const std::vector<std::string> &ops);
-
-    /**
-     *
-     * generate list of fifth-order terms from the Bernoulli-number representation of the similarity-transformed operator
-     *
-     * @param targets: a list of strings defining the operator product to be transformed (here, f)
-     * @param ops: a list of strings defining a sum of operators that define the transformation (here, T)
-     *
-     */
-    std::vector<pq_operator_terms> get_bernoulli_operator_terms_5(double factor, 
-                                                                  const std::vector<std::string> &targets,
-                                                                  const std::vector<std::string> &ops);
-
-    /**
-     *
-     * generate list of sixth-order terms from the Bernoulli-number representation of the similarity-transformed operator
-     *
-     * @param targets: a list of strings defining the operator product to be transformed (here, f)
-     * @param ops: a list of strings defining a sum of operators that define the transformation (here, T)
-     *
-     */
-    std::vector<pq_operator_terms> get_bernoulli_operator_terms_6(double factor, 
-                                                                  const std::vector<std::string> &targets,
-                                                                  const std::vector<std::string> &ops);
-
 
     /**
      *
@@ -575,7 +595,30 @@ class pq_helper {
 
     /**
      *
-     * cancel terms, if possible, and identify permutations of non-summed labels
+     * add a nested commutator of any depth, [[[op0, op1], op2], ... , opn]. identical operator products
+     * in the expansion are combined, and products whose factors cancel are dropped, before they are
+     * brought to normal order
+     *
+     * @param ops: a list of operator products, {op0, op1, ..., opn}
+     *
+     */
+    void add_nested_commutator(double factor, const std::vector<std::vector<std::string> > &ops);
+
+    /**
+     *
+     * generate a list of operators resulting from a nested commutator of any depth, [[[op0, op1], op2], ... , opn]
+     *
+     * @param ops: a list of operator products, {op0, op1, ..., opn}
+     *
+     */
+    std::vector<pq_operator_terms> get_nested_commutator_terms(double factor,
+                                                               const std::vector<std::vector<std::string> > &ops);
+
+    /**
+     *
+     * cancel terms, if possible, and identify permutations of non-summed labels. strings that
+     * were simplified by an earlier call are not processed again; only the strings added since
+     * are simplified and then merged into the existing result
      *
      */
     void simplify();
@@ -596,6 +639,14 @@ class pq_helper {
      */
     std::vector<std::vector<std::string> > strings() const;
 
+    /**
+     *
+     * get the same strings as strings(), as flat arrays of factors, tensor types, interned labels,
+     * and permutation operators rather than formatted text
+     *
+     */
+    pq_term_arrays term_arrays() const;
+
     /**
      *
      * this function is used to block strings by spin
@@ -622,7 +673,31 @@ class pq_helper {
 
     /**
      *
-     * serializes the pq_helper object
+     * have the strings been blocked by spin (block_by_spin) or by label ranges (block_by_range)?
+     *
+     */
+    bool is_blocked_by_spin() const { return is_spin_blocked; }
+    bool is_blocked_by_range() const { return is_range_blocked; }
+
+    /**
+     *
+     * cache simplified results on disk. while a cache directory is set, operator products are
+     * only recorded when they are added. simplify() then looks for a saved result keyed by a
+     * hash of the pdaggerq build, the vacuum, the engine, the added products, and the settings
+     * they were added under, and it only brings the products to normal order (and saves the
+     * result) on a miss. a saved result is used only if the full description stored with it
+     * matches. products added before the cache directory was set are not recorded, so results
+     * are not cached again until the next clear(). a result that cannot be saved (e.g., the
+     * directory is missing or not writable) is not cached, and simplify() still completes
+     *
+     * @param directory: an existing directory for cached results (an empty string disables the cache)
+     *
+     */
+    void set_cache_directory(const std::string &directory);
+
+    /**
+     *
+     * serializes the pq_helper object in the indexed binary format (see pq_serialize.h)
      * @param filename: the name of the file to which the pq_helper object is serialized
      *
      */
@@ -630,14 +705,159 @@ class pq_helper {
 
     /**
      *
-     * deserializes the pq_helper object
+     * deserializes the pq_helper object. files in the indexed format are memory mapped; files
+     * written by earlier versions of pdaggerq are read as a stream
      * @param filename: the name of the file from which the pq_helper object is deserialized
      *
      */
     void deserialize(const std::string & filename);
 
+    /**
+     *
+     * deserializes the settings and one spin block of a spin-blocked pq_helper object. only the
+     * blocked strings whose non-summed spin labels match spin_labels are read from the file
+     * @param filename: the name of the file from which the pq_helper object is deserialized
+     * @param spin_labels: the non-summed spin labels that were passed to block_by_spin
+     *
+     */
+    void deserialize(const std::string & filename, const std::unordered_map<std::string, std::string> &spin_labels);
+
 private:
 
+    /**
+     *
+     * deserializes a pq_helper object saved before the indexed format was introduced
+     * @param filename: the name of the file from which the pq_helper object is deserialized
+     *
+     */
+    void deserialize_legacy(const std::string & filename);
+
+    /**
+     *
+     * read the settings of a pq_helper object from a mapped file
+     * @param file: the mapped file
+     * @return: the cache description saved with the strings (empty if there is none)
+     *
+     */
+    std::string deserialize_settings(const pq_mapped_file &file);
+
+    /**
+     *
+     * deserializes a result saved by simplify() with a cache directory set, provided that it was
+     * built from the given products (see cache_description)
+     * @param filename: the name of the file from which the pq_helper object is deserialized
+     * @param description: the description that must be stored in the file
+     * @return: true if the file matched and its strings were loaded
+     *
+     */
+    bool deserialize_cached(const std::string & filename, const std::string & description);
+
+    /**
+     *
+     * write the pq_helper object in the indexed binary format (see serialize)
+     * @param filename: the name of the file to which the pq_helper object is written
+     * @return: false if the file could not be opened or written
+     *
+     */
+    bool write_serialized(const std::string & filename) const;
+
+    /**
+     *
+     * the build, vacuum, engine, and cache_history that key a cached result
+     *
+     */
+    std::string cache_description() const;
+
+    /**
+     *
+     * build the strings for a sum of operator products and bring them to normal order
+     * (see add_operator_products)
+     *
+     * @param terms: the operator products and their factors
+     *
+     */
+    void generate_operator_products(const std::vector<pq_operator_terms> &terms);
+
+    /**
+     *
+     * bring operator products recorded while a cache directory was set to normal order
+     *
+     */
+    void generate_pending_products();
+
+    /**
+     *
+     * apply delta functions, etc., and cancel terms (see simplify)
+     *
+     */
+    void simplify_strings();
+
+    /**
+     *
+     * operator products that have been recorded but not yet brought to normal order, along
+     * with the settings they were added under
+     *
+     */
+    struct pending_operator_products {
+        std::vector<pq_operator_terms> terms;
+        std::vector<std::vector<std::string> > left_operators;
+        std::vector<std::vector<std::string> > right_operators;
+        std::string left_operators_type;
+        std::string right_operators_type;
+        bool is_unitary_cc;
+        bool find_paired_permutations;
+    };
+    std::vector<pending_operator_products> pending_products;
+
+    /**
+     *
+     * the directory for cached results (empty if results are not cached)
+     *
+     */
+    std::string cache_directory;
+
+    /**
+     *
+     * a description of everything that has been added since the last clear(), which keys the
+     * cache. it is not valid after deserialize(), which does not record how the strings came about
+     *
+     */
+    std::string cache_history;
+    bool cache_history_valid = true;
+
+    /**
+     *
+     * split fluctuation potential operators (v -> j1 + j2) and cluster operators (t -> te [+ td])
+     * in a product of operators
+     *
+     * @param factor: the factor multiplying the product
+     * @param in: the operator product
+     * @param products: a list to which the expanded products are added
+     *
+     */
+    void expand_operator_product(double factor, std::vector<std::string> in, std::vector<pq_operator_terms> &products);
+
+    /**
+     *
+     * build the string for left_operator * save * right_operator and bring it to normal order.
+     * this function does not modify the pq_helper, so it can be called from several threads
+     *
+     * @param factor: the factor multiplying the product
+     * @param left_operator: the operators defining the bra state
+     * @param save: the (expanded) operator product
+     * @param right_operator: the operators defining the ket state
+     * @param n_connected_targets: if nonzero, generate only terms in which each operator in save after the first
+     *                             n_connected_targets is contracted with one of those operators
+     * @param list: a list to which the normal-ordered strings are added
+     *
+     */
+    void add_operator_product_to_list(double factor,
+                                      const std::vector<std::string> &left_operator,
+                                      const std::vector<std::string> &save,
+                                      const std::vector<std::string> &right_operator,
+                                      size_t n_connected_targets,
+                                      std::vector<std::shared_ptr<pq_string> > &list) const;
+
     /**
      *
      * a list of strings of operators/amplitudes/integrals/deltas
@@ -646,6 +866,23 @@ private:
     std::vector< std::shared_ptr<pq_string> > ordered;
     std::vector< std::shared_ptr<pq_string> > ordered_blocked;
 
+    /**
+     *
+     * the strings in ordered that have been through simplify(), indexed so that a later call only
+     * compares them with the strings added since. rebuilt from ordered when it is empty
+     *
+     */
+    pq_string_index consolidated;
+
+    /**
+     *
+     * have the strings in ordered_blocked been blocked by spin or by label ranges? strings are
+     * printed with spin labels or label ranges accordingly
+     *
+     */
+    bool is_spin_blocked = false;
+    bool is_range_blocked = false;
+
     /**
      *
      * the vacuum type ("TRUE" or "FERMI")
@@ -653,6 +890,13 @@ private:
      */
     std::string vacuum;
 
+    /**
+     *
+     * the normal-ordering engine ("SWAP" or "WICK")
+     *
+     */
+    std::string engine;
+
     /**
      *
      * the print level
@@ -730,6 +974,20 @@ private:
      */
     int bernoulli_excitation_level = 2;
 
+    /**
+     *
+     * skip operator products whose Bernoulli portions rule out every term?
+     *
+     */
+    bool prune_operator_portions = true;
+
+    /**
+     *
+     * bernoulli excitation level that strings awaiting simplify() were pruned with (-1 if none)
+     *
+     */
+    int pruned_excitation_level = -1;
+
 };
 
 }
@@ -0,0 +1,110 @@
+//
+// pdaggerq - A code for bringing strings of creation / annihilation operators to normal order.
+// Filename: pq_label.cc
+// Copyright (C) 2020 A. Eugene DePrince III
+//
+// Author: A. Eugene DePrince III <adeprince@fsu.edu>
+// Maintainer: DePrince group
+//
+// This file is part of the pdaggerq package.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "pq_label.h"
+#include "pq_utils.h"
+
+#include<memory>
+#include<mutex>
+#include<unordered_map>
+
+namespace pdaggerq {
+
+// label names live in fixed-size chunks so that label_name() can be called without
+// locking while other threads intern new labels (existing entries never move)
+static constexpr size_t label_chunk_size = 1024;
+static constexpr size_t max_label_chunks = 256;
+
+static std::unique_ptr<std::string[]> label_chunks[max_label_chunks];
+static std::unordered_map<std::string, pq_label> label_ids;
+static size_t n_labels = 0;
+static std::mutex label_mutex;
+
+// labels are never removed from the table, so each thread keeps its own copy of the ids it
+// has already looked up and only takes label_mutex the first time it sees a label
+static thread_local std::unordered_map<std::string, pq_label> local_label_ids;
+
+// intern a label
+pq_label intern_label(const std::string &name) {
+
+    auto local = local_label_ids.find(name);
+    if ( local != local_label_ids.end() ) return local->second;
+
+    std::lock_guard<std::mutex> lock(label_mutex);
+
+    auto it = label_ids.find(name);
+    if ( it != label_ids.end() ) {
+        local_label_ids.emplace(name, it->second);
+        return it->second;
+    }
+
+    size_t chunk = n_labels / label_chunk_size;
+    if ( chunk == max_label_chunks ) {
+        printf("\n");
+        printf("    error: too many distinct labels\n");
+        printf("\n");
+        exit(1);
+    }
+    if ( !label_chunks[chunk] ) {
+        label_chunks[chunk] = std::make_unique<std::string[]>(label_chunk_size);
+    }
+    label_chunks[chunk][n_labels % label_chunk_size] = name;
+
+    pq_label_class type = general_label;
+    if ( is_occ(name) )      type = occ_label;
+    else if ( is_vir(name) ) type = vir_label;
+
+    pq_label id = (pq_label)(n_labels << 2) | type;
+    n_labels++;
+
+    label_ids[name] = id;
+    local_label_ids.emplace(name, id);
+    return id;
+}
+
+// look up a label without interning it
+bool find_label(const std::string &name, pq_label &id) {
+
+    auto local = local_label_ids.find(name);
+    if ( local != local_label_ids.end() ) {
+        id = local->second;
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(label_mutex);
+
+    auto it = label_ids.find(name);
+    if ( it == label_ids.end() ) return false;
+
+    local_label_ids.emplace(name, it->second);
+    id = it->second;
+    return true;
+}
+
+// the name of an interned label
+const std::string & label_name(pq_label id) {
+    size_t index = id >> 2;
+    return label_chunks[index / label_chunk_size][index % label_chunk_size];
+}
+
+}
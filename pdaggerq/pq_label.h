@@ -0,0 +1,292 @@
+//
+// pdaggerq - A code for bringing strings of creation / annihilation operators to normal order.
+// Filename: pq_label.h
+// Copyright (C) 2020 A. Eugene DePrince III
+//
+// Author: A. Eugene DePrince III <adeprince@fsu.edu>
+// Maintainer: DePrince group
+//
+// This file is part of the pdaggerq package.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#ifndef PQ_LABEL_H
+#define PQ_LABEL_H
+
+#include<algorithm>
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<initializer_list>
+#include<iterator>
+#include<string>
+#include<vector>
+
+namespace pdaggerq {
+
+/**
+ *
+ * an interned operator label. the low two bits hold the label class (see pq_label_class),
+ * and the remaining bits index a process-wide table of label names
+ *
+ */
+typedef uint32_t pq_label;
+
+/**
+ *
+ * label classes encoded in a pq_label
+ *
+ */
+enum pq_label_class : uint32_t {
+    general_label = 0,
+    occ_label     = 1,
+    vir_label     = 2
+};
+
+/**
+ *
+ * intern a label, adding it to the label table if it has not been seen before
+ *
+ * @param name: the label (e.g., "i", "a", "o1", "p")
+ * @return: the interned id for name
+ *
+ */
+pq_label intern_label(const std::string &name);
+
+/**
+ *
+ * look up an interned label without adding it to the label table
+ *
+ * @param name: the label
+ * @param id: the interned id for name (set only if the label has been interned)
+ * @return: true if the label has been interned
+ *
+ */
+bool find_label(const std::string &name, pq_label &id);
+
+/**
+ *
+ * the name of an interned label
+ *
+ * @param id: the interned id
+ * @return: the label as a std::string
+ *
+ */
+const std::string & label_name(pq_label id);
+
+/**
+ *
+ * the class (general / occupied / virtual) of an interned label
+ *
+ */
+inline pq_label_class label_class(pq_label id) {
+    return static_cast<pq_label_class>(id & 3u);
+}
+
+/**
+ *
+ * a list of flags packed into a fixed-size bitmask. used in place of std::vector<bool> for
+ * creator / annihilator flags so that copying a pq_string does not allocate for them
+ *
+ */
+class pq_bitmask {
+
+  public:
+
+    /**
+     *
+     * the maximum number of flags that can be stored
+     *
+     */
+    static constexpr size_t capacity = 128;
+
+    /**
+     *
+     * read-only iterator over the flags
+     *
+     */
+    class const_iterator {
+      public:
+        const_iterator(const pq_bitmask * mask, size_t pos) : mask_(mask), pos_(pos) {}
+        bool operator*() const { return (*mask_)[pos_]; }
+        const_iterator & operator++() { pos_++; return *this; }
+        bool operator!=(const const_iterator &other) const { return pos_ != other.pos_; }
+      private:
+        const pq_bitmask * mask_;
+        size_t pos_;
+    };
+
+    bool operator[](size_t i) const {
+        return (bits_[i >> 6] >> (i & 63u)) & 1u;
+    }
+
+    void set(size_t i, bool value) {
+        uint64_t bit = uint64_t(1) << (i & 63u);
+        if ( value ) bits_[i >> 6] |= bit;
+        else         bits_[i >> 6] &= ~bit;
+    }
+
+    void push_back(bool value) {
+        if ( size_ == capacity ) {
+            printf("\n");
+            printf("    error: strings with more than %zu operators are not supported\n", capacity);
+            printf("\n");
+            exit(1);
+        }
+        set(size_++, value);
+    }
+
+    /**
+     *
+     * the number of flags that are set
+     *
+     */
+    size_t count() const {
+        return __builtin_popcountll(bits_[0]) + __builtin_popcountll(bits_[1]);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    void clear() { bits_[0] = bits_[1] = 0; size_ = 0; }
+
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, size_}; }
+
+    bool operator==(const pq_bitmask &other) const {
+        return size_ == other.size_ && bits_[0] == other.bits_[0] && bits_[1] == other.bits_[1];
+    }
+
+  private:
+
+    uint64_t bits_[2] = {0, 0};
+    uint32_t size_ = 0;
+
+};
+
+/**
+ *
+ * a list of interned tensor labels. used in place of std::vector<std::string> for the labels of
+ * integrals, amplitudes, and delta functions, so that copying a tensor copies a few ids rather than
+ * a vector of strings. short lists are stored inline and do not allocate
+ *
+ */
+class pq_label_list {
+
+  public:
+
+    /**
+     *
+     * the number of labels stored without allocating
+     *
+     */
+    static constexpr size_t inline_capacity = 12;
+
+    /**
+     *
+     * read-only iterator over the label names
+     *
+     */
+    class const_iterator {
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::string value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const std::string * pointer;
+        typedef const std::string & reference;
+
+        const_iterator(const pq_label * id) : id_(id) {}
+        const std::string & operator*() const { return label_name(*id_); }
+        const std::string * operator->() const { return &label_name(*id_); }
+        const_iterator & operator++() { id_++; return *this; }
+        const_iterator operator++(int) { const_iterator tmp = *this; id_++; return tmp; }
+        bool operator==(const const_iterator &other) const { return id_ == other.id_; }
+        bool operator!=(const const_iterator &other) const { return id_ != other.id_; }
+        difference_type operator-(const const_iterator &other) const { return id_ - other.id_; }
+      private:
+        const pq_label * id_;
+    };
+
+    pq_label_list() = default;
+
+    pq_label_list(const std::vector<std::string> &names) {
+        for (const std::string & name : names) push_back(name);
+    }
+
+    pq_label_list(std::initializer_list<std::string> names) {
+        for (const std::string & name : names) push_back(name);
+    }
+
+    /**
+     *
+     * the label names as a std::vector<std::string>
+     *
+     */
+    operator std::vector<std::string>() const {
+        return std::vector<std::string>(begin(), end());
+    }
+
+    const std::string & operator[](size_t i) const { return label_name(data()[i]); }
+    const std::string & back() const { return label_name(data()[size_ - 1]); }
+
+    /**
+     *
+     * the interned id of label i
+     *
+     */
+    pq_label id(size_t i) const { return data()[i]; }
+
+    void set(size_t i, const std::string &name) { data()[i] = intern_label(name); }
+    void set(size_t i, pq_label id) { data()[i] = id; }
+
+    void push_back(const std::string &name) { push_back(intern_label(name)); }
+    void push_back(pq_label id) {
+        if ( size_ < inline_capacity ) {
+            inline_ids_[size_++] = id;
+            return;
+        }
+        if ( size_ == inline_capacity ) {
+            overflow_ids_.assign(inline_ids_, inline_ids_ + inline_capacity);
+        }
+        overflow_ids_.push_back(id);
+        size_++;
+    }
+
+    void reverse() { std::reverse(data(), data() + size_); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    void clear() { size_ = 0; overflow_ids_.clear(); }
+
+    const_iterator begin() const { return {data()}; }
+    const_iterator end() const { return {data() + size_}; }
+
+    bool operator==(const pq_label_list &other) const {
+        return size_ == other.size_ && std::equal(data(), data() + size_, other.data());
+    }
+    bool operator!=(const pq_label_list &other) const { return !(*this == other); }
+
+  private:
+
+    pq_label * data() { return size_ > inline_capacity ? overflow_ids_.data() : inline_ids_; }
+    const pq_label * data() const { return size_ > inline_capacity ? overflow_ids_.data() : inline_ids_; }
+
+    pq_label inline_ids_[inline_capacity] = {};
+    uint32_t size_ = 0;
+    std::vector<pq_label> overflow_ids_;
+
+};
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+//
+// pdaggerq - A code for bringing strings of creation / annihilation operators to normal order.
+// Filename: pq_pool.cc
+// Copyright (C) 2020 A. Eugene DePrince III
+//
+// Author: A. Eugene DePrince III <adeprince@fsu.edu>
+// Maintainer: DePrince group
+//
+// This file is part of the pdaggerq package.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#include<algorithm>
+#include<mutex>
+
+#include "pq_pool.h"
+
+namespace pdaggerq {
+
+pq_block_pool::pq_block_pool(size_t block_size) {
+
+    // keep every block aligned for any type
+    const size_t align = alignof(std::max_align_t);
+    this->block_size = (block_size + align - 1) / align * align;
+}
+
+pq_block_pool::~pq_block_pool() {
+    for (void * chunk : chunks) {
+        ::operator delete(chunk);
+    }
+}
+
+void * pq_block_pool::allocate() {
+
+    if ( free_list ) {
+        void * block = free_list;
+        free_list = *static_cast<void **>(block);
+        return block;
+    }
+
+    // carve a new chunk into blocks. the first block is returned, and the rest go on the free list
+    char * chunk = static_cast<char *>(::operator new(blocks_per_chunk * block_size));
+    chunks.push_back(chunk);
+    pq_allocation_counters::increment(thread_allocation_counters().pool_chunks);
+
+    for (size_t i = blocks_per_chunk - 1; i > 0; i--) {
+        void * block = chunk + i * block_size;
+        *static_cast<void **>(block) = free_list;
+        free_list = block;
+    }
+    return chunk;
+}
+
+void pq_block_pool::deallocate(void * block) {
+    *static_cast<void **>(block) = free_list;
+    free_list = block;
+}
+
+// the counters of every live thread, the totals of threads that have exited, and the totals at the
+// last reset. the mutex is only taken when a thread starts or exits and when the counters are read
+struct pq_counter_registry {
+    std::mutex mutex;
+    std::vector<const pq_allocation_counters *> live;
+    pq_allocation_counts retired;
+    pq_allocation_counts offset;
+};
+
+static pq_counter_registry & counter_registry() {
+    static pq_counter_registry registry;
+    return registry;
+}
+
+static void add_counts(pq_allocation_counts &total, const pq_allocation_counters &counters) {
+    total.transient_strings += counters.transient_strings.load(std::memory_order_relaxed);
+    total.copied_strings    += counters.copied_strings.load(std::memory_order_relaxed);
+    total.pool_chunks       += counters.pool_chunks.load(std::memory_order_relaxed);
+    total.promoted_strings  += counters.promoted_strings.load(std::memory_order_relaxed);
+}
+
+// a thread's counters, registered while the thread runs
+struct pq_thread_counters {
+    pq_allocation_counters counters;
+
+    pq_thread_counters() {
+        pq_counter_registry & registry = counter_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.push_back(&counters);
+    }
+
+    ~pq_thread_counters() {
+        pq_counter_registry & registry = counter_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        add_counts(registry.retired, counters);
+        registry.live.erase(std::find(registry.live.begin(), registry.live.end(), &counters));
+    }
+};
+
+pq_allocation_counters & thread_allocation_counters() {
+    static thread_local pq_thread_counters my_counters;
+    return my_counters.counters;
+}
+
+// sum the counters of every thread (call with the registry locked)
+static pq_allocation_counts total_counts(const pq_counter_registry &registry) {
+    pq_allocation_counts total = registry.retired;
+    for (const pq_allocation_counters * counters : registry.live) {
+        add_counts(total, *counters);
+    }
+    return total;
+}
+
+pq_allocation_counts allocation_counts() {
+    pq_counter_registry & registry = counter_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    pq_allocation_counts total = total_counts(registry);
+    total.transient_strings -= registry.offset.transient_strings;
+    total.copied_strings    -= registry.offset.copied_strings;
+    total.pool_chunks       -= registry.offset.pool_chunks;
+    total.promoted_strings  -= registry.offset.promoted_strings;
+    return total;
+}
+
+void reset_allocation_counts() {
+    pq_counter_registry & registry = counter_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.offset = total_counts(registry);
+}
+
+std::shared_ptr<pq_string> promote_string(const std::shared_ptr<pq_string> &in) {
+    pq_allocation_counters::increment(thread_allocation_counters().promoted_strings);
+    return std::make_shared<pq_string>(std::move(*in));
+}
+
+}
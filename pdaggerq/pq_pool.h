@@ -0,0 +1,204 @@
+//
+// pdaggerq - A code for bringing strings of creation / annihilation operators to normal order.
+// Filename: pq_pool.h
+// Copyright (C) 2020 A. Eugene DePrince III
+//
+// Author: A. Eugene DePrince III <adeprince@fsu.edu>
+// Maintainer: DePrince group
+//
+// This file is part of the pdaggerq package.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#ifndef PQ_POOL_H
+#define PQ_POOL_H
+
+#include<atomic>
+#include<cstddef>
+#include<memory>
+#include<new>
+#include<type_traits>
+#include<vector>
+
+#include "pq_string.h"
+
+namespace pdaggerq {
+
+/**
+ *
+ * a free list of fixed-size blocks owned by one thread. blocks are carved out of larger chunks,
+ * and freed blocks are recycled rather than returned to the heap. chunks are released when the
+ * owning thread exits
+ *
+ */
+class pq_block_pool {
+
+  public:
+
+    explicit pq_block_pool(size_t block_size);
+    ~pq_block_pool();
+
+    pq_block_pool(const pq_block_pool &) = delete;
+    pq_block_pool &operator=(const pq_block_pool &) = delete;
+
+    void * allocate();
+    void deallocate(void * block);
+
+  private:
+
+    // the number of blocks per chunk
+    static constexpr size_t blocks_per_chunk = 256;
+
+    size_t block_size;
+    void * free_list = nullptr;
+    std::vector<void *> chunks;
+
+};
+
+/**
+ *
+ * a std::allocator-compatible wrapper around a per-thread pq_block_pool. single objects are
+ * drawn from the pool belonging to the calling thread, so a block must be released by the
+ * thread that allocated it
+ *
+ */
+template <class T>
+class pq_pool_allocator {
+
+  public:
+
+    typedef T value_type;
+
+    pq_pool_allocator() = default;
+    template <class U> pq_pool_allocator(const pq_pool_allocator<U> &) {}
+
+    T * allocate(size_t n) {
+        if ( n != 1 ) return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(pool().allocate());
+    }
+
+    void deallocate(T * p, size_t n) {
+        if ( n != 1 ) {
+            ::operator delete(p);
+            return;
+        }
+        pool().deallocate(p);
+    }
+
+    template <class U> bool operator==(const pq_pool_allocator<U> &) const { return true; }
+    template <class U> bool operator!=(const pq_pool_allocator<U> &) const { return false; }
+
+  private:
+
+    static pq_block_pool & pool() {
+        static thread_local pq_block_pool my_pool(sizeof(T) < sizeof(void *) ? sizeof(void *) : sizeof(T));
+        return my_pool;
+    }
+
+};
+
+/**
+ *
+ * totals of the allocation counters
+ *
+ */
+struct pq_allocation_counts {
+
+    // transient strings created in the rearrangement loops
+    size_t transient_strings = 0;
+
+    // transient strings that copied the tensors of another string (the rest took them over)
+    size_t copied_strings = 0;
+
+    // pool chunks requested from the heap
+    size_t pool_chunks = 0;
+
+    // transient strings promoted to long-lived storage
+    size_t promoted_strings = 0;
+
+};
+
+/**
+ *
+ * allocation counters owned by one thread. only the owning thread changes them, so an increment
+ * is a plain load and store; the counters are atomic only so that other threads can read them
+ *
+ */
+struct pq_allocation_counters {
+
+    std::atomic<size_t> transient_strings{0};
+    std::atomic<size_t> copied_strings{0};
+    std::atomic<size_t> pool_chunks{0};
+    std::atomic<size_t> promoted_strings{0};
+
+    static void increment(std::atomic<size_t> &counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+};
+
+/**
+ *
+ * the allocation counters of the calling thread
+ *
+ */
+pq_allocation_counters & thread_allocation_counters();
+
+/**
+ *
+ * the allocation counters summed over all threads (including threads that have exited) since the
+ * last call to reset_allocation_counts. the counters are process wide
+ *
+ */
+pq_allocation_counts allocation_counts();
+
+/**
+ *
+ * start counting allocations from zero
+ *
+ */
+void reset_allocation_counts();
+
+/**
+ *
+ * create a transient string in the calling thread's pool. transient strings must be released,
+ * or promoted with promote_string, by the thread that created them
+ *
+ * @param first, args: arguments forwarded to a pq_string constructor. a string passed as an
+ * rvalue gives up its tensors; anything else is copied
+ * @return: the new string
+ */
+template <class First, class... Args>
+std::shared_ptr<pq_string> make_transient_string(First && first, Args &&... args) {
+    pq_allocation_counters & counters = thread_allocation_counters();
+    pq_allocation_counters::increment(counters.transient_strings);
+    if ( std::is_lvalue_reference<First>::value || !std::is_same<typename std::decay<First>::type, pq_string>::value ) {
+        pq_allocation_counters::increment(counters.copied_strings);
+    }
+    return std::allocate_shared<pq_string>(pq_pool_allocator<pq_string>(), std::forward<First>(first), std::forward<Args>(args)...);
+}
+
+/**
+ *
+ * move a transient string into ordinary heap storage so that it can outlive the rearrangement loop
+ *
+ * @param in: the transient string (its contents are moved out)
+ * @return: a long-lived copy of the string
+ */
+std::shared_ptr<pq_string> promote_string(const std::shared_ptr<pq_string> &in);
+
+}
+
+#endif
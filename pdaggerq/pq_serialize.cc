@@ -3,10 +3,19 @@
 #include <iostream>
 #include <string>
 #include <cctype>
+#include <cstring>
 #include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 #include "pq_helper.h"
+#include "pq_serialize.h"
 #include "pq_utils.h"
 #include "pq_string.h"
 #include "pq_add_label_ranges.h"
@@ -20,88 +29,562 @@
 
 using namespace pdaggerq;
 
-void pq_helper::serialize(const std::string & filename) const {
+std::string pdaggerq::block_key(const std::unordered_map<std::string, std::string> &spin_labels) {
 
-    // open file
-    std::ofstream buffer(filename, std::ios::binary | std::ios::out);
+    std::vector<std::pair<std::string, std::string> > sorted(spin_labels.begin(), spin_labels.end());
+    std::sort(sorted.begin(), sorted.end());
 
-    // helper function to write a primitive in binary
-    auto write_primitive = [&buffer](const auto &primitive) {
-        buffer.write(reinterpret_cast<const char*>(&primitive), sizeof(primitive));
-    };
+    std::string key;
+    for (const auto & [label, spin] : sorted) {
+        if ( !key.empty() ) key += ",";
+        key += label + ":" + spin;
+    }
+    return key;
+}
 
-    // helper function to write a string in binary
-    auto write_string = [&buffer, &write_primitive](const std::string &str) {
-        size_t length = str.size();
-        write_primitive(length);
-        buffer.write(str.data(), length);
+namespace {
+
+// builds the string table and data words of a file
+class pq_file_writer {
+
+  public:
+
+    std::vector<std::string> strings;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<uint32_t> words;
+
+    uint32_t string_id(const std::string &str) {
+        auto it = ids.find(str);
+        if ( it != ids.end() ) return it->second;
+        uint32_t id = (uint32_t)strings.size();
+        strings.push_back(str);
+        ids.emplace(str, id);
+        return id;
+    }
+
+    void put(uint32_t word) { words.push_back(word); }
+    void put_int(int value) { words.push_back((uint32_t)value); }
+    void put_string(const std::string &str) { words.push_back(string_id(str)); }
+
+    void put_strings(const std::vector<std::string> &list) {
+        put((uint32_t)list.size());
+        for (const std::string &str : list) put_string(str);
+    }
+
+    void put_bits(const pq_bitmask &bits) {
+        put((uint32_t)bits.size());
+        for (size_t i = 0; i < bits.size(); i += 32) {
+            uint32_t word = 0;
+            for (size_t j = i; j < bits.size() && j < i + 32; j++) {
+                if ( bits[j] ) word |= uint32_t(1) << (j - i);
+            }
+            put(word);
+        }
+    }
+
+    void put_tensor(const tensor &t) {
+        put((uint32_t)t.labels.size());
+        for (size_t i = 0; i < t.labels.size(); i++) put_string(t.labels[i]);
+        put((uint32_t)t.numerical_labels.size());
+        for (int label : t.numerical_labels) put_int(label);
+        put_strings(t.spin_labels);
+        put_strings(t.label_ranges);
+        put_strings(t.op_portions);
+        put_int(t.permutations);
+    }
+
+    void put_term(const pq_string &in) {
+
+        put_strings(in.string);
+
+        put((uint32_t)in.deltas.size());
+        for (const delta_functions &delta : in.deltas) put_tensor(delta);
+
+        put_strings(in.permutations);
+        put_strings(in.paired_permutations_6);
+        put_strings(in.paired_permutations_3);
+        put_strings(in.paired_permutations_2);
+
+        put_bits(in.is_boson_dagger);
+        put_bits(in.is_dagger);
+        put_bits(in.is_dagger_fermi);
+
+        put((uint32_t)in.symbol.size());
+        for (pq_label label : in.symbol) put_string(label_name(label));
+
+        put((uint32_t)in.ints.size());
+        for (const auto & [type, list] : in.ints) {
+            put_string(type);
+            put((uint32_t)list.size());
+            for (const integrals &integral : list) put_tensor(integral);
+        }
+
+        put((uint32_t)in.amps.size());
+        for (const auto & [type, list] : in.amps) {
+            put((uint32_t)(unsigned char)type);
+            put((uint32_t)list.size());
+            for (const amplitudes &amp : list) {
+                put_tensor(amp);
+                put_int(amp.n_create);
+                put_int(amp.n_annihilate);
+                put_int(amp.n_ph);
+            }
+        }
+
+        put((uint32_t)in.non_summed_spin_labels.size());
+        for (const auto & [label, spin] : in.non_summed_spin_labels) {
+            put_string(label);
+            put_string(spin);
+        }
+    }
+
+};
+
+// reads data words from a mapped file in order
+class pq_file_reader {
+
+  public:
+
+    pq_file_reader(const pq_mapped_file &file, uint64_t first, uint64_t count)
+        : file(file), words(file.words(first, count)), count(count) {}
+
+    uint32_t get() {
+        if ( position == count ) {
+            throw std::runtime_error("saved pq_helper is corrupt (record extends past its data)");
+        }
+        return words[position++];
+    }
+    int get_int() { return (int)get(); }
+    bool at_end() const { return position == count; }
+    std::string get_string() { return std::string(file.string(get())); }
+
+    void get_strings(std::vector<std::string> &list) {
+        list.resize(get());
+        for (std::string &str : list) str = get_string();
+    }
+
+    void get_bits(pq_bitmask &bits) {
+        bits.clear();
+        size_t n = get();
+        for (size_t i = 0; i < n; i += 32) {
+            uint32_t word = get();
+            for (size_t j = i; j < n && j < i + 32; j++) {
+                bits.push_back((word >> (j - i)) & 1u);
+            }
+        }
+    }
+
+    void get_tensor(tensor &t) {
+        t.labels.clear();
+        size_t n_labels = get();
+        for (size_t i = 0; i < n_labels; i++) t.labels.push_back(file.label(get()));
+        t.numerical_labels.resize(get());
+        for (int &label : t.numerical_labels) label = get_int();
+        get_strings(t.spin_labels);
+        get_strings(t.label_ranges);
+        get_strings(t.op_portions);
+        t.permutations = get_int();
+    }
+
+    void get_term(pq_string &in) {
+
+        get_strings(in.string);
+
+        in.deltas.resize(get());
+        for (delta_functions &delta : in.deltas) get_tensor(delta);
+
+        get_strings(in.permutations);
+        get_strings(in.paired_permutations_6);
+        get_strings(in.paired_permutations_3);
+        get_strings(in.paired_permutations_2);
+
+        get_bits(in.is_boson_dagger);
+        get_bits(in.is_dagger);
+        get_bits(in.is_dagger_fermi);
+
+        in.symbol.resize(get());
+        for (pq_label &label : in.symbol) label = file.label(get());
+
+        size_t n_types = get();
+        for (size_t i = 0; i < n_types; i++) {
+            std::vector<integrals> &list = in.ints[get_string()];
+            list.resize(get());
+            for (integrals &integral : list) get_tensor(integral);
+        }
+
+        n_types = get();
+        for (size_t i = 0; i < n_types; i++) {
+            std::vector<amplitudes> &list = in.amps[(char)get()];
+            list.resize(get());
+            for (amplitudes &amp : list) {
+                get_tensor(amp);
+                amp.n_create = get_int();
+                amp.n_annihilate = get_int();
+                amp.n_ph = get_int();
+            }
+        }
+
+        size_t n_labels = get();
+        for (size_t i = 0; i < n_labels; i++) {
+            std::string label = get_string();
+            in.non_summed_spin_labels[label] = get_string();
+        }
+    }
+
+  private:
+
+    const pq_mapped_file &file;
+    const uint32_t * words;
+    uint64_t count;
+    uint64_t position = 0;
+
+};
+
+// round a file offset up to the next 8-byte boundary
+uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+[[noreturn]] void corrupt_file(const std::string &reason) {
+    throw std::runtime_error("saved pq_helper is corrupt (" + reason + ")");
+}
+
+}
+
+pq_mapped_file::pq_mapped_file(const std::string &filename) {
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if ( fd < 0 ) {
+        std::cout << "Error: could not open file '" << filename << "'" << std::endl;
+        exit(1);
+    }
+
+    struct stat info;
+    if ( fstat(fd, &info) != 0 ) {
+        close(fd);
+        std::cout << "Error: could not open file '" << filename << "'" << std::endl;
+        exit(1);
+    }
+    length = (size_t)info.st_size;
+
+    // files in the older format are read as a stream instead
+    if ( length < sizeof(pq_file_header) ) {
+        close(fd);
+        return;
+    }
+
+    void * address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( address == MAP_FAILED ) {
+        std::cout << "Error: could not map file '" << filename << "'" << std::endl;
+        exit(1);
+    }
+    data = static_cast<const char *>(address);
+
+    if ( memcmp(header().magic, pq_file_magic, sizeof(pq_file_magic)) != 0 ) return;
+    indexed = true;
+
+    // the destructor does not run if the constructor throws
+    auto reject = [this](const std::string &message) {
+        munmap(const_cast<char *>(data), length);
+        data = nullptr;
+        throw std::runtime_error(message);
     };
 
-    /// ordered strings
+    const pq_file_header &h = header();
+    if ( h.version != pq_file_version ) {
+        reject("'" + filename + "' was saved in version " + std::to_string(h.version)
+               + " of the pq_helper format (expected " + std::to_string(pq_file_version) + ")");
+    }
 
-    // serialize the number of strings
-    write_primitive(ordered.size());
+    // every section must lie inside the file
+    auto fits = [this](uint64_t offset, uint64_t count, uint64_t size) {
+        return offset <= length && count <= (length - offset) / size;
+    };
+    if ( !fits(h.strings_offset, h.n_strings, sizeof(pq_file_string)) ||
+         !fits(h.terms_offset, h.n_terms, sizeof(pq_file_term)) ||
+         !fits(h.words_offset, h.n_words, sizeof(uint32_t)) ||
+         !fits(h.blocks_offset, h.n_blocks, sizeof(pq_file_block)) ||
+         h.n_ordered > h.n_terms || h.settings_word > h.n_words ) {
+        reject("'" + filename + "' is not a valid saved pq_helper (section extends past the end of the file)");
+    }
 
-    // serialize each string in ordered
-    for (const std::shared_ptr<pq_string> & pq_str : ordered) {
-        pq_str->serialize(buffer);
+    // every term record must refer to data words and a block inside the file
+    for (size_t i = 0; i < h.n_terms; i++) {
+        const pq_file_term &record = reinterpret_cast<const pq_file_term *>(data + h.terms_offset)[i];
+        if ( record.first_word > h.n_words || record.n_words > h.n_words - record.first_word ||
+             record.block >= h.n_blocks || record.vacuum >= h.n_strings ) {
+            reject("'" + filename + "' is not a valid saved pq_helper (term record out of range)");
+        }
     }
 
-    // serialize the number of blocked strings
-    write_primitive(ordered_blocked.size());
+    // every block must list term records from its own section. strings are checked as they are read
+    // (see string())
+    for (size_t i = 0; i < h.n_blocks; i++) {
+        const pq_file_block &entry = block(i);
+        if ( entry.section > 1 || entry.first_word > h.n_words || entry.n_terms > h.n_words - entry.first_word ||
+             entry.key >= h.n_strings ) {
+            reject("'" + filename + "' is not a valid saved pq_helper (block index entry out of range)");
+        }
+        const uint32_t * members = reinterpret_cast<const uint32_t *>(data + h.words_offset) + entry.first_word;
+        uint64_t first = entry.section == 0 ? 0 : h.n_ordered;
+        uint64_t last = entry.section == 0 ? h.n_ordered : h.n_terms;
+        for (uint64_t j = 0; j < entry.n_terms; j++) {
+            if ( members[j] < first || members[j] >= last ) {
+                reject("'" + filename + "' is not a valid saved pq_helper (block lists a term record out of range)");
+            }
+        }
+    }
+
+    labels.assign(h.n_strings, not_interned);
+}
 
-    // serialize each string in ordered_blocked
-    for (const std::shared_ptr<pq_string> & pq_str : ordered_blocked) {
-        pq_str->serialize(buffer);
+pq_mapped_file::~pq_mapped_file() {
+    if ( data ) munmap(const_cast<char *>(data), length);
+}
+
+std::string_view pq_mapped_file::string(uint32_t id) const {
+    if ( id >= header().n_strings ) {
+        corrupt_file("string id out of range");
+    }
+    const pq_file_string &entry = reinterpret_cast<const pq_file_string *>(data + header().strings_offset)[id];
+    if ( entry.offset > length || entry.length > length - entry.offset ) {
+        corrupt_file("string extends past the end of the file");
     }
+    return {data + entry.offset, entry.length};
+}
 
-    /// static bools from pq_string
-    write_primitive(pq_string::is_spin_blocked);
-    write_primitive(pq_string::is_range_blocked);
+const pq_file_term & pq_mapped_file::term_record(size_t i) const {
+    if ( i >= header().n_terms ) {
+        corrupt_file("term record out of range");
+    }
+    return reinterpret_cast<const pq_file_term *>(data + header().terms_offset)[i];
+}
 
-    /// vacuum type
-    write_string(vacuum);
+const uint32_t * pq_mapped_file::words(uint64_t first, uint64_t count) const {
+    if ( first > header().n_words || count > header().n_words - first ) {
+        corrupt_file("data out of range");
+    }
+    return reinterpret_cast<const uint32_t *>(data + header().words_offset) + first;
+}
 
-    /// print_level
-    write_primitive(print_level);
+const pq_file_block & pq_mapped_file::block(size_t i) const {
+    if ( i >= header().n_blocks ) {
+        corrupt_file("block out of range");
+    }
+    return reinterpret_cast<const pq_file_block *>(data + header().blocks_offset)[i];
+}
 
-    /// right operators
-    write_string(right_operators_type);
+pq_label pq_mapped_file::label(uint32_t id) const {
+    if ( id >= labels.size() ) {
+        corrupt_file("string id out of range");
+    }
+    if ( labels[id] == not_interned ) {
+        labels[id] = intern_label(std::string(string(id)));
+    }
+    return labels[id];
+}
 
-    // count number of right operators
-    size_t nright_operators = right_operators.size();
-    write_primitive(nright_operators);
+std::vector<size_t> pq_mapped_file::find_block(uint32_t section, const std::string &key) const {
 
-    // serialize right operators
-    for (const std::vector<std::string> & op : right_operators) {
-        write_primitive(op.size());
-        for (const std::string & op_str : op) {
-            write_string(op_str);
+    std::vector<size_t> list;
+    for (size_t i = 0; i < n_blocks(); i++) {
+        const pq_file_block &entry = block(i);
+        if ( entry.section != section || string(entry.key) != key ) continue;
+        const uint32_t * members = words(entry.first_word, entry.n_terms);
+        for (size_t j = 0; j < entry.n_terms; j++) {
+            if ( members[j] >= n_terms() ) {
+                corrupt_file("block lists a term record out of range");
+            }
+            list.push_back(members[j]);
         }
     }
+    return list;
+}
 
-    /// left operators
-    write_string(left_operators_type);
+std::shared_ptr<pq_string> pq_mapped_file::term(size_t i) const {
 
-    // count number of left operators
-    write_primitive(left_operators.size());
+    const pq_file_term &record = term_record(i);
+
+    std::shared_ptr<pq_string> pq_str = std::make_shared<pq_string>(std::string(string(record.vacuum)));
+    pq_str->factor = record.factor;
+    pq_str->key = record.key;
+    pq_str->sign = record.sign;
+    pq_str->skip = record.skip;
+    pq_str->has_w0 = record.has_w0;
 
-    // serialize left operators
-    for (const std::vector<std::string> & op : left_operators) {
-        write_primitive(op.size());
-        for (const std::string & op_str : op) {
-            write_string(op_str);
+    pq_file_reader reader(*this, record.first_word, record.n_words);
+    reader.get_term(*pq_str);
+
+    return pq_str;
+}
+
+void pq_helper::serialize(const std::string & filename) const {
+
+    if ( !pending_products.empty() ) {
+        printf("\n");
+        printf("    error: serialize() called before simplify() with a cache directory set\n");
+        printf("\n");
+        exit(1);
+    }
+
+    if ( !write_serialized(filename) ) {
+        printf("\n");
+        printf("    error: could not write '%s'\n", filename.c_str());
+        printf("\n");
+        exit(1);
+    }
+}
+
+bool pq_helper::write_serialized(const std::string & filename) const {
+
+    pq_file_writer writer;
+
+    /// term records: ordered, then ordered_blocked. each term is filed in the block index
+    /// under its section and non-summed spin labels
+    std::vector<pq_file_term> records;
+    records.reserve(ordered.size() + ordered_blocked.size());
+
+    std::vector<std::pair<uint32_t, uint32_t> > blocks;   // (section, key)
+    std::vector<std::vector<uint32_t> > members;
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> block_ids;
+
+    for (uint32_t section = 0; section < 2; section++) {
+        for (const std::shared_ptr<pq_string> & pq_str : section == 0 ? ordered : ordered_blocked) {
+
+            std::pair<uint32_t, uint32_t> id = {section, writer.string_id(block_key(pq_str->non_summed_spin_labels))};
+            auto it = block_ids.find(id);
+            if ( it == block_ids.end() ) {
+                it = block_ids.emplace(id, (uint32_t)blocks.size()).first;
+                blocks.push_back(id);
+                members.emplace_back();
+            }
+            members[it->second].push_back((uint32_t)records.size());
+
+            pq_file_term record{};
+            record.factor = pq_str->factor;
+            record.key = pq_str->key;
+            record.first_word = writer.words.size();
+            record.sign = pq_str->sign;
+            record.vacuum = writer.string_id(pq_str->vacuum);
+            record.block = it->second;
+            record.skip = pq_str->skip;
+            record.has_w0 = pq_str->has_w0;
+
+            writer.put_term(*pq_str);
+            record.n_words = (uint32_t)(writer.words.size() - record.first_word);
+
+            records.push_back(record);
         }
     }
 
-    /// cluster commutation
-    write_primitive(cluster_operators_commute);
+    /// block index
+    std::vector<pq_file_block> index;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        pq_file_block entry{};
+        entry.section = blocks[i].first;
+        entry.key = blocks[i].second;
+        entry.first_word = writer.words.size();
+        entry.n_terms = members[i].size();
+        for (uint32_t member : members[i]) writer.put(member);
+        index.push_back(entry);
+    }
 
-    /// find_paired_permutations
-    write_primitive(find_paired_permutations);
+    /// pq_helper settings
+    uint64_t settings_word = writer.words.size();
+    writer.put_string(vacuum);
+    writer.put_int(print_level);
+    writer.put_string(right_operators_type);
+    writer.put((uint32_t)right_operators.size());
+    for (const std::vector<std::string> & op : right_operators) writer.put_strings(op);
+    writer.put_string(left_operators_type);
+    writer.put((uint32_t)left_operators.size());
+    for (const std::vector<std::string> & op : left_operators) writer.put_strings(op);
+    writer.put(cluster_operators_commute);
+    writer.put(find_paired_permutations);
+    writer.put_string(cache_history_valid ? cache_description() : "");
+
+    /// lay out the file
+    pq_file_header header{};
+    memcpy(header.magic, pq_file_magic, sizeof(pq_file_magic));
+    header.version = pq_file_version;
+    header.flags = (is_spin_blocked ? 1u : 0u) | (is_range_blocked ? 2u : 0u);
+
+    std::vector<pq_file_string> entries(writer.strings.size());
+    uint64_t offset = sizeof(pq_file_header);
+    header.n_strings = entries.size();
+    header.strings_offset = offset;
+    offset += entries.size() * sizeof(pq_file_string);
+    for (size_t i = 0; i < entries.size(); i++) {
+        entries[i].offset = offset;
+        entries[i].length = writer.strings[i].size();
+        offset += writer.strings[i].size();
+    }
 
-    // close file
+    uint64_t strings_end = offset;
+    offset = align8(offset);
+    header.n_terms = records.size();
+    header.n_ordered = ordered.size();
+    header.terms_offset = offset;
+    offset += records.size() * sizeof(pq_file_term);
+
+    header.n_words = writer.words.size();
+    header.words_offset = offset;
+    offset += writer.words.size() * sizeof(uint32_t);
+
+    uint64_t words_end = offset;
+    offset = align8(offset);
+    header.n_blocks = index.size();
+    header.blocks_offset = offset;
+    header.settings_word = settings_word;
+
+    /// write
+    std::ofstream buffer(filename, std::ios::binary | std::ios::out);
+    if ( !buffer.is_open() ) return false;
+
+    const char padding[8] = {};
+    buffer.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    buffer.write(reinterpret_cast<const char *>(entries.data()), (std::streamsize)(entries.size() * sizeof(pq_file_string)));
+    for (const std::string & str : writer.strings) {
+        buffer.write(str.data(), (std::streamsize)str.size());
+    }
+    buffer.write(padding, (std::streamsize)(header.terms_offset - strings_end));
+    buffer.write(reinterpret_cast<const char *>(records.data()), (std::streamsize)(records.size() * sizeof(pq_file_term)));
+    buffer.write(reinterpret_cast<const char *>(writer.words.data()), (std::streamsize)(writer.words.size() * sizeof(uint32_t)));
+    buffer.write(padding, (std::streamsize)(header.blocks_offset - words_end));
+    buffer.write(reinterpret_cast<const char *>(index.data()), (std::streamsize)(index.size() * sizeof(pq_file_block)));
+
+    // close file (which flushes it) before checking that everything was written
     buffer.close();
+    return !buffer.fail();
+}
+
+// read the pq_helper settings saved after the blocks
+std::string pq_helper::deserialize_settings(const pq_mapped_file &file) {
+
+    const pq_file_header &header = file.header();
+
+    is_spin_blocked = header.flags & 1u;
+    is_range_blocked = header.flags & 2u;
+
+    pq_file_reader reader(file, header.settings_word, header.n_words - header.settings_word);
+
+    vacuum = reader.get_string();
+    print_level = reader.get_int();
+
+    right_operators_type = reader.get_string();
+    right_operators.resize(reader.get());
+    for (std::vector<std::string> & op : right_operators) reader.get_strings(op);
+
+    left_operators_type = reader.get_string();
+    left_operators.resize(reader.get());
+    for (std::vector<std::string> & op : left_operators) reader.get_strings(op);
+
+    cluster_operators_commute = reader.get();
+    find_paired_permutations = reader.get();
+
+    // files saved before the cache description was added end here
+    return reader.at_end() ? "" : reader.get_string();
 }
 
 void pq_helper::deserialize(const std::string & filename) {
@@ -109,6 +592,81 @@ void pq_helper::deserialize(const std::string & filename) {
     // clear pq_helper
     clear();
 
+    // nothing records how the loaded strings came about, so they can not be part of a cache key
+    cache_history_valid = false;
+
+    pq_mapped_file file(filename);
+    if ( !file.is_indexed() ) {
+        deserialize_legacy(filename);
+        return;
+    }
+
+    deserialize_settings(file);
+
+    size_t n_ordered = file.header().n_ordered;
+    ordered.resize(n_ordered);
+    ordered_blocked.resize(file.n_terms() - n_ordered);
+    for (size_t i = 0; i < file.n_terms(); i++) {
+        (i < n_ordered ? ordered[i] : ordered_blocked[i - n_ordered]) = file.term(i);
+    }
+}
+
+bool pq_helper::deserialize_cached(const std::string & filename, const std::string & description) {
+
+    clear();
+    cache_history_valid = false;
+
+    // a damaged cache file is a miss, and it is overwritten
+    try {
+        pq_mapped_file file(filename);
+        if ( !file.is_indexed() || deserialize_settings(file) != description ) return false;
+
+        size_t n_ordered = file.header().n_ordered;
+        ordered.resize(n_ordered);
+        ordered_blocked.resize(file.n_terms() - n_ordered);
+        for (size_t i = 0; i < file.n_terms(); i++) {
+            (i < n_ordered ? ordered[i] : ordered_blocked[i - n_ordered]) = file.term(i);
+        }
+    } catch (const std::runtime_error &) {
+        clear();
+        cache_history_valid = false;
+        return false;
+    }
+    return true;
+}
+
+void pq_helper::deserialize(const std::string & filename, const std::unordered_map<std::string, std::string> &spin_labels) {
+
+    // clear pq_helper
+    clear();
+    cache_history_valid = false;
+
+    pq_mapped_file file(filename);
+    if ( !file.is_indexed() ) {
+        printf("\n");
+        printf("    error: '%s' was saved without a block index and can only be loaded in full\n", filename.c_str());
+        printf("\n");
+        exit(1);
+    }
+
+    deserialize_settings(file);
+
+    if ( !is_spin_blocked ) {
+        printf("\n");
+        printf("    error: '%s' does not contain spin-blocked strings\n", filename.c_str());
+        printf("\n");
+        exit(1);
+    }
+
+    // only the records in the requested block are decoded
+    for (size_t i : file.find_block(1, block_key(spin_labels))) {
+        ordered_blocked.push_back(file.term(i));
+    }
+}
+
+// files written before the indexed format was introduced: a stream of length-prefixed strings
+void pq_helper::deserialize_legacy(const std::string & filename) {
+
     // open file
     std::ifstream buffer(filename, std::ios::binary | std::ios::in);
 
@@ -161,9 +719,9 @@ void pq_helper::deserialize(const std::string & filename) {
         }
     }
 
-    /// static bools from pq_string
-    read_primitive(pq_string::is_spin_blocked);
-    read_primitive(pq_string::is_range_blocked);
+    /// blocking state of the strings
+    read_primitive(is_spin_blocked);
+    read_primitive(is_range_blocked);
 
     /// vacuum type
     read_string(vacuum);
@@ -257,10 +815,10 @@ void pq_string::serialize(std::ofstream &buffer) const {
             std::vector<std::string>                                 paired_permutations_6
             std::vector<std::string>                                 paired_permutations_3
             std::vector<std::string>                                 paired_permutations_2
-            std::vector<bool>                                        is_boson_dagger
-            std::vector<bool>                                        is_dagger
-            std::vector<bool>                                        is_dagger_fermi
-            std::vector<std::string>                                 symbol
+            pq_bitmask                                               is_boson_dagger
+            pq_bitmask                                               is_dagger
+            pq_bitmask                                               is_dagger_fermi
+            std::vector<pq_label>                                    symbol (written as label names)
 
         Maps:
             std::unordered_map<std::string, std::vector<integrals> > ints
@@ -268,8 +826,6 @@ void pq_string::serialize(std::ofstream &buffer) const {
             std::unordered_map<std::string, std::string>             non_summed_spin_labels
 
         Static (ignored):
-            bool                                                     is_spin_blocked
-            bool                                                     is_range_blocked
             char[]                                                   amplitude_types
             std::string[]                                            integral_types
 
@@ -352,8 +908,8 @@ void pq_string::serialize(std::ofstream &buffer) const {
 
     // symbol
     write_primitive(symbol.size());
-    for (const std::string &s : symbol) {
-        write_string(s);
+    for (const pq_label &s : symbol) {
+        write_string(label_name(s));
     }
 
     /// maps
@@ -489,13 +1045,10 @@ void pq_string::deserialize(std::ifstream &buffer) {
     read_primitive(is_boson_dagger_size);
 
     is_boson_dagger.clear();
-    if (is_boson_dagger_size > 0) {
-        is_boson_dagger.resize(is_boson_dagger_size);
-        for (size_t i = 0; i < is_boson_dagger_size; i++) {
-            bool b;
-            read_primitive(b);
-            is_boson_dagger[i] = b;
-        }
+    for (size_t i = 0; i < is_boson_dagger_size; i++) {
+        bool b;
+        read_primitive(b);
+        is_boson_dagger.push_back(b);
     }
 
     // is_dagger
@@ -503,13 +1056,10 @@ void pq_string::deserialize(std::ifstream &buffer) {
     read_primitive(is_dagger_size);
 
     is_dagger.clear();
-    if (is_dagger_size > 0) {
-        is_dagger.resize(is_dagger_size);
-        for (size_t i = 0; i < is_dagger_size; i++) {
-            bool b;
-            read_primitive(b);
-            is_dagger[i] = b;
-        }
+    for (size_t i = 0; i < is_dagger_size; i++) {
+        bool b;
+        read_primitive(b);
+        is_dagger.push_back(b);
     }
 
     // is_dagger_fermi
@@ -517,13 +1067,10 @@ void pq_string::deserialize(std::ifstream &buffer) {
     read_primitive(is_dagger_fermi_size);
 
     is_dagger_fermi.clear();
-    if (is_dagger_fermi_size > 0) {
-        is_dagger_fermi.resize(is_dagger_fermi_size);
-        for (size_t i = 0; i < is_dagger_fermi_size; i++) {
-            bool b;
-            read_primitive(b);
-            is_dagger_fermi[i] = b;
-        }
+    for (size_t i = 0; i < is_dagger_fermi_size; i++) {
+        bool b;
+        read_primitive(b);
+        is_dagger_fermi.push_back(b);
     }
 
     // symbol
@@ -531,11 +1078,10 @@ void pq_string::deserialize(std::ifstream &buffer) {
     read_primitive(symbol_size);
 
     symbol.clear();
-    if (symbol_size > 0) {
-        symbol.resize(symbol_size);
-        for (std::string &s: symbol) {
-            read_string(s);
-        }
+    for (size_t i = 0; i < symbol_size; i++) {
+        std::string s;
+        read_string(s);
+        symbol.push_back(intern_label(s));
     }
     /// maps
 
@@ -668,11 +1214,10 @@ void tensor::deserialize(std::ifstream &buffer) {
     read_primitive(size);
 
     labels.clear();
-    if (size > 0) {
-        labels.resize(size);
-        for (std::string &label: labels) {
-            read_string(label);
-        }
+    for (size_t i = 0; i < size; i++) {
+        std::string label;
+        read_string(label);
+        labels.push_back(label);
     }
 
     // numerical_labels
@@ -0,0 +1,199 @@
+//
+// pdaggerq - A code for bringing strings of creation / annihilation operators to normal order.
+// Filename: pq_serialize.h
+// Copyright (C) 2020 A. Eugene DePrince III
+//
+// Author: A. Eugene DePrince III <adeprince@fsu.edu>
+// Maintainer: DePrince group
+//
+// This file is part of the pdaggerq package.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#ifndef PQ_SERIALIZE_H
+#define PQ_SERIALIZE_H
+
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<string_view>
+#include<unordered_map>
+#include<vector>
+
+#include "pq_string.h"
+
+namespace pdaggerq {
+
+/**
+ *
+ * layout of a saved pq_helper (version 1). all offsets are in bytes from the start of the file,
+ * and each section starts on an 8-byte boundary
+ *
+ *     pq_file_header
+ *     string table:  n_strings pq_file_string entries, followed by their characters
+ *     term records:  n_terms pq_file_term entries (ordered, then ordered_blocked)
+ *     data:          n_words uint32_t values holding the variable-length part of each term,
+ *                    the term lists of the block index, and the pq_helper settings
+ *     block index:   n_blocks pq_file_block entries
+ *
+ * every label, tensor name, and operator in the file is stored once in the string table and is
+ * referred to elsewhere by its position in that table
+ *
+ */
+inline constexpr char pq_file_magic[8] = {'P', 'Q', 'H', 'E', 'L', 'P', 'E', 'R'};
+inline constexpr uint32_t pq_file_version = 1;
+
+struct pq_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;              // bit 0: blocked by spin, bit 1: blocked by label ranges
+    uint64_t n_strings;
+    uint64_t strings_offset;
+    uint64_t n_terms;
+    uint64_t n_ordered;          // the first n_ordered term records belong to ordered
+    uint64_t terms_offset;
+    uint64_t n_words;
+    uint64_t words_offset;
+    uint64_t n_blocks;
+    uint64_t blocks_offset;
+    uint64_t settings_word;      // first word of the pq_helper settings
+};
+
+struct pq_file_string {
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct pq_file_term {
+    double factor;
+    uint64_t key;
+    uint64_t first_word;         // first word of the variable-length part of the term
+    uint32_t n_words;
+    int32_t sign;
+    uint32_t vacuum;             // string id
+    uint32_t block;              // position in the block index
+    uint8_t skip;
+    uint8_t has_w0;
+    uint8_t unused[6];
+};
+
+struct pq_file_block {
+    uint32_t section;            // 0: ordered, 1: ordered_blocked
+    uint32_t key;                // string id of the block key (see block_key())
+    uint64_t first_word;         // first word of the list of term records in the block
+    uint64_t n_terms;
+};
+
+/**
+ *
+ * the key under which a term is filed in the block index: its non-summed spin labels, sorted by
+ * label and joined as "a:a,i:b" (empty for terms that are not spin blocked)
+ *
+ * @param spin_labels: the non-summed spin labels
+ * @return: the block key
+ */
+std::string block_key(const std::unordered_map<std::string, std::string> &spin_labels);
+
+/**
+ *
+ * read-only view of a saved pq_helper. the file is memory mapped, and terms are decoded only
+ * when they are requested, so a subset of the terms (e.g., one spin block) can be read without
+ * touching the rest of the file
+ *
+ */
+class pq_mapped_file {
+
+  public:
+
+    /**
+     *
+     * map a file written by pq_helper::serialize. the section offsets, term records, and block index
+     * are checked against the header here, and the remaining entries are checked as they are read.
+     * a std::runtime_error is thrown if any of them lies outside the file
+     *
+     * @param filename: the name of the file
+     */
+    explicit pq_mapped_file(const std::string &filename);
+    ~pq_mapped_file();
+
+    pq_mapped_file(const pq_mapped_file &) = delete;
+    pq_mapped_file &operator=(const pq_mapped_file &) = delete;
+
+    /**
+     *
+     * does the file start with the magic number of the indexed format? files written by earlier
+     * versions of pdaggerq do not, and none of the accessors below may be used for them
+     *
+     */
+    bool is_indexed() const { return indexed; }
+
+    const pq_file_header & header() const { return *reinterpret_cast<const pq_file_header *>(data); }
+
+    size_t n_terms() const { return header().n_terms; }
+    size_t n_blocks() const { return header().n_blocks; }
+
+    /**
+     *
+     * entries of the string table, term records, data words, and block index. these point
+     * directly into the mapped file
+     *
+     */
+    std::string_view string(uint32_t id) const;
+    const pq_file_term & term_record(size_t i) const;
+    const uint32_t * words(uint64_t first, uint64_t count) const;
+    const pq_file_block & block(size_t i) const;
+
+    /**
+     *
+     * the term records filed under a given section and block key
+     *
+     * @param section: 0 for ordered, 1 for ordered_blocked
+     * @param key: the block key
+     * @return: the positions of the term records
+     */
+    std::vector<size_t> find_block(uint32_t section, const std::string &key) const;
+
+    /**
+     *
+     * decode a term record into a new pq_string. labels are interned once per string table entry,
+     * so this function is not thread safe
+     *
+     * @param i: the position of the term record
+     * @return: the decoded string
+     */
+    std::shared_ptr<pq_string> term(size_t i) const;
+
+    /**
+     *
+     * the interned label for a string table entry
+     *
+     */
+    pq_label label(uint32_t id) const;
+
+  private:
+
+    const char * data = nullptr;
+    size_t length = 0;
+    bool indexed = false;
+
+    // interned labels for string table entries (not_interned until first use)
+    static constexpr pq_label not_interned = ~pq_label(0);
+    mutable std::vector<pq_label> labels;
+
+};
+
+}
+
+#endif
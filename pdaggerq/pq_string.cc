@@ -200,6 +200,34 @@ bool pq_string::is_boson_normal_order() {
     return true;
 }
 
+// can the string (fermi vacuum) still be fully contracted?
+bool pq_string::is_fully_contractible() const {
+
+    // running counts of unpaired quasi-annihilators, by class
+    int n_occ = 0;
+    int n_vir = 0;
+    for (size_t i = 0; i < symbol.size(); i++) {
+        int & n = is_dagger[i] == is_dagger_fermi[i] ? n_vir : n_occ;
+        if ( is_dagger_fermi[i] ) {
+            if ( --n < 0 ) return false;
+        }else {
+            n++;
+        }
+    }
+    if ( n_occ != 0 || n_vir != 0 ) return false;
+
+    // bosons
+    int n_boson = 0;
+    for (size_t i = 0; i < is_boson_dagger.size(); i++) {
+        if ( is_boson_dagger[i] ) {
+            if ( --n_boson < 0 ) return false;
+        }else {
+            n_boson++;
+        }
+    }
+    return n_boson == 0;
+}
+
 // print string information
 void pq_string::print() const {
 
@@ -301,7 +329,7 @@ void pq_string::print() const {
     }
 
     for (size_t i = 0; i < symbol.size(); i++) {
-        printf("%s", symbol[i].c_str());
+        printf("%s", label_name(symbol[i]).c_str());
         if ( is_dagger[i] ) {
             printf("%c", '*');
         }
@@ -343,161 +371,209 @@ void pq_string::print() const {
     printf("\n");
 }
 
-// return identifier for pq_string as std::string
-std::string pq_string::get_key() {
+// mix a value into a running 64-bit hash
+static inline void hash_combine(uint64_t &seed, uint64_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 12) + (seed >> 4);
+    seed *= 0xbf58476d1ce4e5b9ULL;
+}
 
-    if (is_spin_blocked || is_range_blocked) {
-        //printf("\n");
-        //printf("    >>> WARNING <<<\n");
-        //printf("\n");
-        //printf("    pq_string::get_key() is not meant to work with spin or range blocking\n");
-        //printf("\n");
+// mix a list of labels into a running 64-bit hash
+static inline void hash_combine(uint64_t &seed, const std::vector<std::string> &labels) {
+    hash_combine(seed, labels.size());
+    for (const std::string & label : labels) {
+        hash_combine(seed, std::hash<std::string>{}(label));
     }
+}
 
-    std::string my_string = "";
+// mix a list of numerical labels into a running 64-bit hash
+static inline void hash_combine(uint64_t &seed, const std::vector<int> &numerical_labels) {
+    hash_combine(seed, numerical_labels.size());
+    for (int label : numerical_labels) {
+        hash_combine(seed, (uint64_t)(uint32_t)label);
+    }
+}
 
-    std::string tmp;
+// return structural hash for pq_string
+uint64_t pq_string::get_key() const {
 
-    if ( skip ) return my_string;
+    uint64_t seed = 0;
 
-    if ( !permutations.empty() ) {
-        // should have an even number of symbols...how many pairs?
-        size_t n = permutations.size() / 2;
-        size_t count = 0;
-        for (size_t i = 0; i < n; i++) {
-            tmp  = "P(";
-            tmp += permutations[count++];
-            tmp += ",";
-            tmp += permutations[count++];
-            tmp += ")";
-            my_string += tmp;
-        }
+    if ( skip ) return seed;
+
+    // permutation operators
+    hash_combine(seed, permutations);
+    hash_combine(seed, paired_permutations_2);
+    hash_combine(seed, paired_permutations_6);
+    hash_combine(seed, paired_permutations_3);
+
+    // creation / annihilation operators
+    hash_combine(seed, symbol.size());
+    for (size_t i = 0; i < symbol.size(); i++) {
+        hash_combine(seed, ((uint64_t)symbol[i] << 1) | (uint64_t)is_dagger[i]);
     }
 
-    if ( !paired_permutations_2.empty() ) {
-        // should have a number of symbols divisible by 4
-        size_t n = paired_permutations_2.size() / 4;
-        size_t count = 0;
-        for (size_t i = 0; i < n; i++) {
-            tmp  = "PP2(";
-            tmp += paired_permutations_2[count++];
-            tmp += ",";
-            tmp += paired_permutations_2[count++];
-            tmp += ",";
-            tmp += paired_permutations_2[count++];
-            tmp += ",";
-            tmp += paired_permutations_2[count++];
-            tmp += ")";
-            my_string += tmp;
-        }
+    // deltas
+    for (const delta_functions & delta : deltas) {
+        hash_combine(seed, delta.numerical_labels);
     }
 
-    if ( !paired_permutations_6.empty() ) {
-        // should have a number of symbols divisible by 6
-        size_t n = paired_permutations_6.size() / 6;
-        size_t count = 0;
-        for (size_t i = 0; i < n; i++) {
-            tmp  = "PP6(";
-            tmp += paired_permutations_6[count++];
-            tmp += ",";
-            tmp += paired_permutations_6[count++];
-            tmp += ",";
-            tmp += paired_permutations_6[count++];
-            tmp += ",";
-            tmp += paired_permutations_6[count++];
-            tmp += ",";
-            tmp += paired_permutations_6[count++];
-            tmp += ",";
-            tmp += paired_permutations_6[count++];
-            tmp += ")";
-            my_string += tmp;
+    // integrals
+    for (size_t type = 0; type < std::size(integral_types); type++) {
+        auto ints_it = ints.find(integral_types[type]);
+        if ( ints_it == ints.end() ) continue;
+        for (const integrals & integral : ints_it->second) {
+            hash_combine(seed, type);
+            hash_combine(seed, integral.numerical_labels);
         }
     }
 
-    if ( !paired_permutations_3.empty() ) {
-        // should have a number of symbols divisible by 6
-        size_t n = paired_permutations_3.size() / 6;
-        size_t count = 0;
-        for (size_t i = 0; i < n; i++) {
-            tmp  = "PP3(";
-            tmp += paired_permutations_3[count++];
-            tmp += ",";
-            tmp += paired_permutations_3[count++];
-            tmp += ",";
-            tmp += paired_permutations_3[count++];
-            tmp += ",";
-            tmp += paired_permutations_3[count++];
-            tmp += ",";
-            tmp += paired_permutations_3[count++];
-            tmp += ",";
-            tmp += paired_permutations_3[count++];
-            tmp += ")";
-            my_string += tmp;
+    // amplitudes
+    for (char type : amplitude_types) {
+        auto amps_it = amps.find(type);
+        if ( amps_it == amps.end() ) continue;
+        for (const amplitudes & amp : amps_it->second) {
+            hash_combine(seed, (uint64_t)type);
+            hash_combine(seed, amp.numerical_labels);
         }
     }
 
+    // bosons:
+    hash_combine(seed, is_boson_dagger.size());
+    for (bool is_bdag : is_boson_dagger) {
+        hash_combine(seed, is_bdag);
+    }
+    hash_combine(seed, has_w0);
+
+    return seed;
+}
+
+// the number of occupied, virtual, and other labels in a list, packed into one value
+static inline uint64_t label_classes(const std::vector<std::string> &labels) {
+    uint64_t n_occ = 0, n_vir = 0, n_other = 0;
+    for (const std::string & label : labels) {
+        if ( is_occ(label) )      n_occ++;
+        else if ( is_vir(label) ) n_vir++;
+        else                      n_other++;
+    }
+    return (n_occ << 42) | (n_vir << 21) | n_other;
+}
+
+// mix the label classes of a list of tensors into a running hash, independent of their order
+template <class T>
+static inline void hash_combine_classes(uint64_t &seed, const std::vector<T> &tensors) {
+    std::vector<uint64_t> classes;
+    classes.reserve(tensors.size());
+    for (const T & t : tensors) {
+        classes.push_back(label_classes(t.labels));
+    }
+    std::sort(classes.begin(), classes.end());
+    hash_combine(seed, classes.size());
+    for (uint64_t c : classes) {
+        hash_combine(seed, c);
+    }
+}
+
+// return hash that is invariant to swapping labels of the same class
+uint64_t pq_string::get_signature() const {
+
+    uint64_t seed = 0;
+
+    if ( skip ) return seed;
+
+    // permutation operators (these are not touched when labels are swapped)
+    hash_combine(seed, permutations);
+    hash_combine(seed, paired_permutations_2);
+    hash_combine(seed, paired_permutations_6);
+    hash_combine(seed, paired_permutations_3);
+
     // creation / annihilation operators
+    hash_combine(seed, symbol.size());
     for (size_t i = 0; i < symbol.size(); i++) {
-
-        std::string tmp_symbol = symbol[i];
-        if ( is_dagger[i] ) {
-            tmp_symbol += "*";
-        }
-        my_string += tmp_symbol;
+        hash_combine(seed, ((uint64_t)label_class(symbol[i]) << 1) | (uint64_t)is_dagger[i]);
     }
 
     // deltas
-    for (const delta_functions & delta : deltas) {
-        std::vector<std::string> numerical_labels_string(delta.numerical_labels.size());
-        std::transform(delta.numerical_labels.begin(), delta.numerical_labels.end(), numerical_labels_string.begin(),
-                       [](int num) { return std::to_string(num); });
-        my_string += "delta";
-        my_string += std::accumulate(numerical_labels_string.begin(), numerical_labels_string.end(), std::string());
-    }
+    hash_combine_classes(seed, deltas);
 
     // integrals
-    for (auto & type : integral_types) {
-        if (ints.find(type) == ints.end()) continue;
-        std::vector<integrals> &ints_vec = ints[type];
-        for (integrals & integral : ints_vec) {
-            std::vector<std::string> numerical_labels_string(integral.numerical_labels.size());
-            std::transform(integral.numerical_labels.begin(), integral.numerical_labels.end(), numerical_labels_string.begin(),
-                           [](int num) { return std::to_string(num); });
-            my_string += type;
-            my_string += std::accumulate(numerical_labels_string.begin(), numerical_labels_string.end(), std::string());
-        }
+    for (size_t type = 0; type < std::size(integral_types); type++) {
+        auto ints_it = ints.find(integral_types[type]);
+        if ( ints_it == ints.end() || ints_it->second.empty() ) continue;
+        hash_combine(seed, type);
+        hash_combine_classes(seed, ints_it->second);
     }
 
     // amplitudes
-    for (auto & type : amplitude_types) {
-        if (amps.find(type) == amps.end()) continue;
-        std::vector<amplitudes> &amps_vec = amps[type];
-        for (amplitudes & amp : amps_vec) {
-            std::vector<std::string> numerical_labels_string(amp.numerical_labels.size());
-            std::transform(amp.numerical_labels.begin(), amp.numerical_labels.end(), numerical_labels_string.begin(),
-                           [](int num) { return std::to_string(num); });
-            my_string += type;
-            my_string += std::accumulate(numerical_labels_string.begin(), numerical_labels_string.end(), std::string());
-        }
+    for (char type : amplitude_types) {
+        auto amps_it = amps.find(type);
+        if ( amps_it == amps.end() || amps_it->second.empty() ) continue;
+        hash_combine(seed, (uint64_t)type);
+        hash_combine_classes(seed, amps_it->second);
     }
 
     // bosons:
-    for (auto && is_bdag : is_boson_dagger) {
-        if ( is_bdag ) {
-            my_string += "B*";
-        }else {
-            my_string += "B";
+    hash_combine(seed, is_boson_dagger.size());
+    for (bool is_bdag : is_boson_dagger) {
+        hash_combine(seed, is_bdag);
+    }
+    hash_combine(seed, has_w0);
+
+    return seed;
+}
+
+// compare the structure of two strings
+bool pq_string::same_key(const pq_string &other) const {
+
+    if ( skip != other.skip ) return false;
+    if ( skip ) return true;
+
+    if ( has_w0 != other.has_w0 ) return false;
+    if ( !(is_boson_dagger == other.is_boson_dagger) ) return false;
+
+    // creation / annihilation operators
+    if ( symbol != other.symbol ) return false;
+    if ( !(is_dagger == other.is_dagger) ) return false;
+
+    // permutation operators
+    if ( permutations != other.permutations ) return false;
+    if ( paired_permutations_2 != other.paired_permutations_2 ) return false;
+    if ( paired_permutations_3 != other.paired_permutations_3 ) return false;
+    if ( paired_permutations_6 != other.paired_permutations_6 ) return false;
+
+    // deltas
+    if ( deltas.size() != other.deltas.size() ) return false;
+    for (size_t i = 0; i < deltas.size(); i++) {
+        if ( !(deltas[i] == other.deltas[i]) ) return false;
+    }
+
+    // tensors of a given type must match one-to-one (a missing type is the same as an empty one)
+    auto same_tensors = [](const auto &map1, const auto &map2, const auto &type) {
+        auto it1 = map1.find(type);
+        auto it2 = map2.find(type);
+        size_t n1 = it1 == map1.end() ? 0 : it1->second.size();
+        size_t n2 = it2 == map2.end() ? 0 : it2->second.size();
+        if ( n1 != n2 ) return false;
+        for (size_t i = 0; i < n1; i++) {
+            if ( it1->second[i].numerical_labels != it2->second[i].numerical_labels ) return false;
         }
+        return true;
+    };
+
+    // integrals
+    for (const std::string & type : integral_types) {
+        if ( !same_tensors(ints, other.ints, type) ) return false;
     }
-    if ( has_w0 ) {
-        my_string += "w0";
+
+    // amplitudes
+    for (char type : amplitude_types) {
+        if ( !same_tensors(amps, other.amps, type) ) return false;
     }
 
-    return my_string;
+    return true;
 }
 
 // return string information
-std::vector<std::string> pq_string::get_string() {
+std::vector<std::string> pq_string::get_string(bool is_spin_blocked, bool is_range_blocked) {
 
     std::vector<std::string> my_string;
 
@@ -609,7 +685,7 @@ std::vector<std::string> pq_string::get_string() {
         if ( is_dagger[i] ) {
             tmp_symbol += "*";
         }
-        tmp_symbol += "(" + symbol[i] + ")";
+        tmp_symbol += "(" + label_name(symbol[i]) + ")";
         my_string.push_back(tmp_symbol);
     }
 
@@ -737,6 +813,36 @@ void pq_string::copy(void * copy_me, bool copy_daggers_and_symbols) {
     }
 }
 
+// move string data out of a string that is no longer needed, possibly excluding symbols and daggers
+void pq_string::take(pq_string & take_me, bool copy_daggers_and_symbols) {
+
+    // the scalar data is copied, so take_me can still be asked about its skip flag, etc.
+    vacuum = take_me.vacuum;
+    skip   = take_me.skip;
+    sign   = take_me.sign;
+    factor = take_me.factor;
+    has_w0 = take_me.has_w0;
+
+    // deltas, tensors, and permutations are moved
+    deltas                 = std::move(take_me.deltas);
+    ints                   = std::move(take_me.ints);
+    amps                   = std::move(take_me.amps);
+    non_summed_spin_labels = std::move(take_me.non_summed_spin_labels);
+    permutations           = std::move(take_me.permutations);
+    paired_permutations_2  = std::move(take_me.paired_permutations_2);
+    paired_permutations_3  = std::move(take_me.paired_permutations_3);
+    paired_permutations_6  = std::move(take_me.paired_permutations_6);
+
+    if ( copy_daggers_and_symbols ) {
+        symbol          = std::move(take_me.symbol);
+        is_dagger       = take_me.is_dagger;
+        if ( vacuum == "FERMI" ) {
+            is_dagger_fermi = take_me.is_dagger_fermi;
+        }
+        is_boson_dagger = take_me.is_boson_dagger;
+    }
+}
+
 void pq_string::set_spin_everywhere(const std::string &target, const std::string &spin) {
 
     // integrals
@@ -991,25 +1097,30 @@ void pq_string::set_amplitudes(char type, int n_create, int n_annihilate, int n_
 // how many times does an index appear amplitudes, deltas, integrals, and operators?
 int pq_string::index_in_anywhere(const std::string &idx) {
 
+    // every label is interned, so a label that was never interned appears nowhere
+    pq_label id;
+    if ( !find_label(idx, id) ) return 0;
+    return index_in_anywhere(id);
+}
+
+// how many times does an (interned) index appear amplitudes, deltas, integrals, and operators?
+int pq_string::index_in_anywhere(pq_label id) {
+
     // find index in deltas
-    int n = index_in_deltas(idx, deltas);
+    int n = index_in_deltas(id, deltas);
 
     // find index in integrals
     for (const auto & int_pair : ints) {
-        const std::string &type = int_pair.first;
-        const std::vector<integrals> &ints = int_pair.second;
-        n += index_in_integrals(idx, ints);
+        n += index_in_integrals(id, int_pair.second);
     }
 
     // find index in amplitudes
     for (const auto & amp_pair : amps) {
-        const char &type = amp_pair.first;
-        const std::vector<amplitudes> &amps = amp_pair.second;
-        n += index_in_amplitudes(idx, amps);
+        n += index_in_amplitudes(id, amp_pair.second);
     }
 
     // find index in operators
-    n += index_in_operators(idx, symbol);
+    n += index_in_operators(id, symbol);
 
     return n;
 }
@@ -24,6 +24,7 @@
 #define PQ_STRING_H
 
 #include "pq_tensor.h"
+#include "pq_label.h"
 #include<cmath>
 #include<sstream>
 #include <map>
@@ -91,9 +92,6 @@ class pq_string
 
   public:
 
-    static inline bool is_spin_blocked = false;
-    static inline bool is_range_blocked = false;
-
     /**
      *
      * constructor
@@ -119,6 +117,16 @@ class pq_string
         copy(copy_me, copy_daggers_and_symbols);
     }
 
+    /**
+     *
+     * constructor that takes over the tensors of a string that is no longer needed, without
+     * copying symbols and daggers
+     *
+     */
+    pq_string(pq_string &&take_me, bool copy_daggers_and_symbols) {
+        take(take_me, copy_daggers_and_symbols);
+    }
+
     /**
      *
      * assignment operator
@@ -273,28 +281,28 @@ class pq_string
      * a list indicating if bosonic operators are creators or annihilators
      *
      */
-    std::vector<bool> is_boson_dagger;
+    pq_bitmask is_boson_dagger;
 
     /**
      *
      * a list indicating if fermionic operators are creators or annihilators (relative to the true vacuum)
      *
      */
-    std::vector<bool> is_dagger;
+    pq_bitmask is_dagger;
 
     /**
      *
      * a list indicating if fermionic operators are creators or annihilators (relative to the fermi vacuum)
      *
      */
-    std::vector<bool> is_dagger_fermi;
+    pq_bitmask is_dagger_fermi;
 
     /**
      *
-     * a list of symbols indicating the labels on fermionic creation / annihilation operators
+     * a list of interned labels on fermionic creation / annihilation operators (see label_name())
      *
      */
-    std::vector<std::string> symbol;
+    std::vector<pq_label> symbol;
 
     /**
      *
@@ -310,6 +318,15 @@ class pq_string
      */
     bool is_boson_normal_order();
 
+    /**
+     *
+     * can the string (fermi vacuum) still yield a fully-contracted term? every quasi-creator
+     * must have an unpaired quasi-annihilator of the same (occupied / virtual) class to its
+     * left, and every boson creator an unpaired boson annihilator to its left
+     *
+     */
+    bool is_fully_contractible() const;
+
     /**
      *
      * print string information to stdout
@@ -336,23 +353,66 @@ class pq_string
     /**
      *
      * return string information as list of std::string
+     * @param is_spin_blocked: print tensors with their spin labels
+     * @param is_range_blocked: print tensors with their label ranges
+     *
+     */
+    std::vector<std::string> get_string(bool is_spin_blocked = false, bool is_range_blocked = false);
+
+    /**
+     *
+     * return a 64-bit structural hash of the string (operators, deltas, integrals, amplitudes, 
+     * and permutations). equal strings have equal keys; use same_key() to confirm a match
+     *
+     */
+    uint64_t get_key() const;
+
+    /**
+     *
+     * structural hash of the string, set by sort()
      *
      */
-    std::vector<std::string> get_string();
+    uint64_t key = 0;
 
     /**
      *
-     * return string identifier as std::string
+     * has the string been through pq_helper::simplify()? later calls to simplify() only
+     * consolidate such strings with the newly added ones
      *
      */
-    std::string get_key();
+    bool is_simplified = false;
 
     /**
      *
-     * string identifier as std::string
+     * canonical key of the string (see canonical_key()) and the number of permutations that
+     * takes the string to it, kept so that strings surviving one call to simplify() are not
+     * canonicalized again. valid while key equals canonical_for_key and the string matches
+     * canonical_source, a copy of the string as it was canonicalized (see same_key())
      *
      */
-    std::string key;
+    std::vector<int> canonical;
+    int canonical_n_permute = 0;
+    uint64_t canonical_for_key = 0;
+    std::shared_ptr<const pq_string> canonical_source;
+
+    /**
+     *
+     * return a 64-bit hash of the string that is unchanged by exchanging two labels of the same
+     * class (occupied / virtual / other). strings that can be combined after swapping summed
+     * labels always share a signature
+     *
+     */
+    uint64_t get_signature() const;
+
+    /**
+     *
+     * full structural comparison of two strings, used to confirm a match of key
+     *
+     * @param other: the string against which this one is compared
+     * @return: true if the strings differ at most by their factors and signs
+     *
+     */
+    bool same_key(const pq_string &other) const;
 
     /**
      *
@@ -363,6 +423,16 @@ class pq_string
      */
     void copy(void * copy_me, bool copy_daggers_and_symbols = true);
 
+    /**
+     *
+     * move string data out of another string, possibly excluding symbols and daggers. the
+     * tensors, deltas, and permutations of take_me are left empty
+     *
+     * @param take_me: pq_string whose data is moved
+     * @param copy_daggers_and_symbols: move the daggers and symbols, too?
+     */
+    void take(pq_string & take_me, bool copy_daggers_and_symbols = true);
+
     /**
      *
      * set spin labels in the integrals and amplitudes
@@ -428,6 +498,16 @@ class pq_string
      */
     int index_in_anywhere(const std::string &idx);
 
+    /** 
+     *
+     * how many times does an (interned) index appear amplitudes, deltas, and integrals?
+     *
+     * @param id: the interned index
+     * @return: the number of times id appears in the string
+     *
+     */
+    int index_in_anywhere(pq_label id);
+
 };
 
 }
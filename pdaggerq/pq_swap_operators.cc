@@ -24,6 +24,7 @@
 #include "pq_tensor.h"
 #include "pq_string.h"
 #include "pq_utils.h"
+#include "pq_pool.h"
 
 namespace pdaggerq {
 
@@ -37,9 +38,19 @@ bool swap_operators_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
         return true;
     }
 
-    // new strings
-    std::shared_ptr<pq_string> s1 = std::make_shared<pq_string>(in.get(), false);
-    std::shared_ptr<pq_string> s2 = std::make_shared<pq_string>(in.get(), false);
+    // the first pair of operators out of order gives a second string only if their daggers differ
+    bool two_strings = false;
+    for (int i = 0; i < (int)in->symbol.size()-1; i++) {
+        if ( !in->is_dagger_fermi[i] && in->is_dagger_fermi[i+1] ) {
+            two_strings = ( in->is_dagger[i] != in->is_dagger[i+1] );
+            break;
+        }
+    }
+
+    // new strings. in is not needed once it has been rearranged, so s1 takes over its tensors,
+    // and only s2 copies them
+    std::shared_ptr<pq_string> s2 = two_strings ? make_transient_string(in.get(), false) : nullptr;
+    std::shared_ptr<pq_string> s1 = make_transient_string(std::move(*in), false);
 
     // rearrange operators
 
@@ -62,8 +73,8 @@ bool swap_operators_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
             // delta function
             std::vector<std::string> labels;
             delta_functions deltas;
-            deltas.labels.push_back(in->symbol[i]);
-            deltas.labels.push_back(in->symbol[i+1]);
+            deltas.labels.push_back(label_name(in->symbol[i]));
+            deltas.labels.push_back(label_name(in->symbol[i+1]));
             deltas.sort();
             s1->deltas.push_back(deltas);
 
@@ -114,14 +125,14 @@ bool swap_operators_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
         }else {
 
             s1->symbol.push_back(in->symbol[i]);
-            s2->symbol.push_back(in->symbol[i]);
-
             s1->is_dagger.push_back(in->is_dagger[i]);
-            s2->is_dagger.push_back(in->is_dagger[i]);
-
             s1->is_dagger_fermi.push_back(in->is_dagger_fermi[i]);
-            s2->is_dagger_fermi.push_back(in->is_dagger_fermi[i]);
 
+            if ( s2 ) {
+                s2->symbol.push_back(in->symbol[i]);
+                s2->is_dagger.push_back(in->is_dagger[i]);
+                s2->is_dagger_fermi.push_back(in->is_dagger_fermi[i]);
+            }
         }
     }
 
@@ -141,9 +152,9 @@ bool swap_operators_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
             }
         }else {
 
-            // new strings
-            std::shared_ptr<pq_string> s1a = std::make_shared<pq_string>(*s1);
-            std::shared_ptr<pq_string> s1b = std::make_shared<pq_string>(*s1);
+            // new strings (s1b takes over s1)
+            std::shared_ptr<pq_string> s1a = make_transient_string(*s1);
+            std::shared_ptr<pq_string> s1b = make_transient_string(std::move(*s1));
 
             // ensure boson daggers are clear (they should be anyway)
             s1a->is_boson_dagger.clear();
@@ -194,11 +205,11 @@ bool swap_operators_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
             }
         }else {
 
-            // new strings
-            std::shared_ptr<pq_string> s1a = std::make_shared<pq_string>(*s1);
-            std::shared_ptr<pq_string> s1b = std::make_shared<pq_string>(*s1);
-            std::shared_ptr<pq_string> s2a = std::make_shared<pq_string>(*s2);
-            std::shared_ptr<pq_string> s2b = std::make_shared<pq_string>(*s2);
+            // new strings (s1b and s2b take over s1 and s2)
+            std::shared_ptr<pq_string> s1a = make_transient_string(*s1);
+            std::shared_ptr<pq_string> s1b = make_transient_string(std::move(*s1));
+            std::shared_ptr<pq_string> s2a = make_transient_string(*s2);
+            std::shared_ptr<pq_string> s2b = make_transient_string(std::move(*s2));
 
             // ensure boson daggers are clear (they should be anyway)
             s1a->is_boson_dagger.clear();
@@ -282,9 +293,10 @@ bool swap_operators_true_vacuum(const std::shared_ptr<pq_string> &in, std::vecto
         return true;
     }
 
-    // new strings
-    std::shared_ptr<pq_string> s1 = std::make_shared<pq_string>(in.get(), false);
-    std::shared_ptr<pq_string> s2 = std::make_shared<pq_string>(in.get(), false);
+    // new strings. in is not needed once it has been rearranged, so s1 takes over its tensors,
+    // and only s2 copies them
+    std::shared_ptr<pq_string> s2 = make_transient_string(in.get(), false);
+    std::shared_ptr<pq_string> s1 = make_transient_string(std::move(*in), false);
 
     // rearrange operators
     for (int i = 0; i < (int)in->symbol.size()-1; i++) {
@@ -295,8 +307,8 @@ bool swap_operators_true_vacuum(const std::shared_ptr<pq_string> &in, std::vecto
 
             std::vector<std::string> labels;
             delta_functions deltas;
-            deltas.labels.push_back(in->symbol[i]);
-            deltas.labels.push_back(in->symbol[i+1]);
+            deltas.labels.push_back(label_name(in->symbol[i]));
+            deltas.labels.push_back(label_name(in->symbol[i+1]));
             deltas.sort();
             s1->deltas.push_back(deltas);
 
@@ -342,11 +354,11 @@ bool swap_operators_true_vacuum(const std::shared_ptr<pq_string> &in, std::vecto
 
     }else {
 
-        // new strings
-        std::shared_ptr<pq_string> s1a = std::make_shared<pq_string>(*s1);
-        std::shared_ptr<pq_string> s1b = std::make_shared<pq_string>(*s1);
-        std::shared_ptr<pq_string> s2a = std::make_shared<pq_string>(*s2);
-        std::shared_ptr<pq_string> s2b = std::make_shared<pq_string>(*s2);
+        // new strings (s1b and s2b take over s1 and s2)
+        std::shared_ptr<pq_string> s1a = make_transient_string(*s1);
+        std::shared_ptr<pq_string> s1b = make_transient_string(std::move(*s1));
+        std::shared_ptr<pq_string> s2a = make_transient_string(*s2);
+        std::shared_ptr<pq_string> s2b = make_transient_string(std::move(*s2));
 
         // ensure boson daggers are clear (they should be anyway)
         s1a->is_boson_dagger.clear();
@@ -35,7 +35,8 @@ namespace pdaggerq {
  *
  * swap two operators in a string to bring that string toward normal order with respect to the fermi vacuum
  *
- * @param in: the input string
+ * @param in: the input string. unless it is already in normal order, the new strings take over its
+ * tensors, and it must not be used afterward
  * @param ordered: a list of strings to which the new strings will be added after applying appropriate rules for the swap
  */
 bool swap_operators_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vector<std::shared_ptr<pq_string> > &ordered);
@@ -44,7 +45,8 @@ bool swap_operators_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
  *
  * swap two operators in a string to bring that string toward normal order with respect to the true vacuum
  *
- * @param in: the input string
+ * @param in: the input string. unless it is already in normal order, the new strings take over its
+ * tensors, and it must not be used afterward
  * @param ordered: a list of strings to which the new strings will be added after applying appropriate rules for the swap
  */
 bool swap_operators_true_vacuum(const std::shared_ptr<pq_string> &in, std::vector<std::shared_ptr<pq_string> > &ordered);
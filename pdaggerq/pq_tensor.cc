@@ -34,7 +34,7 @@ void amplitudes::sort() {
     numerical_labels.clear();
 
     // convert labels to numerical labels
-    for (std::string & label : labels) {
+    for (const std::string & label : labels) {
         int numerical_label = 0;
         int factor = 1;
         for (char letter : label) {
@@ -88,6 +88,7 @@ amplitudes& amplitudes::operator=(const amplitudes& rhs) {
 
     n_create = rhs.n_create;
     n_annihilate = rhs.n_annihilate;
+    n_ph = rhs.n_ph;
 
     return *this;
 }
@@ -256,7 +257,7 @@ void integrals::sort() {
     numerical_labels.clear();
 
     // convert labels to numerical labels
-    for (std::string & label : labels) {
+    for (const std::string & label : labels) {
         int numerical_label = 0;
         int factor = 1;
         for (char letter : label) {
@@ -574,7 +575,7 @@ void delta_functions::sort() {
     numerical_labels.clear();
 
     // convert labels to numerical labels
-    for (std::string & label : labels) {
+    for (const std::string & label : labels) {
         int numerical_label = 0;
         int factor = 1;
         for (char letter : label) {
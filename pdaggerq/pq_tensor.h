@@ -28,6 +28,8 @@
 #include <iostream>
 #include <fstream>
 
+#include "pq_label.h"
+
 namespace pdaggerq {
 
 class tensor {
@@ -50,10 +52,10 @@ class tensor {
 
     /**
      *
-     * human readable tensor labels
+     * human readable tensor labels (interned)
      *
      */
-    std::vector<std::string> labels;
+    pq_label_list labels;
 
     /**
      *
@@ -298,6 +300,9 @@ class amplitudes: public tensor {
 
         // n_annihilate
         buffer.write(reinterpret_cast<const char *>(&n_annihilate), sizeof(n_annihilate));
+
+        // n_ph
+        buffer.write(reinterpret_cast<const char *>(&n_ph), sizeof(n_ph));
     }
 
     /**
@@ -315,6 +320,9 @@ class amplitudes: public tensor {
 
         // n_annihilate
         buffer.read(reinterpret_cast<char *>(&n_annihilate), sizeof(n_annihilate));
+
+        // n_ph
+        buffer.read(reinterpret_cast<char *>(&n_ph), sizeof(n_ph));
     }
 
 
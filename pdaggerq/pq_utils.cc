@@ -24,6 +24,12 @@
 #include "pq_string.h"
 #include "pq_utils.h"
 #include "pq_swap_operators.h"
+#include "pq_wick.h"
+#include "pq_pool.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include <algorithm>
 #include <numeric>
@@ -111,12 +117,21 @@ bool is_vir(const std::string &idx) {
 // how many times does an index appear deltas?
 int index_in_deltas(const std::string &idx, const std::vector<delta_functions> &deltas) {
 
+    // tensor labels are interned, so a label that was never interned cannot appear
+    pq_label id;
+    if ( !find_label(idx, id) ) return 0;
+    return index_in_deltas(id, deltas);
+}
+
+// how many times does an (interned) index appear deltas?
+int index_in_deltas(pq_label id, const std::vector<delta_functions> &deltas) {
+
     int n = 0;
     for (const delta_functions & delta : deltas) {
-        if ( delta.labels[0] == idx ) {
+        if ( delta.labels.id(0) == id ) {
             n++;
         }
-        if ( delta.labels[1] == idx ) {
+        if ( delta.labels.id(1) == id ) {
             n++;
         }
     }
@@ -126,10 +141,18 @@ int index_in_deltas(const std::string &idx, const std::vector<delta_functions> &
 // how many times does an index appear integrals?
 int index_in_integrals(const std::string &idx, const std::vector<integrals> &ints) {
 
+    pq_label id;
+    if ( !find_label(idx, id) ) return 0;
+    return index_in_integrals(id, ints);
+}
+
+// how many times does an (interned) index appear integrals?
+int index_in_integrals(pq_label id, const std::vector<integrals> &ints) {
+
     int n = 0;
     for (const integrals & integral : ints) {
-        for (const std::string & label : integral.labels) {
-            if (label == idx ) {
+        for (size_t i = 0; i < integral.labels.size(); i++) {
+            if ( integral.labels.id(i) == id ) {
                 n++;
             }
         }
@@ -140,10 +163,18 @@ int index_in_integrals(const std::string &idx, const std::vector<integrals> &int
 // how many times does an index appear in amplitudes?
 int index_in_amplitudes(const std::string &idx, const std::vector<amplitudes> &amps) {
 
+    pq_label id;
+    if ( !find_label(idx, id) ) return 0;
+    return index_in_amplitudes(id, amps);
+}
+
+// how many times does an (interned) index appear in amplitudes?
+int index_in_amplitudes(pq_label id, const std::vector<amplitudes> &amps) {
+
     int n = 0;
     for (const amplitudes & amp : amps) {
-        for (const std::string & label : amp.labels) {
-            if ( label == idx ) {
+        for (size_t i = 0; i < amp.labels.size(); i++) {
+            if ( amp.labels.id(i) == id ) {
                 n++;
             }
         }
@@ -152,45 +183,43 @@ int index_in_amplitudes(const std::string &idx, const std::vector<amplitudes> &a
 }
 
 // how many times does an index appear in operators (symbol)?
-int index_in_operators(const std::string &idx, const std::vector<std::string> &ops) {
+int index_in_operators(const std::string &idx, const std::vector<pq_label> &ops) {
 
+    // compare names through the (lock-free) label table rather than interning idx
     int n = 0;
-    for (const std::string & op : ops) {
-        if ( op == idx ) {
-            n++;
-        }
+    for (pq_label op : ops) {
+        if ( label_name(op) == idx ) n++;
     }
     return n;
 }
 
+// how many times does an (interned) index appear in operators (symbol)?
+int index_in_operators(pq_label id, const std::vector<pq_label> &ops) {
+    return (int)std::count(ops.begin(), ops.end(), id);
+}
+
 // does an index appear amplitudes, deltas, integrals, and operators?
 bool found_index_anywhere(const std::shared_ptr<pq_string> &in, const std::string &idx) {
 
+    // every label is interned, so a label that was never interned appears nowhere
+    pq_label id;
+    if ( !find_label(idx, id) ) return false;
+
     // find index in deltas
-    for (const delta_functions & delta : in->deltas) {
-        if ( std::find(delta.labels.begin(), delta.labels.end(), idx) != delta.labels.end() ) return true;
-    }
+    if ( index_in_deltas(id, in->deltas) > 0 ) return true;
 
     // find index in integrals
     for (const auto & int_pair : in->ints) {
-        const std::string &type = int_pair.first;
-        const std::vector<integrals> &ints = int_pair.second;
-        for (const integrals & integral : ints) {
-            if ( std::find(integral.labels.begin(), integral.labels.end(), idx) != integral.labels.end() ) return true;
-        }
+        if ( index_in_integrals(id, int_pair.second) > 0 ) return true;
     }
 
     // find index in amplitudes
     for (const auto & amp_pair : in->amps) {
-        const char &type = amp_pair.first;
-        const std::vector<amplitudes> &amps = amp_pair.second;
-        for (const amplitudes & amp : amps) {
-            if ( std::find(amp.labels.begin(), amp.labels.end(), idx) != amp.labels.end() ) return true;
-        }
+        if ( index_in_amplitudes(id, amp_pair.second) > 0 ) return true;
     }
 
     // find index in operators
-    if ( std::find(in->symbol.begin(), in->symbol.end(), idx) != in->symbol.end() ) return true;
+    if ( index_in_operators(id, in->symbol) > 0 ) return true;
 
     return false;
 }
@@ -208,12 +237,20 @@ void replace_index_in_permutations(const std::string &old_idx, const std::string
 /// replace one label with another (in a given set of deltas)
 void replace_index_in_deltas(const std::string &old_idx, const std::string &new_idx, std::vector<delta_functions> &deltas) {
 
+    pq_label old_id;
+    if ( !find_label(old_idx, old_id) ) return;
+    replace_index_in_deltas(old_id, intern_label(new_idx), deltas);
+}
+
+/// replace one (interned) label with another (in a given set of deltas)
+void replace_index_in_deltas(pq_label old_id, pq_label new_id, std::vector<delta_functions> &deltas) {
+
     for (delta_functions & delta : deltas) {
-        if ( delta.labels[0] == old_idx ) {
-            delta.labels[0] = new_idx;
+        if ( delta.labels.id(0) == old_id ) {
+            delta.labels.set(0, new_id);
         }
-        if ( delta.labels[1] == old_idx ) {
-            delta.labels[1] = new_idx;
+        if ( delta.labels.id(1) == old_id ) {
+            delta.labels.set(1, new_id);
         }
     }
 }
@@ -221,10 +258,18 @@ void replace_index_in_deltas(const std::string &old_idx, const std::string &new_
 /// replace one label with another (in a given set of amplitudes)
 void replace_index_in_amplitudes(const std::string &old_idx, const std::string &new_idx, std::vector<amplitudes> &amps) {
 
+    pq_label old_id;
+    if ( !find_label(old_idx, old_id) ) return;
+    replace_index_in_amplitudes(old_id, intern_label(new_idx), amps);
+}
+
+/// replace one (interned) label with another (in a given set of amplitudes)
+void replace_index_in_amplitudes(pq_label old_id, pq_label new_id, std::vector<amplitudes> &amps) {
+
     for (amplitudes & amp : amps) {
-        for (std::string & label : amp.labels) {
-            if ( label == old_idx ) {
-                label = new_idx;
+        for (size_t i = 0; i < amp.labels.size(); i++) {
+            if ( amp.labels.id(i) == old_id ) {
+                amp.labels.set(i, new_id);
             }
         }
     }
@@ -233,21 +278,39 @@ void replace_index_in_amplitudes(const std::string &old_idx, const std::string &
 /// replace one label with another (in a given set of integrals)
 void replace_index_in_integrals(const std::string &old_idx, const std::string &new_idx, std::vector<integrals> &ints) {
 
+    pq_label old_id;
+    if ( !find_label(old_idx, old_id) ) return;
+    replace_index_in_integrals(old_id, intern_label(new_idx), ints);
+}
+
+/// replace one (interned) label with another (in a given set of integrals)
+void replace_index_in_integrals(pq_label old_id, pq_label new_id, std::vector<integrals> &ints) {
+
     for (integrals & integral : ints) {
-        for (std::string & label : integral.labels) {
-            if (label == old_idx ) {
-                label = new_idx;
+        for (size_t i = 0; i < integral.labels.size(); i++) {
+            if ( integral.labels.id(i) == old_id ) {
+                integral.labels.set(i, new_id);
             }
         }
     }
 }
 
 /// replace one label with another (in a given set of operators (symbol))
-void replace_index_in_operators(const std::string &old_idx, const std::string &new_idx, std::vector<std::string> &ops) {
+void replace_index_in_operators(const std::string &old_idx, const std::string &new_idx, std::vector<pq_label> &ops) {
+
+    // find old_idx by name so that no lookup is needed when it does not appear
+    auto it = std::find_if(ops.begin(), ops.end(), [&old_idx](pq_label op) { return label_name(op) == old_idx; });
+    if ( it == ops.end() ) return;
+
+    replace_index_in_operators(*it, intern_label(new_idx), ops);
+}
+
+/// replace one (interned) label with another (in a given set of operators (symbol))
+void replace_index_in_operators(pq_label old_id, pq_label new_id, std::vector<pq_label> &ops) {
 
-    for (std::string & op : ops) {
-        if (op == old_idx ) {
-            op = new_idx;
+    for (pq_label & op : ops) {
+        if (op == old_id ) {
+            op = new_id;
         }
     }
 }
@@ -264,21 +327,24 @@ void swap_two_labels(std::shared_ptr<pq_string> &in, const std::string &label1,
 // replace one label with another (in integrals, amplitudes, and operators)
 void replace_index_everywhere(std::shared_ptr<pq_string> &in, const std::string &old_idx, const std::string &new_idx) {
 
+    // every label is interned, so a label that was never interned appears nowhere
+    pq_label old_id;
+    if ( !find_label(old_idx, old_id) ) return;
+    pq_label new_id = intern_label(new_idx);
+
     for (auto &int_pair : in->ints) {
-        std::string type = int_pair.first;
         std::vector<integrals> &ints = int_pair.second;
-        replace_index_in_integrals(old_idx, new_idx, ints);
+        replace_index_in_integrals(old_id, new_id, ints);
     }
 
     for (auto &amp_pair : in->amps) {
-        char type = amp_pair.first;
         std::vector<amplitudes> &amps = amp_pair.second;
-        replace_index_in_amplitudes(old_idx, new_idx, amps);
+        replace_index_in_amplitudes(old_id, new_id, amps);
     }
 
-    replace_index_in_operators(old_idx, new_idx, in->symbol);
+    replace_index_in_operators(old_id, new_id, in->symbol);
 
-    replace_index_in_deltas(old_idx, new_idx, in->deltas);
+    replace_index_in_deltas(old_id, new_id, in->deltas);
 
     //replace_index_in_permutations(old_idx, new_idx, in->permutations);
     //in->sort();
@@ -287,7 +353,7 @@ void replace_index_everywhere(std::shared_ptr<pq_string> &in, const std::string
 // compare two strings
 bool compare_strings(const std::shared_ptr<pq_string> &ordered_1, const std::shared_ptr<pq_string> &ordered_2, int & n_permute) {
 
-    if ( ordered_1->key != ordered_2->key ) {
+    if ( ordered_1->key != ordered_2->key || !ordered_1->same_key(*ordered_2) ) {
         return false;
     }
 
@@ -315,56 +381,56 @@ bool compare_strings(const std::shared_ptr<pq_string> &ordered_1, const std::sha
     return true;
 }
 
-/// check map for strings when swapping (multiple) summed labels
-std::string check_map_for_strings_with_swapped_summed_labels(
+/// check map for strings when swapping (multiple) summed labels. returns the position
+/// of the matching string in ordered (only meaningful if string_in_map is true)
+size_t check_map_for_strings_with_swapped_summed_labels(
     const std::vector<std::vector<std::string> > &labels,
     size_t iter,
     const std::shared_ptr<pq_string> &in,
-    const std::unordered_map<std::string, size_t> & string_map,
+    const std::unordered_map<uint64_t, std::vector<size_t> > & string_map,
     std::vector<std::shared_ptr<pq_string> > &ordered,
     int & n_permute, 
     bool & string_in_map) {
  
     if ( iter == labels.size() ) {
 
-        std::string key = in->key;
+        // is string in map? check every string with the same hash
+        auto it = string_map.find(in->key);
+        if ( it != string_map.end() ) {
 
-        // is string in map?
-        if (string_map.find(key) != string_map.end()) {
+            for (size_t j : it->second) {
 
-            string_in_map = true; 
-            //std::shared_ptr<pq_string> existing = std::make_shared<pq_string>(*string_map.at(key));
-            size_t j = string_map.at(key);
+                if ( !in->same_key(*ordered[j]) ) continue;
 
-            // accumulate permutations of amplitudes
-            n_permute = 0;
-            for (const auto &amp_pair : in->amps) {
-                char type = amp_pair.first;
-                const std::vector<amplitudes> &amps1 = amp_pair.second;
-                //const std::vector<amplitudes> &amps2 = existing->amps.at(type);
-                const std::vector<amplitudes> &amps2 = ordered[j]->amps.at(type);
-                for (size_t i = 0; i < amps1.size(); i++) {
-                    n_permute += amps1[i].permutations + amps2[i].permutations;
-                }
-            }
+                string_in_map = true; 
 
-            // accumulate permutations of integrals
-            for (const auto &int_pair : in->ints) {
-                std::string type = int_pair.first;
-                const std::vector<integrals> &ints1 = int_pair.second;
-                //const std::vector<integrals> &ints2 = existing->ints.at(type);
-                const std::vector<integrals> &ints2 = ordered[j]->ints.at(type);
-                for (size_t i = 0; i < ints1.size(); i++) {
-                    n_permute += ints1[i].permutations + ints2[i].permutations;
+                // accumulate permutations of amplitudes
+                n_permute = 0;
+                for (const auto &amp_pair : in->amps) {
+                    char type = amp_pair.first;
+                    const std::vector<amplitudes> &amps1 = amp_pair.second;
+                    const std::vector<amplitudes> &amps2 = ordered[j]->amps.at(type);
+                    for (size_t i = 0; i < amps1.size(); i++) {
+                        n_permute += amps1[i].permutations + amps2[i].permutations;
+                    }
                 }
-            }
 
-            return key;
+                // accumulate permutations of integrals
+                for (const auto &int_pair : in->ints) {
+                    std::string type = int_pair.first;
+                    const std::vector<integrals> &ints1 = int_pair.second;
+                    const std::vector<integrals> &ints2 = ordered[j]->ints.at(type);
+                    for (size_t i = 0; i < ints1.size(); i++) {
+                        n_permute += ints1[i].permutations + ints2[i].permutations;
+                    }
+                }
 
-        }else {
-            string_in_map = false;
-            return "blurf";
+                return j;
+            }
         }
+
+        string_in_map = false;
+        return 0;
     }
 
     // try swapping non-summed labels
@@ -373,15 +439,13 @@ std::string check_map_for_strings_with_swapped_summed_labels(
     
             std::shared_ptr<pq_string> newguy = std::make_shared<pq_string>(*in);
             swap_two_labels(newguy, labels[iter][id1], labels[iter][id2]);
-            //newguy->sort();
 
-            //compare_strings_with_swapped_summed_labels(labels, iter+1, newguy, in2, n_permute, string_in_map);
-            std::string res = check_map_for_strings_with_swapped_summed_labels(labels, iter+1, newguy, string_map, ordered, n_permute, string_in_map);
+            size_t res = check_map_for_strings_with_swapped_summed_labels(labels, iter+1, newguy, string_map, ordered, n_permute, string_in_map);
             if ( string_in_map ) return res; 
         }
     }
     string_in_map = false;
-    return "blurf";
+    return 0;
 }
 
 /// compare two strings when swapping (multiple) summed labels
@@ -411,19 +475,41 @@ void compare_strings_with_swapped_summed_labels(const std::vector<std::vector<st
     }
 }
 
-// consolidate terms that differ may differ by permutations of summed labels
-void consolidate_permutations_plus_swaps(std::vector<std::shared_ptr<pq_string> > &ordered,
-                                     const std::vector<std::vector<std::string> > &labels) {
+// split the non-skipped strings into shards by their label-swap-invariant signature. each shard
+// lists its strings in the original order, so a shard-by-shard scan gives the same result as a
+// scan over the whole list, independent of the number of shards
+static std::vector< std::vector<size_t> > shard_by_signature(const std::vector<std::shared_ptr<pq_string> > &ordered) {
 
-    if ( ordered.size() == 0 ) {
-        return;
-    }
+    size_t n_shards = 1;
+#ifdef _OPENMP
+    n_shards = 4 * (size_t)omp_get_max_threads();
+#endif
 
-    std::unordered_map<std::string, size_t> string_map;
+    std::vector<uint64_t> signatures(ordered.size(), 0);
+    if ( n_shards > 1 ) {
+        #pragma omp parallel for schedule(static) default(none) shared(ordered, signatures)
+        for (size_t i = 0; i < ordered.size(); i++) {
+            if ( !ordered[i]->skip ) signatures[i] = ordered[i]->get_signature();
+        }
+    }
 
+    std::vector< std::vector<size_t> > shards(n_shards);
     for (size_t i = 0; i < ordered.size(); i++) {
-
         if ( ordered[i]->skip ) continue;
+        shards[signatures[i] % n_shards].push_back(i);
+    }
+    return shards;
+}
+
+// consolidate the strings ordered[indices[0]], ordered[indices[1]], ... (indices increasing)
+static void consolidate_permutations_plus_swaps_in_shard(std::vector<std::shared_ptr<pq_string> > &ordered,
+                                                         const std::vector<std::vector<std::string> > &labels,
+                                                         const std::vector<size_t> &indices) {
+
+    // map structural hashes onto the strings that carry them
+    std::unordered_map<uint64_t, std::vector<size_t> > string_map;
+
+    for (size_t i : indices) {
 
         // ok, what summed / repeated labels do we have?
         std::vector<std::vector<std::string> > found_labels;
@@ -443,26 +529,25 @@ void consolidate_permutations_plus_swaps(std::vector<std::shared_ptr<pq_string>
         int n_permute = 0;
         bool string_in_map = false;
 
-        std::string res = check_map_for_strings_with_swapped_summed_labels(found_labels, 0, ordered[i], string_map, ordered, n_permute, string_in_map);
+        size_t j = check_map_for_strings_with_swapped_summed_labels(found_labels, 0, ordered[i], string_map, ordered, n_permute, string_in_map);
 
         if ( !string_in_map ) {
 
             // new term in map
-            string_map[ordered[i]->key] = i; 
+            string_map[ordered[i]->key].push_back(i); 
 
         }else {
 
             // update factor for existing term in map
 
-            size_t j = string_map.at(res);
             double factor_i = ordered[i]->factor * ordered[i]->sign;
             double factor_j = ordered[j]->factor * ordered[j]->sign;
 
             double combined_factor = factor_j + factor_i * pow(-1.0, n_permute);
 
             if ( fabs(combined_factor) < 1e-12 ) {
-                auto it = string_map.find(res);
-                string_map.erase(it);
+                std::vector<size_t> & same_hash = string_map.at(ordered[j]->key);
+                same_hash.erase(std::find(same_hash.begin(), same_hash.end(), j));
                 ordered[i]->skip = true;
                 ordered[j]->skip = true;
                 continue;
@@ -477,6 +562,25 @@ void consolidate_permutations_plus_swaps(std::vector<std::shared_ptr<pq_string>
             }
         }
     }
+}
+
+// consolidate terms that differ may differ by permutations of summed labels
+void consolidate_permutations_plus_swaps(std::vector<std::shared_ptr<pq_string> > &ordered,
+                                     const std::vector<std::vector<std::string> > &labels) {
+
+    if ( ordered.size() == 0 ) {
+        return;
+    }
+
+    // strings can only be combined if they have the same label-swap-invariant signature,
+    // so the shards can be consolidated independently
+    std::vector< std::vector<size_t> > shards = shard_by_signature(ordered);
+    size_t n_shards = shards.size();
+
+    #pragma omp parallel for schedule(dynamic) default(none) shared(ordered, labels, shards, n_shards)
+    for (size_t shard = 0; shard < n_shards; shard++) {
+        consolidate_permutations_plus_swaps_in_shard(ordered, labels, shards[shard]);
+    }
 
 /*
     // old O(N^2) sort
@@ -536,6 +640,427 @@ void consolidate_permutations_plus_swaps(std::vector<std::shared_ptr<pq_string>
 
 }
 
+// a tensor (or the operator string) of a term, viewed as a vertex of the term's contraction graph.
+// summed labels are the edges
+struct contraction_vertex {
+
+    // what kind of vertex: 0 = integral, 1 = amplitude, 2 = delta function, 3 = operators
+    int kind = 0;
+
+    // position of the tensor type in integral_types / amplitude_types
+    int type = 0;
+
+    // the number of photons (amplitudes only)
+    int n_ph = 0;
+
+    // label-independent description of the vertex. only vertices with equal invariants can
+    // be exchanged by a relabeling of summed labels
+    std::vector<int> invariant;
+
+    // for each label slot, the index of the summed label it carries (or -1)
+    std::vector<int> summed;
+
+    // for each label slot, the numerical label (meaningful for labels that are not summed)
+    std::vector<int> numerical_labels;
+
+    // the antisymmetric group that a label slot belongs to. labels within a group are sorted
+    // by pq_string::sort(), so the slot within a group does not matter
+    int group(size_t slot) const {
+        if ( kind == 0 ) return summed.size() == 4 ? (int)slot / 2 : (int)slot;
+        if ( kind == 3 ) return (int)slot;
+        return 0;
+    }
+};
+
+// the numerical value of a label, as used by tensor::sort()
+static int numerical_label(const std::string &label) {
+    int value = 0;
+    int factor = 1;
+    for (char letter : label) {
+        value += factor * letter;
+        factor *= 128;
+    }
+    return value;
+}
+
+// the numerical labels that pq_string::sort() would produce after renaming the summed labels, in
+// a fixed order, and the number of label permutations that sort() would count
+static std::vector<int> relabeled_sequence(const std::vector<contraction_vertex> &vertices,
+                                           const std::vector<int> &new_labels,
+                                           int &n_permute) {
+
+    n_permute = 0;
+
+    std::map<std::pair<int, int>, std::vector<std::vector<int> > > tensors;
+    for (const contraction_vertex & vertex : vertices) {
+
+        std::vector<int> numerical_labels = vertex.numerical_labels;
+        for (size_t slot = 0; slot < numerical_labels.size(); slot++) {
+            if ( vertex.summed[slot] >= 0 ) numerical_labels[slot] = new_labels[vertex.summed[slot]];
+        }
+
+        // sort as the tensor would be sorted
+        if ( vertex.kind == 0 && numerical_labels.size() == 4 ) {
+            for (size_t pair = 0; pair < 4; pair += 2) {
+                if ( numerical_labels[pair] > numerical_labels[pair + 1] ) {
+                    std::swap(numerical_labels[pair], numerical_labels[pair + 1]);
+                    n_permute++;
+                }
+            }
+        }else if ( vertex.kind == 1 ) {
+            numerical_labels.push_back('0' + vertex.n_ph);
+            for (size_t i = 0; i < numerical_labels.size(); i++) {
+                for (size_t j = i + 1; j < numerical_labels.size(); j++) {
+                    if ( numerical_labels[i] > numerical_labels[j] ) n_permute++;
+                }
+            }
+            std::sort(numerical_labels.begin(), numerical_labels.end());
+        }else if ( vertex.kind == 2 ) {
+            std::sort(numerical_labels.begin(), numerical_labels.end());
+        }
+        tensors[std::make_pair(vertex.kind, vertex.type)].push_back(numerical_labels);
+    }
+
+    std::vector<int> sequence;
+    for (auto & tensor_list : tensors) {
+        sequence.push_back(-2 - tensor_list.first.first);
+        sequence.push_back(tensor_list.first.second);
+        std::sort(tensor_list.second.begin(), tensor_list.second.end());
+        for (const std::vector<int> & numerical_labels : tensor_list.second) {
+            sequence.insert(sequence.end(), numerical_labels.begin(), numerical_labels.end());
+            sequence.push_back(-1);
+        }
+    }
+    return sequence;
+}
+
+// canonical key of a string with respect to relabelings of its summed labels
+std::vector<int> canonical_key(const pq_string &in,
+                               const std::vector<std::string> &occ_labels,
+                               const std::vector<std::string> &vir_labels,
+                               int &n_permute) {
+
+    // gather the vertices, with their labels still as interned ids
+    std::vector<contraction_vertex> vertices;
+    std::vector<std::vector<pq_label> > vertex_labels;
+    auto add_vertex = [&](int kind, int type, int n_ph, std::vector<pq_label> labels) {
+        vertices.emplace_back();
+        vertices.back().kind = kind;
+        vertices.back().type = type;
+        vertices.back().n_ph = n_ph;
+        vertex_labels.push_back(std::move(labels));
+    };
+    auto label_ids = [](const pq_label_list &labels) {
+        std::vector<pq_label> ids;
+        for (size_t i = 0; i < labels.size(); i++) {
+            ids.push_back(labels.id(i));
+        }
+        return ids;
+    };
+    for (int type = 0; type < (int)std::size(in.integral_types); type++) {
+        auto it = in.ints.find(in.integral_types[type]);
+        if ( it == in.ints.end() ) continue;
+        for (const integrals & integral : it->second) {
+            add_vertex(0, type, 0, label_ids(integral.labels));
+        }
+    }
+    for (int type = 0; type < (int)std::size(in.amplitude_types); type++) {
+        auto it = in.amps.find(in.amplitude_types[type]);
+        if ( it == in.amps.end() ) continue;
+        for (const amplitudes & amp : it->second) {
+            add_vertex(1, type, amp.n_ph, label_ids(amp.labels));
+            vertices.back().invariant = {amp.n_create, amp.n_annihilate};
+        }
+    }
+    for (const delta_functions & delta : in.deltas) {
+        add_vertex(2, 0, 0, label_ids(delta.labels));
+    }
+    if ( !in.symbol.empty() ) {
+        add_vertex(3, 0, 0, in.symbol);
+    }
+
+    // summed labels are occupied / virtual labels that appear twice
+    std::vector<pq_label> names;
+    std::vector<int> counts;
+    for (const auto & labels : vertex_labels) {
+        for (pq_label label : labels) {
+            size_t id = 0;
+            while ( id < names.size() && names[id] != label ) id++;
+            if ( id == names.size() ) {
+                names.push_back(label);
+                counts.push_back(0);
+            }
+            counts[id]++;
+        }
+    }
+    std::vector<int> summed_id(names.size(), -1);
+    std::vector<int> summed_class;
+    for (size_t id = 0; id < names.size(); id++) {
+        if ( counts[id] != 2 ) continue;
+        int label_class = -1;
+        if ( std::find(occ_labels.begin(), occ_labels.end(), label_name(names[id])) != occ_labels.end() ) label_class = 0;
+        else if ( std::find(vir_labels.begin(), vir_labels.end(), label_name(names[id])) != vir_labels.end() ) label_class = 1;
+        if ( label_class < 0 ) continue;
+        summed_id[id] = (int)summed_class.size();
+        summed_class.push_back(label_class);
+    }
+    size_t n_summed_labels = summed_class.size();
+
+    // finish the vertices
+    for (size_t v = 0; v < vertices.size(); v++) {
+        contraction_vertex & vertex = vertices[v];
+        int n_summed[2] = {0, 0};
+        std::vector<int> fixed;
+        for (pq_label label : vertex_labels[v]) {
+            size_t id = std::find(names.begin(), names.end(), label) - names.begin();
+            vertex.summed.push_back(summed_id[id]);
+            vertex.numerical_labels.push_back(numerical_label(label_name(label)));
+            if ( summed_id[id] >= 0 ) n_summed[summed_class[summed_id[id]]]++;
+            else fixed.push_back(vertex.numerical_labels.back());
+        }
+        std::sort(fixed.begin(), fixed.end());
+        for (int n : {vertex.kind, vertex.type, (int)vertex.summed.size(), vertex.n_ph, n_summed[0], n_summed[1], -1}) {
+            vertex.invariant.push_back(n);
+        }
+        vertex.invariant.insert(vertex.invariant.end(), fixed.begin(), fixed.end());
+    }
+
+    // the (vertex, group) ends of each summed label
+    std::vector<std::vector<std::pair<size_t, int> > > label_ends(n_summed_labels);
+    for (size_t v = 0; v < vertices.size(); v++) {
+        for (size_t slot = 0; slot < vertices[v].summed.size(); slot++) {
+            if ( vertices[v].summed[slot] < 0 ) continue;
+            label_ends[vertices[v].summed[slot]].emplace_back(v, vertices[v].group(slot));
+        }
+    }
+
+    // rank label-independent descriptions of the vertices
+    std::vector<int> color(vertices.size());
+    auto rank = [&](const std::vector<std::vector<int> > &descriptions) {
+        std::vector<std::vector<int> > distinct = descriptions;
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        for (size_t v = 0; v < vertices.size(); v++) {
+            color[v] = (int)(std::lower_bound(distinct.begin(), distinct.end(), descriptions[v]) - distinct.begin());
+        }
+        return distinct.size();
+    };
+    std::vector<std::vector<int> > invariants;
+    for (const contraction_vertex & vertex : vertices) {
+        invariants.push_back(vertex.invariant);
+    }
+    size_t n_colors = rank(invariants);
+
+    // refine the colors by the colors of neighboring vertices until the partition stops
+    // changing, so that fewer orderings need to be tried below
+    while ( n_colors < vertices.size() ) {
+        std::vector<std::vector<int> > refined(vertices.size());
+        for (size_t v = 0; v < vertices.size(); v++) {
+            std::vector<std::vector<int> > neighbors;
+            for (size_t slot = 0; slot < vertices[v].summed.size(); slot++) {
+                int label = vertices[v].summed[slot];
+                if ( label < 0 ) continue;
+                std::vector<int> neighbor = {summed_class[label], vertices[v].group(slot)};
+                std::vector<std::pair<int, int> > ends;
+                for (const auto & end : label_ends[label]) {
+                    ends.emplace_back(color[end.first], end.second);
+                }
+                std::sort(ends.begin(), ends.end());
+                for (const auto & end : ends) {
+                    neighbor.push_back(end.first);
+                    neighbor.push_back(end.second);
+                }
+                neighbors.push_back(neighbor);
+            }
+            std::sort(neighbors.begin(), neighbors.end());
+            refined[v].push_back(color[v]);
+            for (const auto & neighbor : neighbors) {
+                refined[v].push_back(-1);
+                refined[v].insert(refined[v].end(), neighbor.begin(), neighbor.end());
+            }
+        }
+        size_t n_refined = rank(refined);
+        if ( n_refined == n_colors ) break;
+        n_colors = n_refined;
+    }
+
+    // vertices are ordered by their colors. blocks of vertices with the same color can
+    // appear in any order, so each ordering of each block is tried
+    std::vector<size_t> order(vertices.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return color[a] < color[b];
+    });
+    std::vector<std::pair<size_t, size_t> > blocks;
+    for (size_t begin = 0; begin < order.size(); ) {
+        size_t end = begin + 1;
+        while ( end < order.size() && color[order[end]] == color[order[begin]] ) end++;
+        if ( n_summed_labels > 0 && end - begin > 1 ) blocks.emplace_back(begin, end);
+        begin = end;
+    }
+
+    std::vector<int> best;
+    std::vector<int> position(vertices.size());
+    std::vector<size_t> edges(n_summed_labels);
+    std::vector<std::vector<std::pair<size_t, int> > > ends(n_summed_labels);
+    std::vector<int> new_labels(n_summed_labels);
+
+    bool done = false;
+    while ( !done ) {
+
+        // each summed label is an edge described by the (position, group) of its two ends
+        for (size_t p = 0; p < order.size(); p++) {
+            position[order[p]] = (int)p;
+        }
+        for (size_t label = 0; label < n_summed_labels; label++) {
+            ends[label].clear();
+            for (const auto & end : label_ends[label]) {
+                ends[label].emplace_back(position[end.first], end.second);
+            }
+            std::sort(ends[label].begin(), ends[label].end());
+        }
+
+        // name the edges in order of their class and ends. edges with the same ends can be
+        // exchanged without changing the sorted string or its sign. the new names cannot
+        // collide with those of the non-summed labels, which are printable
+        std::iota(edges.begin(), edges.end(), 0);
+        std::sort(edges.begin(), edges.end(), [&](size_t a, size_t b) {
+            if ( summed_class[a] != summed_class[b] ) return summed_class[a] < summed_class[b];
+            return ends[a] < ends[b];
+        });
+        int n_named[2] = {0, 0};
+        for (size_t edge : edges) {
+            int label_class = summed_class[edge];
+            new_labels[edge] = (1 + label_class) + 128 * (1 + n_named[label_class]++);
+        }
+
+        int n_permute_candidate = 0;
+        std::vector<int> sequence = relabeled_sequence(vertices, new_labels, n_permute_candidate);
+        if ( best.empty() || sequence < best ) {
+            best = sequence;
+            n_permute = n_permute_candidate;
+        }
+
+        // next ordering of the blocks
+        done = true;
+        for (const auto & block : blocks) {
+            if ( std::next_permutation(order.begin() + block.first, order.begin() + block.second) ) {
+                done = false;
+                break;
+            }
+        }
+    }
+
+    // everything else that must match for strings to be combined (see pq_string::same_key)
+    best.push_back(-10);
+    best.push_back(in.has_w0);
+    for (bool dagger : in.is_boson_dagger) best.push_back(dagger);
+    best.push_back(-11);
+    for (bool dagger : in.is_dagger) best.push_back(dagger);
+    for (const auto * permutations : {&in.permutations, &in.paired_permutations_2, &in.paired_permutations_3, &in.paired_permutations_6}) {
+        best.push_back(-12);
+        for (const std::string & label : *permutations) {
+            best.push_back(numerical_label(label));
+        }
+    }
+
+    return best;
+}
+
+// the canonical key of a string, reusing the one from an earlier call if the string has not changed since
+static const std::vector<int> & cached_canonical_key(pq_string &in,
+                                                     const std::vector<std::string> &occ_labels,
+                                                     const std::vector<std::string> &vir_labels) {
+
+    if ( in.canonical.empty() || in.canonical_for_key != in.key || !in.canonical_source || !in.same_key(*in.canonical_source) ) {
+        in.canonical.clear();
+        in.canonical_source.reset();
+        in.canonical_source = std::make_shared<const pq_string>(in);
+        in.canonical = canonical_key(in, occ_labels, vir_labels, in.canonical_n_permute);
+        in.canonical_for_key = in.key;
+    }
+    return in.canonical;
+}
+
+// combine the string j with an equivalent string i (n_permute permutations apart), which is skipped.
+// returns false if the two cancel, in which case j is skipped as well
+static bool combine_equivalent_strings(pq_string &j, pq_string &i, int n_permute) {
+
+    double factor_i = i.factor * i.sign;
+    double factor_j = j.factor * j.sign;
+
+    double combined_factor = factor_j + factor_i * pow(-1.0, n_permute);
+
+    i.skip = true;
+    if ( fabs(combined_factor) < 1e-12 ) {
+        j.skip = true;
+        return false;
+    }
+
+    j.factor = fabs(combined_factor);
+    if ( combined_factor > 0.0 ) {
+        j.sign =  1;
+    }else {
+        j.sign = -1;
+    }
+    return true;
+}
+
+// consolidate terms that are equal up to a relabeling of summed labels
+void consolidate_permutations_canonical(std::vector<std::shared_ptr<pq_string> > &ordered,
+                                        const std::vector<std::string> &occ_labels,
+                                        const std::vector<std::string> &vir_labels) {
+
+    if ( ordered.empty() ) return;
+
+    std::vector< std::vector<size_t> > shards = shard_by_signature(ordered);
+    size_t n_shards = shards.size();
+
+    #pragma omp parallel for schedule(dynamic) default(none) shared(ordered, occ_labels, vir_labels, shards, n_shards)
+    for (size_t shard = 0; shard < n_shards; shard++) {
+
+        // a string whose signature is unique can not be combined with any other
+        std::unordered_map<uint64_t, size_t> n_signature;
+        std::vector<uint64_t> signatures;
+        for (size_t i : shards[shard]) {
+            signatures.push_back(ordered[i]->get_signature());
+            n_signature[signatures.back()]++;
+        }
+
+        // map canonical keys onto the strings that carry them
+        std::map<std::vector<int>, std::pair<size_t, int> > string_map;
+
+        for (size_t n = 0; n < shards[shard].size(); n++) {
+
+            if ( n_signature[signatures[n]] < 2 ) continue;
+
+            size_t i = shards[shard][n];
+
+            pq_string & in = *ordered[i];
+            std::vector<int> key = cached_canonical_key(in, occ_labels, vir_labels);
+            int n_permute_i = in.canonical_n_permute;
+
+            // is there an equivalent string already?
+            auto it = string_map.find(key);
+            if ( it == string_map.end() ) {
+
+                // new term in map
+                string_map.emplace(std::move(key), std::make_pair(i, n_permute_i));
+                continue;
+            }
+
+            // update factor for existing term in map
+
+            size_t j = it->second.first;
+            int n_permute = n_permute_i + it->second.second;
+
+            if ( !combine_equivalent_strings(*ordered[j], *ordered[i], n_permute) ) {
+                string_map.erase(it);
+            }
+        }
+    }
+}
+
 // consolidate terms that differ by permutations of non-summed labels
 void consolidate_permutations_non_summed(
     std::vector<std::shared_ptr<pq_string> > &ordered,
@@ -1125,17 +1650,12 @@ void alphabetize(std::vector<std::shared_ptr<pq_string> > &ordered) {
         bool not_alphabetized = false;
         do {
             not_alphabetized = false;
-            int ndagger = 0;
-            for (size_t j = 0; j < pq_str->symbol.size(); j++) {
-                if ( pq_str->is_dagger[j] ) ndagger++;
-            }
+            int ndagger = (int)pq_str->is_dagger.count();
             for (int j = 0; j < ndagger-1; j++) {
-                int val1 = pq_str->symbol[j].c_str()[0];
-                int val2 = pq_str->symbol[j + 1].c_str()[0];
+                int val1 = label_name(pq_str->symbol[j]).c_str()[0];
+                int val2 = label_name(pq_str->symbol[j + 1]).c_str()[0];
                 if ( val2 < val1 ) {
-                    std::string dum = pq_str->symbol[j];
-                    pq_str->symbol[j] = pq_str->symbol[j + 1];
-                    pq_str->symbol[j + 1] = dum;
+                    std::swap(pq_str->symbol[j], pq_str->symbol[j + 1]);
                     pq_str->sign = -pq_str->sign;
                     not_alphabetized = true;
                     j = pq_str->symbol.size() + 1;
@@ -1147,17 +1667,12 @@ void alphabetize(std::vector<std::shared_ptr<pq_string> > &ordered) {
         not_alphabetized = false;
         do {
             not_alphabetized = false;
-            int ndagger = 0;
-            for (size_t j = 0; j < pq_str->symbol.size(); j++) {
-                if ( pq_str->is_dagger[j] ) ndagger++;
-            }
+            int ndagger = (int)pq_str->is_dagger.count();
             for (int j = ndagger; j < (int)pq_str->symbol.size() - 1; j++) {
-                int val1 = pq_str->symbol[j].c_str()[0];
-                int val2 = pq_str->symbol[j + 1].c_str()[0];
+                int val1 = label_name(pq_str->symbol[j]).c_str()[0];
+                int val2 = label_name(pq_str->symbol[j + 1]).c_str()[0];
                 if ( val2 < val1 ) {
-                    std::string dum = pq_str->symbol[j];
-                    pq_str->symbol[j] = pq_str->symbol[j + 1];
-                    pq_str->symbol[j + 1] = dum;
+                    std::swap(pq_str->symbol[j], pq_str->symbol[j + 1]);
                     pq_str->sign = -pq_str->sign;
                     not_alphabetized = true;
                     j = pq_str->symbol.size() + 1;
@@ -1173,14 +1688,18 @@ void alphabetize(std::vector<std::shared_ptr<pq_string> > &ordered) {
             int val1 = delta.labels[0].c_str()[0];
             int val2 = delta.labels[1].c_str()[0];
             if ( val2 < val1 ) {
-                std::string dum = delta.labels[0];
-                delta.labels[0] = delta.labels[1];
-                delta.labels[1] = dum;
+                pq_label dum = delta.labels.id(0);
+                delta.labels.set(0, delta.labels.id(1));
+                delta.labels.set(1, dum);
             }
         }
     }
 }
 
+// the labels that cleanup() treats as summed when they appear twice in a string
+static const std::vector<std::string> cleanup_occ_labels { "i", "j", "k", "l", "m", "n", "I", "J", "K", "L", "M", "N" };
+static const std::vector<std::string> cleanup_vir_labels { "a", "b", "c", "d", "e", "f", "A", "B", "C", "D", "E", "F" };
+
 // compare strings and remove terms that cancel
 void cleanup(std::vector<std::shared_ptr<pq_string> > &ordered, bool find_paired_permutations) {
 
@@ -1211,21 +1730,17 @@ void cleanup(std::vector<std::shared_ptr<pq_string> > &ordered, bool find_paired
     }
     pruned.clear();
 
-    std::vector<std::string> occ_labels { "i", "j", "k", "l", "m", "n", "I", "J", "K", "L", "M", "N" };
-    std::vector<std::string> vir_labels { "a", "b", "c", "d", "e", "f", "A", "B", "C", "D", "E", "F" };
+    const std::vector<std::string> &occ_labels = cleanup_occ_labels;
+    const std::vector<std::string> &vir_labels = cleanup_vir_labels;
 
-    // swap up to two non-summed labels (more doesn't seem to be necessary for up to ccsdtq)
+    // combine terms that are equal up to any relabeling of summed labels
 
     // TODO: the operator portions are not considered in the comparisons below. not sure this matters for future use cases
 
+    // identical strings first, which is cheap and leaves fewer strings to canonicalize
     consolidate_permutations_plus_swaps(ordered, {});
 
-    consolidate_permutations_plus_swaps(ordered, {occ_labels});
-    consolidate_permutations_plus_swaps(ordered, {vir_labels});
-
-    consolidate_permutations_plus_swaps(ordered, {occ_labels, occ_labels});
-    consolidate_permutations_plus_swaps(ordered, {vir_labels, vir_labels});
-    consolidate_permutations_plus_swaps(ordered, {occ_labels, vir_labels});
+    consolidate_permutations_canonical(ordered, occ_labels, vir_labels);
 
     if ( ordered.empty() ) return;
 
@@ -1269,6 +1784,83 @@ void cleanup(std::vector<std::shared_ptr<pq_string> > &ordered, bool find_paired
     pruned.clear();
 }
 
+void pq_string_index::build(const std::vector<std::shared_ptr<pq_string> > &ordered) {
+    size_t n_shards = 1;
+#ifdef _OPENMP
+    n_shards = 4 * (size_t)omp_get_max_threads();
+#endif
+    shards.assign(n_shards, {});
+    for (const std::shared_ptr<pq_string> & pq_str : ordered) {
+        uint64_t signature = pq_str->get_signature();
+        shards[signature % n_shards][signature].push_back(pq_str);
+    }
+}
+
+// compare strings added since the last call with each other and with those kept by earlier calls
+// (ordered), and remove terms that cancel
+void cleanup(std::vector<std::shared_ptr<pq_string> > &ordered,
+             std::vector<std::shared_ptr<pq_string> > &added,
+             pq_string_index &index,
+             bool find_paired_permutations) {
+
+    // the index is rebuilt if ordered did not come from an earlier call
+    if ( index.empty() ) {
+        index.build(ordered);
+    }
+
+    // the new strings are consolidated with each other first
+    cleanup(added, find_paired_permutations);
+
+    // then with the kept strings of the same signature. the kept strings are never sorted or
+    // canonicalized again, and a string of unique signature is only canonicalized once another
+    // string with that signature appears
+    size_t n_shards = index.shards.size();
+    std::vector<uint64_t> signatures(added.size());
+    std::vector< std::vector<size_t> > shards(n_shards);
+    for (size_t i = 0; i < added.size(); i++) {
+        signatures[i] = added[i]->get_signature();
+        shards[signatures[i] % n_shards].push_back(i);
+    }
+
+    #pragma omp parallel for schedule(dynamic) default(none) shared(added, index, shards, signatures, n_shards, cleanup_occ_labels, cleanup_vir_labels)
+    for (size_t shard = 0; shard < n_shards; shard++) {
+        for (size_t i : shards[shard]) {
+
+            std::vector<std::shared_ptr<pq_string> > &bucket = index.shards[shard][signatures[i]];
+            if ( bucket.empty() ) {
+                bucket.push_back(added[i]);
+                continue;
+            }
+
+            pq_string & in = *added[i];
+            const std::vector<int> &key = cached_canonical_key(in, cleanup_occ_labels, cleanup_vir_labels);
+
+            bool found = false;
+            for (size_t j = 0; j < bucket.size(); j++) {
+                pq_string & kept = *bucket[j];
+                if ( cached_canonical_key(kept, cleanup_occ_labels, cleanup_vir_labels) != key ) continue;
+
+                found = true;
+                if ( !combine_equivalent_strings(kept, in, in.canonical_n_permute + kept.canonical_n_permute) ) {
+                    bucket.erase(bucket.begin() + (std::ptrdiff_t)j);
+                }
+                break;
+            }
+            if ( !found ) bucket.push_back(added[i]);
+        }
+    }
+
+    std::vector< std::shared_ptr<pq_string> > merged;
+    merged.reserve(ordered.size() + added.size());
+    for (const std::vector< std::shared_ptr<pq_string> > * list : {&ordered, &added}) {
+        for (const std::shared_ptr<pq_string> & pq_str : *list) {
+            if ( !pq_str->skip ) merged.push_back(pq_str);
+        }
+    }
+    ordered = std::move(merged);
+    added.clear();
+}
+
 // re-classify fluctuation potential terms
 void reclassify_integrals(std::shared_ptr<pq_string> &in) {
 
@@ -1403,25 +1995,28 @@ void use_conventional_labels(std::shared_ptr<pq_string> &in) {
 /// apply delta functions to amplitude and integral labels
 void gobble_deltas(std::shared_ptr<pq_string> &in) {
     
-    std::vector<std::string> tmp_delta1;
-    std::vector<std::string> tmp_delta2;
+    std::vector<pq_label> tmp_delta1;
+    std::vector<pq_label> tmp_delta2;
     
     for ( delta_functions & delta : in->deltas ) {
+
+        pq_label label1 = delta.labels.id(0);
+        pq_label label2 = delta.labels.id(1);
     
         // is delta label 1 in list of summation labels?
         bool have_delta1 = false;    
-        if ( in->index_in_anywhere(delta.labels[0]) == 2 ){
+        if ( in->index_in_anywhere(label1) == 2 ){
             have_delta1 = true;
         }
         bool have_delta2 = false;
-        if ( in->index_in_anywhere(delta.labels[1]) == 2 ){
+        if ( in->index_in_anywhere(label2) == 2 ){
             have_delta2 = true;
         }
 
         // if the deltas don't contain any summation labels, we should keep them
         if (!have_delta1 && !have_delta2) {
-            tmp_delta1.push_back(delta.labels[0]);
-            tmp_delta2.push_back(delta.labels[1]);
+            tmp_delta1.push_back(label1);
+            tmp_delta2.push_back(label2);
             continue;
         }
     
@@ -1444,12 +2039,12 @@ void gobble_deltas(std::shared_ptr<pq_string> &in) {
             std::string type = int_pair.first;
             std::vector<integrals> & ints = int_pair.second;
             
-            if ( have_delta1 && index_in_integrals( delta.labels[0], ints ) > 0 ) {
-               replace_index_in_integrals( delta.labels[0], delta.labels[1], ints );
+            if ( have_delta1 && index_in_integrals( label1, ints ) > 0 ) {
+               replace_index_in_integrals( label1, label2, ints );
                do_continue = true;
                break;
-            }else if ( have_delta2 && index_in_integrals( delta.labels[1], ints ) > 0 ) {
-               replace_index_in_integrals( delta.labels[1], delta.labels[0], ints );
+            }else if ( have_delta2 && index_in_integrals( label2, ints ) > 0 ) {
+               replace_index_in_integrals( label2, label1, ints );
                do_continue = true;
                break;
             }
@@ -1486,12 +2081,12 @@ void gobble_deltas(std::shared_ptr<pq_string> &in) {
         for (auto & type : types) {
             std::vector<amplitudes> & amps = in->amps[type];
             
-            if ( have_delta1 && index_in_amplitudes( delta.labels[0], amps ) > 0 ) {
-               replace_index_in_amplitudes( delta.labels[0], delta.labels[1], amps );
+            if ( have_delta1 && index_in_amplitudes( label1, amps ) > 0 ) {
+               replace_index_in_amplitudes( label1, label2, amps );
                do_continue = true;
                break;
-            }else if ( have_delta2 && index_in_amplitudes( delta.labels[1], in->amps[type] ) > 0 ) {
-               replace_index_in_amplitudes( delta.labels[1], delta.labels[0], amps );
+            }else if ( have_delta2 && index_in_amplitudes( label2, in->amps[type] ) > 0 ) {
+               replace_index_in_amplitudes( label2, label1, amps );
                do_continue = true;
                break;
             }
@@ -1499,8 +2094,8 @@ void gobble_deltas(std::shared_ptr<pq_string> &in) {
         if ( do_continue ) continue;
 
         // at this point, it is safe to assume the delta function must remain
-        tmp_delta1.push_back(delta.labels[0]);
-        tmp_delta2.push_back(delta.labels[1]);
+        tmp_delta1.push_back(label1);
+        tmp_delta2.push_back(label2);
     }
 
     in->deltas.clear();
@@ -1531,7 +2126,7 @@ void add_new_string_true_vacuum(const std::shared_ptr<pq_string> &in, std::vecto
         }else {
             in->is_dagger.push_back(false);
         }
-        in->symbol.push_back(me);
+        in->symbol.push_back(intern_label(me));
     }
 
     if ( print_level > 0 ) {
@@ -1559,8 +2154,10 @@ void add_new_string_true_vacuum(const std::shared_ptr<pq_string> &in, std::vecto
         }
     }while(!done_rearranging);
 
+    // strings created while rearranging live in a per-thread pool. promote
+    // the survivors to ordinary storage
     for (const std::shared_ptr<pq_string> & pq_str : tmp) {
-        ordered.push_back(pq_str);
+        ordered.push_back(pq_str == in ? pq_str : promote_string(pq_str));
     }
     tmp.clear();
 
@@ -1612,34 +2209,85 @@ bool expand_general_labels(const std::shared_ptr<pq_string> & in, std::vector<st
     return true;
 }
 
+// could the operators in a string, some of which may still carry general labels, be fully
+// contracted for some choice of occupied / virtual labels? this is the test in
+// pq_string::is_fully_contractible, applied to every set of running counts reachable when each
+// general label may be either occupied or virtual
+static bool may_be_fully_contractible(const std::vector<std::string> &ops) {
+
+    // reachable (n_occ, n_vir) running counts of unpaired quasi-annihilators
+    size_t dim = ops.size() + 1;
+    std::vector<char> reachable(dim * dim, 0), next(dim * dim, 0);
+    reachable[0] = 1;
+
+    for (const std::string & op : ops) {
+
+        std::string label = op;
+        bool is_dagger = label.find('*') != std::string::npos;
+        if ( is_dagger ) removeStar(label);
+
+        bool can_be_occ = !is_vir(label);
+        bool can_be_vir = !is_occ(label);
+
+        std::fill(next.begin(), next.end(), 0);
+        bool any = false;
+        for (size_t n_occ = 0; n_occ < dim; n_occ++) {
+            for (size_t n_vir = 0; n_vir < dim; n_vir++) {
+                if ( !reachable[n_occ * dim + n_vir] ) continue;
+
+                // occupied: a* is a quasi-annihilator, a is a quasi-creator
+                if ( can_be_occ ) {
+                    if ( is_dagger && n_occ + 1 < dim ) {
+                        next[(n_occ + 1) * dim + n_vir] = any = 1;
+                    }else if ( !is_dagger && n_occ > 0 ) {
+                        next[(n_occ - 1) * dim + n_vir] = any = 1;
+                    }
+                }
+
+                // virtual: a is a quasi-annihilator, a* is a quasi-creator
+                if ( can_be_vir ) {
+                    if ( !is_dagger && n_vir + 1 < dim ) {
+                        next[n_occ * dim + n_vir + 1] = any = 1;
+                    }else if ( is_dagger && n_vir > 0 ) {
+                        next[n_occ * dim + n_vir - 1] = any = 1;
+                    }
+                }
+            }
+        }
+        if ( !any ) return false;
+        std::swap(reachable, next);
+    }
+    return reachable[0] != 0;
+}
+
+// expand the general labels in a string one at a time, depth first, so that a branch is dropped as
+// soon as no choice for its remaining general labels can be fully contracted. the surviving strings
+// and their labels are the same, and in the same order, as those from expanding every label
+static void expand_general_labels_and_prune(const std::shared_ptr<pq_string> &in, std::vector<std::shared_ptr<pq_string> > &mystrings, int occ_label_count, int vir_label_count) {
+
+    if ( !may_be_fully_contractible(in->string) ) return;
+
+    std::vector< std::shared_ptr<pq_string> > list;
+    if ( expand_general_labels(in, list, occ_label_count, vir_label_count) ) {
+        mystrings.push_back(in);
+        return;
+    }
+    for (const std::shared_ptr<pq_string> & pq_str : list) {
+        expand_general_labels_and_prune(pq_str, mystrings, occ_label_count + 1, vir_label_count + 1);
+    }
+}
+
 // bring a new string to normal order and add to list of normal ordered strings (fermi vacuum)
-void add_new_string_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vector<std::shared_ptr<pq_string> > &ordered, int print_level, bool find_paired_permutations, int occ_label_count, int vir_label_count){
+void add_new_string_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vector<std::shared_ptr<pq_string> > &ordered, int print_level, bool find_paired_permutations, int occ_label_count, int vir_label_count, bool use_wick_engine, const std::vector<int> *vertex_of){
         
     // if normal order is defined with respect to the fermi vacuum, we must
     // check here if the input string contains any general-index operators
     // (h, g, f, and v). If it does, then the string must be split to account 
-    // explicitly for sums over occupied and virtual labels
+    // explicitly for sums over occupied and virtual labels. strings that cannot be fully
+    // contracted are dropped while the labels are expanded
 
     std::vector< std::shared_ptr<pq_string> > mystrings;
-    mystrings.push_back(in);
-
-    bool done_expanding = false;
-    do {
-        std::vector< std::shared_ptr<pq_string> > list;
-        done_expanding = true;
-        for (const std::shared_ptr<pq_string> & pq_str : mystrings) {
-            bool am_i_done = expand_general_labels(pq_str, list, occ_label_count, vir_label_count);
-            if ( !am_i_done ) done_expanding = false;
-        }
-        if (!done_expanding) {
-            mystrings.clear();
-            for (std::shared_ptr<pq_string> & pq_str : list) {
-                mystrings.push_back(pq_str);
-            }
-            occ_label_count++;
-            vir_label_count++;
-        }
-    }while(!done_expanding);
+    expand_general_labels_and_prune(in, mystrings, occ_label_count, vir_label_count);
 
     // now, we need to convert the list "mystrings[i]->string" into symbols and daggers
     for (auto & mystring: mystrings ) {
@@ -1651,7 +2299,9 @@ void add_new_string_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
                 removeStar(me_nostar);
             }
 
-            if ( is_vir(me_nostar) ) {
+            pq_label label = intern_label(me_nostar);
+
+            if ( label_class(label) == vir_label ) {
                 if (me.find('*') != std::string::npos ){
                     mystring->is_dagger.push_back(true);
                     mystring->is_dagger_fermi.push_back(true);
@@ -1659,8 +2309,8 @@ void add_new_string_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
                     mystring->is_dagger.push_back(false);
                     mystring->is_dagger_fermi.push_back(false);
                 }
-                mystring->symbol.push_back(me_nostar);
-            }else if ( is_occ(me_nostar) ) {
+                mystring->symbol.push_back(label);
+            }else if ( label_class(label) == occ_label ) {
                 if (me.find('*') != std::string::npos ){
                     mystring->is_dagger.push_back(true);
                     mystring->is_dagger_fermi.push_back(false);
@@ -1668,7 +2318,7 @@ void add_new_string_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
                     mystring->is_dagger.push_back(false);
                     mystring->is_dagger_fermi.push_back(true);
                 }
-                mystring->symbol.push_back(me_nostar);
+                mystring->symbol.push_back(label);
             }
         }
     }
@@ -1677,29 +2327,12 @@ void add_new_string_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
     // and are ready to bring the strings to normal order
 
     std::vector< std::shared_ptr<pq_string> > new_strings[mystrings.size()];
-    #pragma omp parallel for schedule(dynamic) default(none) shared(mystrings, new_strings) firstprivate(print_level)
+    #pragma omp parallel for schedule(dynamic) default(none) shared(mystrings, new_strings) firstprivate(print_level, use_wick_engine, vertex_of)
     for (size_t k = 0; k < mystrings.size(); k++) {
         const std::shared_ptr<pq_string>& mystring = mystrings[k];
 
-        // check if this string can be fully contracted ...
-        int nc = 0;
-        int na = 0;
-        for (size_t i = 0; i < mystring->symbol.size(); i++) {
-            if ( mystring->is_dagger_fermi[i] ) nc++;
-            else na++;
-        }
-        if ( nc != na ) {
-            continue;
-        }
-
-        // bosons, too
-        nc = 0;
-        na = 0;
-        for (auto && bdag : mystring->is_boson_dagger) {
-            if ( bdag ) nc++;
-            else na++;
-        }
-        if ( nc != na ) {
+        // check if this string can be fully contracted (fermions and bosons)
+        if ( !mystring->is_fully_contractible() ) {
             continue;
         }
 
@@ -1712,6 +2345,11 @@ void add_new_string_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
             mystring->print();
         }
 
+        if ( use_wick_engine || vertex_of ) {
+            contract_operators_fermi_vacuum(mystring, new_strings[k], vertex_of);
+            continue;
+        }
+
         std::vector< std::shared_ptr<pq_string> > tmp;
         tmp.push_back(mystring);
 
@@ -1725,13 +2363,20 @@ void add_new_string_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vect
             }
             tmp.clear();
             for (std::shared_ptr<pq_string> & pq_str : list) {
-                if ( !pq_str->skip ) {
+                // drop strings that can no longer be fully contracted. these
+                // would otherwise be swapped to normal order and then discarded
+                // by cleanup()
+                if ( !pq_str->skip && pq_str->is_fully_contractible() ) {
                     tmp.push_back(pq_str);
                 }
             }
         }while(!done_rearranging);
 
-        new_strings[k] = tmp;
+        // strings created while rearranging live in this thread's pool. promote
+        // the survivors to ordinary storage before the pool can be reused
+        for (const std::shared_ptr<pq_string> & pq_str : tmp) {
+            new_strings[k].push_back(pq_str == mystring ? pq_str : promote_string(pq_str));
+        }
         tmp.clear();
     }
 
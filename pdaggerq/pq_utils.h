@@ -32,6 +32,7 @@
 #include<cstring>
 #include<cmath>
 #include<sstream>
+#include<unordered_map>
 
 #include "pq_tensor.h"
 #include "pq_string.h"
@@ -47,26 +48,50 @@ bool is_vir(const std::string &idx);
 /// how many times does an index appear in deltas?
 int index_in_deltas(const std::string &idx, const std::vector<delta_functions> &deltas);
 
+/// how many times does an (interned) index appear in deltas?
+int index_in_deltas(pq_label id, const std::vector<delta_functions> &deltas);
+
 /// how many times does an index appear in integrals?
 int index_in_integrals(const std::string &idx, const std::vector<integrals> &ints);
 
+/// how many times does an (interned) index appear in integrals?
+int index_in_integrals(pq_label id, const std::vector<integrals> &ints);
+
 /// how many times does an index appear in amplitudes?
 int index_in_amplitudes(const std::string &idx, const std::vector<amplitudes> &amps);
 
+/// how many times does an (interned) index appear in amplitudes?
+int index_in_amplitudes(pq_label id, const std::vector<amplitudes> &amps);
+
 /// how many times does an index appear in operators (symbol)?
-int index_in_operators(const std::string &idx, const std::vector<std::string> &ops);
+int index_in_operators(const std::string &idx, const std::vector<pq_label> &ops);
+
+/// how many times does an (interned) index appear in operators (symbol)?
+int index_in_operators(pq_label id, const std::vector<pq_label> &ops);
 
 /// replace one label with another (in delta functions)
 void replace_index_in_deltas(const std::string &old_idx, const std::string &new_idx, std::vector<delta_functions> &deltas);
 
+/// replace one (interned) label with another (in delta functions)
+void replace_index_in_deltas(pq_label old_id, pq_label new_id, std::vector<delta_functions> &deltas);
+
 /// replace one label with another (in a given set of integrals)
 void replace_index_in_integrals(const std::string &old_idx, const std::string &new_idx, std::vector<integrals> &ints);
 
+/// replace one (interned) label with another (in a given set of integrals)
+void replace_index_in_integrals(pq_label old_id, pq_label new_id, std::vector<integrals> &ints);
+
 /// replace one label with another (in a given set of amplitudes)
 void replace_index_in_amplitudes(const std::string &old_idx, const std::string &new_idx, std::vector<amplitudes> &amps);
 
+/// replace one (interned) label with another (in a given set of amplitudes)
+void replace_index_in_amplitudes(pq_label old_id, pq_label new_id, std::vector<amplitudes> &amps);
+
 /// replace one label with another (in a given set of operators (symbol))
-void replace_index_in_operators(const std::string &old_idx, const std::string &new_idx, std::vector<std::string> &ops);
+void replace_index_in_operators(const std::string &old_idx, const std::string &new_idx, std::vector<pq_label> &ops);
+
+/// replace one (interned) label with another (in a given set of operators (symbol))
+void replace_index_in_operators(pq_label old_id, pq_label new_id, std::vector<pq_label> &ops);
 
 /// replace one label with another (in integrals and amplitudes)
 void replace_index_everywhere(std::shared_ptr<pq_string> &in, const std::string &old_idx, const std::string &new_idx);
@@ -81,6 +106,22 @@ bool compare_strings(const std::shared_ptr<pq_string> &ordered_1, const std::sha
 void consolidate_permutations_plus_swaps(std::vector<std::shared_ptr<pq_string> > &ordered,
                                           const std::vector<std::vector<std::string> > &labels);
 
+// canonical key of a string with respect to relabelings of its summed labels (labels from
+// occ_labels / vir_labels that appear twice). the tensors are treated as the vertices of a graph
+// whose edges are the summed labels, and the edges are renamed in a vertex-order-independent way.
+// two strings have the same key if and only if they are equal up to such a relabeling. n_permute
+// is the number of integral / amplitude label permutations in the canonical form (its parity
+// gives the sign relative to the string as written)
+std::vector<int> canonical_key(const pq_string &in,
+                               const std::vector<std::string> &occ_labels,
+                               const std::vector<std::string> &vir_labels,
+                               int &n_permute);
+
+// consolidate terms that are equal up to a relabeling of summed labels, using canonical forms
+void consolidate_permutations_canonical(std::vector<std::shared_ptr<pq_string> > &ordered,
+                                        const std::vector<std::string> &occ_labels,
+                                        const std::vector<std::string> &vir_labels);
+
 // consolidate terms that differ by permutations of non-summed labels
 void consolidate_permutations_non_summed(
     std::vector<std::shared_ptr<pq_string> > &ordered,
@@ -124,6 +165,25 @@ void alphabetize(std::vector<std::shared_ptr<pq_string> > &ordered);
 /// cancel terms where appropriate
 void cleanup(std::vector<std::shared_ptr<pq_string> > &ordered, bool find_paired_permutations);
 
+/// the strings kept by cleanup(ordered, added, ...), grouped by shard and then by signature (see
+/// pq_string::get_signature) so that strings added later are only compared with these
+struct pq_string_index {
+    std::vector< std::unordered_map<uint64_t, std::vector<std::shared_ptr<pq_string> > > > shards;
+
+    bool empty() const { return shards.empty(); }
+    void clear() { shards.clear(); }
+
+    /// index the strings in ordered, replacing any that were indexed before
+    void build(const std::vector<std::shared_ptr<pq_string> > &ordered);
+};
+
+/// cancel terms where appropriate among the strings added since the last call and those kept in
+/// ordered, which are indexed in index. the surviving strings are left in ordered
+void cleanup(std::vector<std::shared_ptr<pq_string> > &ordered,
+             std::vector<std::shared_ptr<pq_string> > &added,
+             pq_string_index &index,
+             bool find_paired_permutations);
+
 /// re-classify fluctuation potential terms
 void reclassify_integrals(std::shared_ptr<pq_string> &in);
 
@@ -136,8 +196,11 @@ void use_conventional_labels(std::shared_ptr<pq_string> &in);
 // bring a new string to normal order and add to list of normal ordered strings (fermi vacuum)
 void add_new_string_true_vacuum(const std::shared_ptr<pq_string> &in, std::vector<std::shared_ptr<pq_string> > &ordered, int print_level, bool find_paired_permutations);
 
-// bring a new string to normal order and add to list of normal ordered strings (fermi vacuum)
-void add_new_string_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vector<std::shared_ptr<pq_string> > &ordered, int print_level, bool find_paired_permutations, int occ_label_count, int vir_label_count);
+// bring a new string to normal order and add to list of normal ordered strings (fermi vacuum).
+// if use_wick_engine is true, fully-contracted terms are enumerated directly rather than by swapping operators.
+// if vertex_of is not null, the wick engine is always used, and only terms in which every cluster operator is
+// contracted with the transformed operator are generated (see contract_operators_fermi_vacuum)
+void add_new_string_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vector<std::shared_ptr<pq_string> > &ordered, int print_level, bool find_paired_permutations, int occ_label_count, int vir_label_count, bool use_wick_engine = false, const std::vector<int> *vertex_of = nullptr);
 
 /// concatinate a list of operators (a list of strings) into a single list
 std::vector<std::string> concatinate_operators(const std::vector<std::vector<std::string>> &ops);
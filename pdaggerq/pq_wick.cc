@@ -0,0 +1,167 @@
+//
+// pdaggerq - A code for bringing strings of creation / annihilation operators to normal order.
+// Filename: pq_wick.cc
+// Copyright (C) 2020 A. Eugene DePrince III
+//
+// Author: A. Eugene DePrince III <adeprince@fsu.edu>
+// Maintainer: DePrince group
+//
+// This file is part of the pdaggerq package.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include<algorithm>
+
+#include "pq_wick.h"
+#include "pq_tensor.h"
+#include "pq_string.h"
+
+namespace pdaggerq {
+
+// the number of full contractions of a string of boson operators
+static size_t count_boson_contractions(const pq_bitmask &is_boson_dagger) {
+
+    // each annihilator must be contracted with one of the unpaired creators to its right
+    size_t n_pairings = 1;
+    size_t n_open_creators = 0;
+    for (int i = (int)is_boson_dagger.size() - 1; i >= 0; i--) {
+        if ( is_boson_dagger[i] ) {
+            n_open_creators++;
+        }else {
+            if ( n_open_creators == 0 ) return 0;
+            n_pairings *= n_open_creators;
+            n_open_creators--;
+        }
+    }
+    return n_open_creators == 0 ? n_pairings : 0;
+}
+
+// which operator each fermion operator comes from, and, for each cluster operator, how many of its
+// fermion operators are not yet contracted and how many are contracted with the transformed operator
+struct wick_vertices {
+    const std::vector<int> * vertex_of;
+    std::vector<int> n_open;
+    std::vector<int> n_connected;
+
+    // record the contraction of operators i and j. returns false if it leaves a cluster operator
+    // with no open operators that is not contracted with the transformed operator
+    bool contract(size_t i, size_t j, int step) {
+        int vi = (*vertex_of)[i];
+        int vj = (*vertex_of)[j];
+        if ( vi > 0 ) n_open[vi] -= step;
+        if ( vj > 0 ) n_open[vj] -= step;
+        if ( vi == 0 && vj > 0 ) n_connected[vj] += step;
+        if ( vj == 0 && vi > 0 ) n_connected[vi] += step;
+        if ( step < 0 ) return true;
+        return !( vi > 0 && n_open[vi] == 0 && n_connected[vi] == 0 )
+            && !( vj > 0 && n_open[vj] == 0 && n_connected[vj] == 0 );
+    }
+};
+
+// contract each quasi-creator, from left to right, with an uncontracted quasi-annihilator to its left.
+// partners are tried from nearest to farthest so that terms appear in the same order as they do when
+// the string is brought to normal order by successive swaps (which label set survives consolidation
+// depends on this order)
+static void add_full_contractions(const std::shared_ptr<pq_string> &in,
+                                  const std::vector<size_t> &creators,
+                                  size_t which_creator,
+                                  std::vector<bool> &contracted,
+                                  int sign,
+                                  std::vector<delta_functions> &deltas,
+                                  double boson_factor,
+                                  wick_vertices *vertices,
+                                  std::vector<std::shared_ptr<pq_string> > &ordered) {
+
+    if ( which_creator == creators.size() ) {
+
+        std::shared_ptr<pq_string> newguy = std::make_shared<pq_string>(in.get(), false);
+        newguy->sign *= sign;
+        newguy->factor *= boson_factor;
+        for (const delta_functions & delta : deltas) {
+            newguy->deltas.push_back(delta);
+        }
+        ordered.push_back(newguy);
+        return;
+    }
+
+    size_t j = creators[which_creator];
+
+    // number of uncontracted operators between the partners
+    size_t n_between = 0;
+    for (int i = (int)j - 1; i >= 0; i--) {
+
+        if ( contracted[i] ) continue;
+
+        // a nonzero contraction needs a quasi-annihilator with the opposite (true-vacuum) dagger
+        if ( !in->is_dagger_fermi[i] && in->is_dagger[i] != in->is_dagger[j] ) {
+
+            delta_functions delta;
+            delta.labels.push_back(label_name(in->symbol[i]));
+            delta.labels.push_back(label_name(in->symbol[j]));
+            delta.sort();
+            deltas.push_back(delta);
+
+            contracted[i] = contracted[j] = true;
+            if ( !vertices || vertices->contract(i, j, 1) ) {
+                add_full_contractions(in, creators, which_creator + 1, contracted, n_between % 2 ? -sign : sign, deltas, boson_factor, vertices, ordered);
+            }
+            if ( vertices ) vertices->contract(i, j, -1);
+            contracted[i] = contracted[j] = false;
+
+            deltas.pop_back();
+        }
+        n_between++;
+    }
+}
+
+void contract_operators_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vector<std::shared_ptr<pq_string> > &ordered,
+                                     const std::vector<int> *vertex_of) {
+
+    if ( in->skip ) return;
+
+    size_t n = in->symbol.size();
+
+    // no full contractions unless every creator has a matching annihilator to its left
+    if ( !in->is_fully_contractible() ) return;
+
+    size_t n_boson_contractions = count_boson_contractions(in->is_boson_dagger);
+    if ( n_boson_contractions == 0 ) return;
+
+    std::vector<size_t> creators;
+    for (size_t i = 0; i < n; i++) {
+        if ( in->is_dagger_fermi[i] ) creators.push_back(i);
+    }
+
+    std::vector<bool> contracted(n, false);
+    std::vector<delta_functions> deltas;
+    deltas.reserve(n / 2);
+
+    if ( !vertex_of ) {
+        add_full_contractions(in, creators, 0, contracted, 1, deltas, (double)n_boson_contractions, nullptr, ordered);
+        return;
+    }
+
+    wick_vertices vertices{vertex_of, {}, {}};
+    int n_vertices = 1;
+    for (int vertex : *vertex_of) n_vertices = std::max(n_vertices, vertex + 1);
+    vertices.n_open.assign(n_vertices, 0);
+    vertices.n_connected.assign(n_vertices, 0);
+    for (int vertex : *vertex_of) {
+        if ( vertex > 0 ) vertices.n_open[vertex]++;
+    }
+
+    add_full_contractions(in, creators, 0, contracted, 1, deltas, (double)n_boson_contractions, &vertices, ordered);
+}
+
+}
@@ -0,0 +1,53 @@
+//
+// pdaggerq - A code for bringing strings of creation / annihilation operators to normal order.
+// Filename: pq_wick.h
+// Copyright (C) 2020 A. Eugene DePrince III
+//
+// Author: A. Eugene DePrince III <adeprince@fsu.edu>
+// Maintainer: DePrince group
+//
+// This file is part of the pdaggerq package.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#ifndef PQ_WICK_H
+#define PQ_WICK_H
+
+#include<string>
+#include<vector>
+
+#include "pq_string.h"
+
+namespace pdaggerq {
+
+/**
+ *
+ * evaluate the fermi-vacuum expectation value of a string directly with wick's theorem. every full
+ * contraction of the fermion operators (and of the boson operators) is enumerated without building
+ * partially-ordered intermediate strings. the sign of each term follows from the number of crossing
+ * contractions, and each fermion contraction contributes one delta function
+ *
+ * @param in: the input string (symbols and daggers must be set)
+ * @param ordered: a list of strings to which the fully-contracted strings will be added
+ * @param vertex_of: if not null, the operator that each entry of in->symbol comes from: 0 for the
+ *                   transformed operator, 1, 2, ... for the cluster operators, and -1 for the bra
+ *                   and ket. only contractions in which every cluster operator is contracted with
+ *                   the transformed operator are enumerated
+ */
+void contract_operators_fermi_vacuum(const std::shared_ptr<pq_string> &in, std::vector<std::shared_ptr<pq_string> > &ordered,
+                                     const std::vector<int> *vertex_of = nullptr);
+
+}
+
+#endif
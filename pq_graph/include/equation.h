@@ -24,6 +24,7 @@
 #ifndef PDAGGERQ_EQUATION_H
 #define PDAGGERQ_EQUATION_H
 
+#include <set>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -54,6 +55,12 @@ namespace pdaggerq {
         scaling_map flop_map_; // map of flop scaling with linkage occurrence in equation
         scaling_map mem_map_; // map of memory scaling with linkage occurrence in equation
 
+        /// inverted index from vertex names to the terms that hold them (see index_terms())
+        unordered_map<string, vector<pair<size_t, size_t>>> term_index_; // name -> (term position, count)
+        size_t terms_version_ = 0; // bumped whenever the terms are handed out for modification
+        size_t indexed_version_ = 0; // version of the terms when the index was built
+        bool is_indexed_ = false; // whether the index matches the terms
+
     public:
         static inline size_t nthreads_ = 1; // number of threads to use when substituting
         static inline bool permuted_merge_ = false; // whether to merge terms with permutations
@@ -153,21 +160,21 @@ namespace pdaggerq {
          * @return terms in the equation
          */
         const vector<Term> &terms() const { return terms_; }
-        vector<Term> &terms() { return terms_; }
+        vector<Term> &terms() { ++terms_version_; return terms_; }
 
         /**
          * Get begin iterator of terms
          * @return begin iterator of terms
          */
         vector<Term>::const_iterator begin() const { return terms_.begin(); }
-        vector<Term>::iterator begin() { return terms_.begin(); }
+        vector<Term>::iterator begin() { ++terms_version_; return terms_.begin(); }
 
         /**
          * Get end iterator of terms
          * @return end iterator of terms
          */
         vector<Term>::const_iterator end() const { return terms_.end(); }
-        vector<Term>::iterator end() { return terms_.end(); }
+        vector<Term>::iterator end() { ++terms_version_; return terms_.end(); }
 
         /**
          * Get number of terms
@@ -178,7 +185,7 @@ namespace pdaggerq {
          /**
           * clear the equation
           */
-         void clear() { terms_.clear(); }
+         void clear() { terms_.clear(); clear_index(); }
 
          /**
           * check if the equation is empty
@@ -240,9 +247,10 @@ namespace pdaggerq {
          * substitute a linkage into the equation
          * @param linkage linkage to substitute
          * @param allow_equality allow equality of scaling
+         * @param modified_names if not null, collects the names of the vertices in the terms that were changed
          * @return number of substitutions
          */
-        size_t substitute(const LinkagePtr &linkage, bool allow_equality = false);
+        size_t substitute(const LinkagePtr &linkage, bool allow_equality = false, std::set<string> *modified_names = nullptr);
 
         /**
          * test a linkage substituted into the equation
@@ -252,10 +260,42 @@ namespace pdaggerq {
          */
         size_t test_substitute(const MutableLinkagePtr &linkage, scaling_map &test_flop_map, bool allow_equality = false);
 
+        /**
+         * test a linkage substituted into the terms of the equation, without the check against the
+         * scaling of the whole equation
+         * @param linkage linkage to substitute
+         * @param delta_flop_map reference to flop scaling map that collects the change in flop scaling of the terms
+         * @return number of substitutions
+         */
+        size_t test_substitute_terms(const MutableLinkagePtr &linkage, scaling_map &delta_flop_map) const;
+
+        /**
+         * build the index from vertex names (which carry the line types) to the terms that hold them,
+         * unless the current index is still valid. the index is dropped by the members of the equation
+         * that change its terms, and it goes stale once the terms are taken through a non-const
+         * accessor (terms(), begin(), end())
+         */
+        void index_terms();
+
+        /**
+         * drop the index of the terms
+         */
+        void clear_index() { term_index_.clear(); is_indexed_ = false; }
+
+        /**
+         * find the terms that hold every vertex of a linkage (as many times as the linkage does).
+         * only these terms can be compatible with the linkage
+         * @param linkage linkage to search for
+         * @return positions of the terms in ascending order, or every position if the index is not built
+         */
+        vector<size_t> indexed_terms(const LinkagePtr &linkage) const;
+
         /**
          * collect all possible linkages from all terms
+         * @param compute_all whether to recompute the linkages of terms that already generated them
+         * @param max_depth maximum number of rhs in a linkage
          */
-        linkage_set make_all_links(bool compute_all = true);
+        linkage_set make_all_links(bool compute_all, size_t max_depth);
 
         /**
          * substitute scalars into the equation
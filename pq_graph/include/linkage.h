@@ -107,6 +107,8 @@ namespace pdaggerq {
         mutable vertex_vector link_vector_; // all non-intermediate vertices from linkages
         mutable linkage_vector permutations_; // all permutations of the linkage
 
+        size_t hash_ = 0; // structural hash of the linkage (set by set_properties)
+
     public:
         long id_ = -1; // id of the linkage (default to -1 if not set)
         size_t depth_{}; // number of vertices in the linkage
@@ -374,6 +376,7 @@ namespace pdaggerq {
          * @return vector of permutations
          */
          static inline bool low_memory_ = false; // whether to store permutations in memory for lazy evaluation
+         static inline bool exhaustive_ordering_ = false; // whether to test every ordering instead of searching subsets
         linkage_vector permutations(bool regenerate = false) const;
 
         /**
@@ -382,6 +385,17 @@ namespace pdaggerq {
          */
         LinkagePtr best_permutation() const;
 
+        /**
+         * Find the permutations of the linkage with the lowest scaling by searching over subsets of its vertices,
+         * instead of testing every permutation. The scaling of each contraction only depends on the set of
+         * vertices contracted before it, so the lowest scaling of each subset is found once.
+         * @param best_perms vector to fill with the identity and the permutations with the lowest scaling, in the
+         *                   order of permutations()
+         * @return false if the search does not apply to this linkage (best_perms is left empty)
+         */
+        bool optimal_permutations(linkage_vector &best_perms) const;
+        static constexpr size_t max_subset_vertices_ = 10; // the search keeps n * 2^n contraction scalings
+
         /**
          * Return all subgraphs of the linkage
          * @param max_depth maximum depth of subgraphs returned
@@ -401,6 +415,13 @@ namespace pdaggerq {
          */
         const std::vector<std::array<int_fast8_t, 2>> &connec_map() const { return connec_map_; }
 
+        /**
+         * Get the structural hash of the linkage, built from the hashes of the left and right vertices,
+         * the line types, and connec_map. equal linkages have equal hashes
+         * @return hash of the linkage
+         */
+        size_t hash() const { return hash_; }
+
         /**
          * Make a series of linkages from vertices into a single linkage
          * @param op_vec list of vertices
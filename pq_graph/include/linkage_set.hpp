@@ -23,7 +23,12 @@
 
 #ifndef PDAGGERQ_LINKAGE_SET_HPP
 #define PDAGGERQ_LINKAGE_SET_HPP
+#include <array>
 #include <functional>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
 #include <unordered_set>
 
 #include "linkage.h"
@@ -43,14 +48,14 @@ namespace pdaggerq {
         LinkageHash() = default;
 
         size_t operator()(const LinkagePtr &linkage) const {
-            constexpr hash<string> str_hash;
-            return str_hash(linkage->base_name());
+            return linkage->hash(); // cached when the linkage is built
         }
     }; // struct linkage_hash
 
     struct LinkageEqual {
         bool operator()(const LinkagePtr &lhs, const LinkagePtr &rhs) const {
-            return *lhs == *rhs;
+            // only compare the full linkages when the hashes match
+            return lhs->hash() == rhs->hash() && *lhs == *rhs;
         }
     }; // struct linkage_pred
 
@@ -58,42 +63,105 @@ namespace pdaggerq {
     template<typename T>
     using linkage_map = std::unordered_map<LinkagePtr, T, LinkageHash, LinkageEqual>;
 
-    // struct for parallel linkage set operations
+    // set of linkages owned by a single thread (no locks; use linkage_set when threads share the set)
+    typedef std::unordered_set<LinkagePtr, LinkageHash, LinkageEqual> local_linkage_set;
+
+    /**
+     * set of linkages that can be shared between threads. the linkages are split into shards by their
+     * hash, and each shard has its own lock, so threads only wait for each other when they touch the
+     * same shard. lookups take a shared lock and never block each other.
+     * iteration, indexing, and the set operators that return a new set are not safe while other threads
+     * insert or erase linkages
+     */
     class linkage_set {
 
-        mutable std::mutex mtx_; // mutex for thread safety
-        typedef std::unordered_set<LinkagePtr, LinkageHash, LinkageEqual> linkage_container;
-        linkage_container linkages_; // set of linkages
+        typedef local_linkage_set linkage_container;
+
+        static constexpr size_t n_shards_ = 64; // number of shards (power of two)
+
+        struct shard {
+            mutable std::shared_mutex mtx_; // lock for this shard
+            linkage_container linkages_; // linkages in this shard
+        };
+        std::array<shard, n_shards_> shards_; // linkages, split by hash
+
+        /**
+         * get the shard that holds a linkage
+         * @param linkage linkage to find
+         * @return index of the shard
+         */
+        static size_t shard_index(const LinkagePtr &linkage) {
+            // use the high bits of a mixed hash, so the shards do not share buckets of the inner sets
+            return (linkage->hash() * 0x9e3779b97f4a7c15ull) >> (64 - 6);
+        }
+        static_assert(n_shards_ == 1 << 6, "shard_index assumes 64 shards");
 
     public:
+
+        /**
+         * iterator over all linkages, shard by shard
+         */
+        class const_iterator {
+            const linkage_set *set_ = nullptr;
+            size_t shard_ = n_shards_;
+            linkage_container::const_iterator it_;
+
+            // move to the first linkage at or after the current position
+            void skip_empty() {
+                while (shard_ < n_shards_ && it_ == set_->shards_[shard_].linkages_.end()) {
+                    if (++shard_ < n_shards_) it_ = set_->shards_[shard_].linkages_.begin();
+                }
+            }
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = LinkagePtr;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const LinkagePtr *;
+            using reference = const LinkagePtr &;
+
+            const_iterator() = default;
+            const_iterator(const linkage_set *set, size_t shard) : set_(set), shard_(shard) {
+                if (shard_ < n_shards_) {
+                    it_ = set_->shards_[shard_].linkages_.begin();
+                    skip_empty();
+                }
+            }
+
+            reference operator*() const { return *it_; }
+            pointer operator->() const { return &*it_; }
+            const_iterator &operator++() { ++it_; skip_empty(); return *this; }
+            const_iterator operator++(int) { const_iterator tmp = *this; ++*this; return tmp; }
+
+            bool operator==(const const_iterator &other) const {
+                if (shard_ != other.shard_) return false;
+                return shard_ == n_shards_ || it_ == other.it_;
+            }
+            bool operator!=(const const_iterator &other) const { return !(*this == other); }
+        };
+
         /**
          * constructor
          */
-        linkage_set() : linkages_(256) {}
+        linkage_set() = default;
 
         /**
          * constructor with initial bucket n_ops
          * @param size initial n_ops of the set
          */
-        explicit linkage_set(size_t size) : linkages_(size) {}
+        explicit linkage_set(size_t size) { reserve(size); }
 
         /**
          * copy constructor
          * @param other linkage set to copy
          */
-        linkage_set(const linkage_set &other){
-            std::lock_guard<std::mutex> lock(mtx_);
-            linkages_ = other.linkages_;
-        }
+        linkage_set(const linkage_set &other) { *this = other; }
 
         /**
          * move constructor
          * @param other linkage set to move
          */
-        linkage_set(linkage_set &&other) noexcept {
-            std::lock_guard<std::mutex> lock(mtx_);
-            linkages_ = std::move(other.linkages_);
-        }
+        linkage_set(linkage_set &&other) noexcept { *this = std::move(other); }
 
         /**
          * copy assignment operator
@@ -101,8 +169,12 @@ namespace pdaggerq {
          * @return reference to this
          */
         linkage_set &operator=(const linkage_set &other){
-            std::lock_guard<std::mutex> lock(mtx_);
-            linkages_ = other.linkages_;
+            if (this == &other) return *this;
+            for (size_t s = 0; s < n_shards_; s++) {
+                std::unique_lock<std::shared_mutex> lock(shards_[s].mtx_);
+                std::shared_lock<std::shared_mutex> other_lock(other.shards_[s].mtx_);
+                shards_[s].linkages_ = other.shards_[s].linkages_;
+            }
             return *this;
         };
 
@@ -112,8 +184,12 @@ namespace pdaggerq {
          * @return reference to this
          */
         linkage_set &operator=(linkage_set &&other) noexcept{
-            std::lock_guard<std::mutex> lock(mtx_);
-            linkages_ = std::move(other.linkages_);
+            if (this == &other) return *this;
+            for (size_t s = 0; s < n_shards_; s++) {
+                std::unique_lock<std::shared_mutex> lock(shards_[s].mtx_);
+                std::unique_lock<std::shared_mutex> other_lock(other.shards_[s].mtx_);
+                shards_[s].linkages_ = std::move(other.shards_[s].linkages_);
+            }
             return *this;
         }
 
@@ -125,10 +201,13 @@ namespace pdaggerq {
         /**
          * insert a linkage into the set
          * @param linkage linkage to insert
+         * @return true if the linkage was not in the set before
          */
-        auto insert(const VertexPtr &linkage) {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return linkages_.insert(as_link(linkage));
+        bool insert(const VertexPtr &linkage) {
+            LinkagePtr link = as_link(linkage);
+            shard &s = shards_[shard_index(link)];
+            std::unique_lock<std::shared_mutex> lock(s.mtx_);
+            return s.linkages_.insert(link).second;
         }
 
         /**
@@ -136,18 +215,18 @@ namespace pdaggerq {
          * @param linkages iterator to linkages
          */
         void insert(const typename linkage_vector::const_iterator &begin, const typename linkage_vector::const_iterator &end) {
-            std::lock_guard<std::mutex> lock(mtx_);
-            linkages_.insert(begin, end);
+            for (auto it = begin; it != end; ++it)
+                insert(*it);
         }
         void insert(const typename vertex_vector::const_iterator &begin, const typename vertex_vector::const_iterator &end) {
-            std::lock_guard<std::mutex> lock(mtx_);
             for (auto it = begin; it != end; ++it)
-                linkages_.insert(as_link(*it));
+                insert(*it);
         }
 
         size_t count(const LinkagePtr &linkage) const {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return linkages_.count(linkage);
+            const shard &s = shards_[shard_index(linkage)];
+            std::shared_lock<std::shared_mutex> lock(s.mtx_);
+            return s.linkages_.count(linkage);
         }
 
         /**
@@ -164,33 +243,33 @@ namespace pdaggerq {
          * @return number of linkages
          */
         size_t size() const {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return linkages_.size();
-        }
-
-        /**
-         * get the set of linkages
-         * @return set of linkages
-         */
-        const linkage_container &linkages() const {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return linkages_;
+            size_t n = 0;
+            for (const shard &s : shards_) {
+                std::shared_lock<std::shared_mutex> lock(s.mtx_);
+                n += s.linkages_.size();
+            }
+            return n;
         }
 
         /**
          * clear the set of linkages
          */
         void clear() {
-            std::lock_guard<std::mutex> lock(mtx_);
-            linkages_.clear();
+            for (shard &s : shards_) {
+                std::unique_lock<std::shared_mutex> lock(s.mtx_);
+                s.linkages_.clear();
+            }
         }
 
         /**
          * reserve space for n_ops linkages
          */
         void reserve(size_t n_ops) {
-            std::lock_guard<std::mutex> lock(mtx_);
-            linkages_.reserve(n_ops);
+            if (n_ops < n_shards_) return; // small sets stay in the initial buckets
+            for (shard &s : shards_) {
+                std::unique_lock<std::shared_mutex> lock(s.mtx_);
+                s.linkages_.reserve(n_ops / n_shards_ + 1);
+            }
         }
 
         /**
@@ -198,34 +277,34 @@ namespace pdaggerq {
          * @return true if the set is empty
          */
         bool empty() const {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return linkages_.empty();
+            for (const shard &s : shards_) {
+                std::shared_lock<std::shared_mutex> lock(s.mtx_);
+                if (!s.linkages_.empty()) return false;
+            }
+            return true;
         }
 
         /**
          * begin iterator for set of linkages
          */
-        auto begin() const {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return linkages_.begin();
-        }
+        const_iterator begin() const { return {this, 0}; }
 
         /**
          * end iterator for set of linkages
          */
-        auto end() const {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return linkages_.end();
-        }
+        const_iterator end() const { return {this, n_shards_}; }
 
         /**
          * find a linkage in the set
          * @param linkage linkage to find
-         * @return iterator to linkage in set
+         * @return the linkage in the set, or nullptr if it is not in the set
          */
-        auto find(const LinkagePtr &linkage) const {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return linkages_.find(linkage);
+        LinkagePtr find(const LinkagePtr &linkage) const {
+            const shard &s = shards_[shard_index(linkage)];
+            std::shared_lock<std::shared_mutex> lock(s.mtx_);
+            auto it = s.linkages_.find(linkage);
+            if (it == s.linkages_.end()) return nullptr;
+            return *it;
         }
 
         /**
@@ -234,19 +313,26 @@ namespace pdaggerq {
          * @return const reference to linkage
          */
         const LinkagePtr &operator[](size_t i) const {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return *next(linkages_.begin(), (long) i);
+            for (const shard &s : shards_) {
+                if (i < s.linkages_.size()) return *next(s.linkages_.begin(), (long) i);
+                i -= s.linkages_.size();
+            }
+            throw std::out_of_range("linkage_set index out of range");
         }
 
-
         /**
-         * get reference to linkage in set by value from [] operator
-         * @param linkage linkage to get reference to
-         * @return reference to linkage
+         * get the linkage in the set that is equal to a given linkage
+         * @param linkage linkage to look up
+         * @return copy of the linkage in the set (taken under the lock)
+         * @throws std::out_of_range if the linkage is not in the set
          */
-        const LinkagePtr &operator[](const LinkagePtr &linkage) const {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return *linkages_.find(linkage);
+        LinkagePtr operator[](const LinkagePtr &linkage) const {
+            const shard &s = shards_[shard_index(linkage)];
+            std::shared_lock<std::shared_mutex> lock(s.mtx_);
+            auto it = s.linkages_.find(linkage);
+            if (it == s.linkages_.end())
+                throw std::out_of_range("linkage not found in linkage_set");
+            return *it;
         }
 
         /**
@@ -255,9 +341,8 @@ namespace pdaggerq {
          * @return new linkage set
          */
         linkage_set operator+(const linkage_set &other) const {
-            std::lock_guard<std::mutex> lock(mtx_);
             linkage_set new_set = *this; // new linkage set
-            for (const auto &linkage: other.linkages_) new_set.insert(linkage); // insert other set
+            new_set += other; // insert other set
             return new_set; // return new linkage set
         }
 
@@ -267,21 +352,58 @@ namespace pdaggerq {
          * @return new linkage set
          */
         linkage_set operator-(const linkage_set &other) const {
-            std::lock_guard<std::mutex> lock(mtx_);
             linkage_set new_set = *this; // new linkage set
-            for (const auto &linkage: other.linkages_) new_set.linkages_.erase(linkage); // remove other set
+            new_set -= other; // remove other set
             return new_set; // return new linkage set
         }
 
 
         /**
-         * overload += operator
+         * overload += operator. linkages are merged shard by shard, so each lock is taken once
          * @param other linkage set to add
          * @return reference to this
          */
         linkage_set &operator+=(const linkage_set &other) {
-            std::lock_guard<std::mutex> lock(mtx_);
-            linkages_.insert(other.linkages_.begin(), other.linkages_.end());
+            if (this == &other) return *this;
+            for (size_t s = 0; s < n_shards_; s++) {
+                std::shared_lock<std::shared_mutex> other_lock(other.shards_[s].mtx_);
+                if (other.shards_[s].linkages_.empty()) continue;
+                std::unique_lock<std::shared_mutex> lock(shards_[s].mtx_);
+                shards_[s].linkages_.insert(other.shards_[s].linkages_.begin(), other.shards_[s].linkages_.end());
+            }
+            return *this; // return this
+        }
+
+        /**
+         * merge a set that is no longer needed (e.g., one filled by a single thread) into this one.
+         * the nodes of the other set are moved without copying or rehashing the linkages
+         * @param other linkage set to add (left with the linkages that were already in this set)
+         * @return reference to this
+         */
+        linkage_set &operator+=(linkage_set &&other) {
+            if (this == &other) return *this;
+            for (size_t s = 0; s < n_shards_; s++) {
+                std::unique_lock<std::shared_mutex> other_lock(other.shards_[s].mtx_);
+                if (other.shards_[s].linkages_.empty()) continue;
+                std::unique_lock<std::shared_mutex> lock(shards_[s].mtx_);
+                shards_[s].linkages_.merge(other.shards_[s].linkages_);
+            }
+            return *this; // return this
+        }
+
+        /**
+         * merge a set filled by a single thread into this one. the nodes are moved shard by shard
+         * without copying or rehashing the linkages
+         * @param other local set to add (left empty)
+         * @return reference to this
+         */
+        linkage_set &operator+=(local_linkage_set &&other) {
+            while (!other.empty()) {
+                auto node = other.extract(other.begin());
+                shard &s = shards_[shard_index(node.value())];
+                std::unique_lock<std::shared_mutex> lock(s.mtx_);
+                s.linkages_.insert(std::move(node)); // duplicates are dropped with the node
+            }
             return *this; // return this
         }
 
@@ -291,9 +413,13 @@ namespace pdaggerq {
          * @return reference to this
          */
         linkage_set &operator-=(const linkage_set &other) {
-            std::lock_guard<std::mutex> lock(mtx_);
-            for (const auto &linkage: other.linkages_)
-                linkages_.erase(linkage); // remove other set
+            if (this == &other) { clear(); return *this; }
+            for (size_t s = 0; s < n_shards_; s++) {
+                std::unique_lock<std::shared_mutex> lock(shards_[s].mtx_);
+                std::shared_lock<std::shared_mutex> other_lock(other.shards_[s].mtx_);
+                for (const auto &linkage: other.shards_[s].linkages_)
+                    shards_[s].linkages_.erase(linkage); // remove other set
+            }
             return *this; // return this
         }
 
@@ -302,8 +428,9 @@ namespace pdaggerq {
          * @param linkage linkage to erase
          */
         size_t erase(const LinkagePtr &linkage) {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return linkages_.erase(linkage);
+            shard &s = shards_[shard_index(linkage)];
+            std::unique_lock<std::shared_mutex> lock(s.mtx_);
+            return s.linkages_.erase(linkage);
         }
 
         /**
@@ -312,8 +439,13 @@ namespace pdaggerq {
          * @return true if the sets are equal
          */
         bool operator==(const linkage_set &other) const {
-            std::lock_guard<std::mutex> lock(mtx_);
-            return linkages_ == other.linkages_;
+            if (this == &other) return true;
+            for (size_t s = 0; s < n_shards_; s++) {
+                std::shared_lock<std::shared_mutex> lock(shards_[s].mtx_);
+                std::shared_lock<std::shared_mutex> other_lock(other.shards_[s].mtx_);
+                if (shards_[s].linkages_ != other.shards_[s].linkages_) return false;
+            }
+            return true;
         }
 
     }; // class linkage_set
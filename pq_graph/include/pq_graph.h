@@ -33,7 +33,7 @@
 #include <string>
 #include <vector>
 #include <fstream>
-#include <fcntl.h>
+#include <mutex>
 
 #include "../../pdaggerq/pq_helper.h"
 #include "equation.h"
@@ -44,7 +44,23 @@ using std::ofstream;
 namespace pdaggerq {
 
     class PQGraph; // forward declaration
+    struct print_guard; // forward declaration
+
+    /**
+     * state that belongs to a single PQGraph object; it is not copied or assigned with the graph
+     */
+    struct graph_instance_state {
+        std::mutex mutex; // serializes calls from python on this graph
+        size_t quiet = 0; // number of active print_guards that silence this graph
+
+        graph_instance_state() = default;
+        graph_instance_state(const graph_instance_state &) {}
+        graph_instance_state &operator=(const graph_instance_state &) { return *this; }
+    };
+
     class PQGraph {
+        friend struct print_guard;
+
         map<string, Equation> equations_; // equations to be optimized
 
         // TODO: merge temp tracking variables into a class with methods for adding, removing, and updating temps
@@ -87,6 +103,7 @@ namespace pdaggerq {
         scaling_map flop_map_init_; // map of flop scaling before reordering
         scaling_map mem_map_init_; // map of memory scaling before reordering
         size_t num_terms_init_ = 0; // number of terms before optimization
+        int reindex_count_ = 0; // number of calls to reindex (every third call stops reindexing)
 
         scaling_map flop_map_pre_; // map of flop scaling before reordering or before subexpression elimination
         scaling_map mem_map_pre_; // map of memory scaling before reordering or before subexpression elimination
@@ -133,6 +150,14 @@ namespace pdaggerq {
         /// whether the equations have any sigma vectors
         bool has_sigma_vecs_ = false;
 
+        /// lock and print state of this graph
+        mutable graph_instance_state instance_;
+
+        /**
+         * stream for the output of this graph (discards everything while a print_guard is locked)
+         */
+        std::ostream &out() const;
+
     public:
 
         // default constructor
@@ -260,8 +285,9 @@ namespace pdaggerq {
         /**
          * collect all possible linkages from all equations (remove none)
          * @param recompute whether to recompute all linkages or just the ones in modified terms
+         * @param max_depth maximum number of rhs in a linkage
          */
-        void make_all_links(bool recompute);
+        void make_all_links(bool recompute, size_t max_depth);
 
         /**
          * Forget the linkage history within all linkages to free memory from lazy evaluation
@@ -309,7 +335,7 @@ namespace pdaggerq {
          * @param previous_map the previous scaling map
          * @param current_map the current scaling map
          */
-        static void print_new_scaling(const scaling_map &original_map, const scaling_map &previous_map, const scaling_map &current_map) ;
+        void print_new_scaling(const scaling_map &original_map, const scaling_map &previous_map, const scaling_map &current_map) const;
 
         /**
          * get all terms that contain a given intermediate
@@ -353,44 +379,28 @@ namespace pdaggerq {
     }; // PQGraph
 
     /**
-     * struct to disable cout stream for printing within a scope
+     * struct to silence the output of a PQGraph within a scope. only the graph's own output is affected,
+     * so printing from other graphs, pq_helper objects, or python threads is left alone
      */
     struct print_guard {
 
-        bool prior_locked;
-        int bak_out, null_out;
+        const PQGraph &graph;
+        bool locked = false;
 
-        // Constructor to lock cout
-        print_guard() {
-            prior_locked = std::cout.fail();
-            if (!prior_locked) {
-                fflush(stdout);
-                bak_out = dup(fileno(stdout));
-            }
-        }
-
-        // Restore cout
-        void restore() const {
-            std::cout.clear();
-            fflush(stdout);
-            dup2(bak_out, fileno(stdout));
-            close(bak_out);
-        }
+        explicit print_guard(const PQGraph &graph) : graph(graph) {}
 
-        // Redirect cout to null stream
+        // silence the graph
         void lock() {
-            if (!prior_locked) {
-                std::cout.setstate(std::ios::failbit);
-                null_out = open("/dev/null",  O_WRONLY);
-                dup2(null_out, fileno(stdout));
-                close(null_out);
+            if (!locked) {
+                ++graph.instance_.quiet;
+                locked = true;
             }
         }
 
-        // Destructor to restore the original buffer
+        // restore the output of the graph
         ~print_guard() {
-            if (!prior_locked)
-                restore();
+            if (locked)
+                --graph.instance_.quiet;
         }
     };
 
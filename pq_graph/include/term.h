@@ -101,8 +101,10 @@ namespace pdaggerq {
          * Constructor
          * @param name name of the assignment vertex
          * @param pq_str representation of term from pq_helper
+         * @param is_spin_blocked whether the strings of the pq_helper are blocked by spin
+         * @param is_range_blocked whether the strings of the pq_helper are blocked by label ranges
          */
-        Term(const string &name, const shared_ptr<pq_string>& pq_str);
+        Term(const string &name, const shared_ptr<pq_string>& pq_str, bool is_spin_blocked = false, bool is_range_blocked = false);
 
         /**
          * Constructor
@@ -459,8 +461,9 @@ namespace pdaggerq {
 
         /**
          * collect all possible linkages from all equations
+         * @param max_depth maximum number of rhs in a linkage
          */
-        linkage_set make_all_links() const;
+        local_linkage_set make_all_links(size_t max_depth) const;
 
         /**
          * Get the ids of all intermediate vertices within the term
@@ -507,9 +510,10 @@ namespace pdaggerq {
         /**
          * check if term includes rhs of the linkage
          * @param linkage linkage to check
+         * @param check_vertices whether to check the vertex names (false if the term was found by Equation::indexed_terms)
          * @return boolean indicating if term includes rhs of the linkage
          */
-        bool is_compatible(const LinkagePtr &linkage) const;
+        bool is_compatible(const LinkagePtr &linkage, bool check_vertices = true) const;
 
         /**
          * swaps the sign of the term
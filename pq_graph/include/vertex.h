@@ -104,10 +104,11 @@ namespace pdaggerq {
          */
         explicit Vertex(const string &vertex_string);
 
-        /// Constructors from different pq tensors
-        explicit Vertex(const delta_functions &delta);
-        explicit Vertex(const integrals &integral, const string &type);
-        explicit Vertex(const amplitudes &amplitude, char type);
+        /// Constructors from different pq tensors. the block of each line is taken from the spin labels
+        /// or the label ranges of the tensor when the strings are blocked by spin or by range
+        explicit Vertex(const delta_functions &delta, bool is_spin_blocked = false, bool is_range_blocked = false);
+        explicit Vertex(const integrals &integral, const string &type, bool is_spin_blocked = false, bool is_range_blocked = false);
+        explicit Vertex(const amplitudes &amplitude, char type, bool is_spin_blocked = false, bool is_range_blocked = false);
 
         /**
          * Constructor
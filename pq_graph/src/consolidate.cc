@@ -25,6 +25,7 @@
 
 #include "../include/pq_graph.h"
 #include "iostream"
+#include <atomic>
 
 // include omp only if defined
 #ifdef _OPENMP
@@ -40,8 +41,43 @@ using std::ostream, std::string, std::vector, std::map, std::unordered_map, std:
 
 using namespace pdaggerq;
 
+namespace {
 
-void PQGraph::make_all_links(bool recompute) {
+    // the change in flop scaling of an equation when a candidate linkage is substituted into it
+    struct equation_score {
+        bool valid = false; // false until computed, or after a term sharing a vertex with the candidate changed
+        size_t num_subs = 0; // number of substitutions
+        scaling_map delta; // change in flop scaling of the terms
+    };
+
+    // scores of a candidate linkage, kept between iterations of PQGraph::substitute
+    struct candidate_score {
+        vector<string> names; // names of the vertices of the linkage
+        map<string, equation_score> equations; // scores by equation name
+    };
+
+    // a term can only be compatible with a candidate if it contains all vertices of the candidate, so
+    // the score of a candidate in an equation only changes if a modified term shares one of its vertices
+    void invalidate_scores(linkage_map<candidate_score> &scores, const map<string, set<string>> &modified_names) {
+        for (auto &[linkage, score] : scores) {
+            for (const auto &[eq_name, names] : modified_names) {
+                if (names.empty()) continue;
+                auto it = score.equations.find(eq_name);
+                if (it == score.equations.end() || !it->second.valid) continue;
+                for (const string &name : score.names) {
+                    if (names.count(name)) {
+                        it->second.valid = false;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+}
+
+
+void PQGraph::make_all_links(bool recompute, size_t max_depth) {
 
     if (recompute)
         all_links_.clear(); // clear all prior candidates
@@ -49,7 +85,7 @@ void PQGraph::make_all_links(bool recompute) {
     linkage_set candidate_linkages; // set of linkages
     for (auto &[eq_name, equation]: equations_) {
         // get all linkages of equation and add to candidates
-        all_links_ += equation.make_all_links(recompute);
+        all_links_ += equation.make_all_links(recompute, max_depth);
     }
 
     // clear history of all linkages
@@ -115,51 +151,46 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
     /// generate all possible linkages from all arrangements
 
 
-    cout << "Generating all possible linkages..." << flush;
+    out() << "Generating all possible linkages..." << flush;
 
+    // the depth is kept locally, since Term::max_depth_ is shared with other graphs
     size_t org_max_depth = Term::max_depth_;
-    size_t current_depth;
-    if (batched_) {
-        Term::max_depth_ = 1; // set max depth to 1 for initial linkage generation
-        current_depth = 1;
-    } else {
-        current_depth = Term::max_depth_;
-    }
+    size_t current_depth = batched_ ? 1 : org_max_depth; // start from depth 1 for initial linkage generation if batched
 
 
-    make_all_links(true); // generate all possible linkages
-    cout << " Done" << endl;
+    make_all_links(true, current_depth); // generate all possible linkages
+    out() << " Done" << endl;
 
     size_t num_terms = get_num_terms();
 
 
     size_t num_contract = flop_map_.total();
 
-    cout << " ==> Substituting linkages into all equations <==" << endl;
-    cout << "     Total number of terms: " << num_terms << endl;
-    cout << "        Total contractions: " << flop_map_.total() << endl;
-    cout << "     Use batched algorithm: " << (batched_ ? "yes" : "no") << endl;
+    out() << " ==> Substituting linkages into all equations <==" << endl;
+    out() << "     Total number of terms: " << num_terms << endl;
+    out() << "        Total contractions: " << flop_map_.total() << endl;
+    out() << "     Use batched algorithm: " << (batched_ ? "yes" : "no") << endl;
     if (batched_)
-        cout << "                Batch size: " << ((long) batch_size_ == -1 ? "no limit" : to_string(batch_size_))
+        out() << "                Batch size: " << ((long) batch_size_ == -1 ? "no limit" : to_string(batch_size_))
              << endl;
-    cout << "         Max linkage depth: " << ((long) Term::max_depth_ == -1 ? "no limit" : to_string(Term::max_depth_))
+    out() << "         Max linkage depth: " << ((long) current_depth == -1 ? "no limit" : to_string(current_depth))
          << endl;
-    cout << "    Possible intermediates: " << all_links_.size() << endl;
-    cout << "    Number of threads used: " << nthreads_ << endl;
-    cout << " ====================================================" << endl << endl;
+    out() << "    Possible intermediates: " << all_links_.size() << endl;
+    out() << "    Number of threads used: " << nthreads_ << endl;
+    out() << " ====================================================" << endl << endl;
 
     // give user a warning if the number of possible linkages is large
     // suggest using the batch algorithm, making the max linkage smaller, or increasing number of threads
     if (all_links_.size() * num_contract > 1000 * 10000) {
-        cout << "WARNING: There are a large number of contractions and candidate intermediates." << endl;
-        cout << "         This may take a long time to run." << endl;
-        cout
+        out() << "WARNING: There are a large number of contractions and candidate intermediates." << endl;
+        out() << "         This may take a long time to run." << endl;
+        out()
                 << "         Consider increasing the number of threads, making the max depth smaller, or using the batch algorithm."
                 << endl;
-        cout << endl; //185
+        out() << endl; //185
     }
 
-    static size_t total_num_merged = 0;
+    static std::atomic<size_t> total_num_merged = 0; // totals are shared by all graphs
     size_t num_merged = merge_terms();
     total_num_merged += num_merged;
 
@@ -182,10 +213,14 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
 
     bool first_pass = true;
     scaling_map best_flop_map = flop_map_;
-    static size_t totalSubs = 0;
+    static std::atomic<size_t> totalSubs = 0;
     string temp_type = format_sigma ? "reused" : "temp"; // type of temporary to substitute
     temp_type = only_scalars ? "scalar" : temp_type; // type of equation to substitute into
 
+    // scores of the candidates from earlier iterations. they are only recomputed for equations in which
+    // a term that shares a vertex with the candidate was modified
+    linkage_map<candidate_score> candidate_scores;
+
     bool makeSub; // flag to make a substitution
     bool found_any = false; // flag to check if we found any linkages
     size_t retries = 0; // number of retries
@@ -200,26 +235,40 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
         // populate with pairs of flop maps with linkage for each equation
         vector<pair<scaling_map, MutableLinkagePtr>> test_data(n_linkages);
 
+        // list the candidates once; indexing into the set would walk it from the start for each one
+        linkage_vector test_vector(test_linkages.begin(), test_linkages.end());
+
+        // index the terms of each equation by their vertices, so candidates are only tested against terms that hold them
+        // (equations that were not changed since the last iteration keep their index)
+        for (auto &[eq_name, equation]: equations_) {
+            if (eq_name == "scalar" || eq_name == "reused") continue; // not tested below
+            equation.index_terms();
+        }
+
+        vector<candidate_score *> scores(n_linkages);
+        for (size_t i = 0; i < n_linkages; ++i)
+            scores[i] = &candidate_scores[test_vector[i]];
+
 
         // print ratio for showing progress
         size_t print_ratio = n_linkages / 20;
-        bool print_progress = n_linkages > 2000;
+        bool print_progress = n_linkages > 2000 && instance_.quiet == 0; // printf does not go through out()
 
         if (print_progress)
-            cout << "PROGRESS:" << endl;
+            out() << "PROGRESS:" << endl;
 
         /**
          * Iterate over all linkages in parallel and test if they can be substituted into the equations.
          * If they can, save the flop map for each equation.
          * If the flop map is better than the current best flop map, save the linkage.
          */
-#pragma omp parallel for schedule(guided) default(none) shared(test_linkages, test_data, \
+#pragma omp parallel for schedule(guided) default(none) shared(test_vector, scores, test_data, \
             ignore_linkages, equations_, stdout) firstprivate(n_linkages, temp_counts_, temp_type, allow_equality, \
             format_sigma, print_ratio, print_progress, only_scalars, separate_sigma_)
         for (int i = 0; i < n_linkages; ++i) {
 
             // copy linkage
-            MutableLinkagePtr linkage = as_link(test_linkages[i]->shallow());
+            MutableLinkagePtr linkage = as_link(test_vector[i]->shallow());
             bool is_scalar = linkage->is_scalar(); // check if linkage is a scalar
             bool is_sigma = linkage->is_sigma_;
 
@@ -251,7 +300,7 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
             }
 
             // check if this linkage is in the ignore set
-            if (ignore_linkages.find(linkage) != ignore_linkages.end()) {
+            if (ignore_linkages.contains(linkage)) {
                 linkage->forget(); // clear linkage history
                 continue;
             }
@@ -260,14 +309,31 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
             long temp_id = temp_counts_[eq_type] + 1; // get number of temps
             linkage->id() = temp_id;
 
+            candidate_score &score = *scores[i];
+            if (score.names.empty()) {
+                for (const auto &vertex : linkage->link_vector())
+                    score.names.push_back(vertex->name_);
+            }
+
             scaling_map test_flop_map; // flop map for test equation
             size_t numSubs = 0; // number of substitutions made
             for (auto &[eq_name, equation]: equations_) { // iterate over equations
 
                 if (eq_name == "scalar" || eq_name == "reused") continue; // skip scalar and reuse equations
 
+                // scaling of the linkage cannot be more than the equation
+                if (linkage->netscales().first > equation.flop_map()) continue;
+
                 // if the substitution is possible and beneficial, collect the flop map for the test equation
-                numSubs += equation.test_substitute(linkage, test_flop_map);
+                equation_score &eq_score = score.equations[eq_name];
+                if (!eq_score.valid) {
+                    eq_score.delta = scaling_map();
+                    eq_score.num_subs = equation.test_substitute_terms(linkage, eq_score.delta);
+                    eq_score.valid = true;
+                }
+                test_flop_map += equation.flop_map();
+                test_flop_map += eq_score.delta;
+                numSubs += eq_score.num_subs;
             }
 
             // add to test scalings if we found a tmp that occurs in more than one term
@@ -304,7 +370,7 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
             }
 
         } // end iterations over all linkages
-        if (print_progress) std::cout << "  Done" << std::endl << std::endl;
+        if (print_progress) out() << "  Done" << std::endl << std::endl;
 
 
 
@@ -389,15 +455,24 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
                 vector<string> eq_keys = get_equation_keys();
                 size_t num_subs = 0; // number of substitutions made
 
+                // vertices of the terms that change, for updating the scores of the other candidates
+                map<string, set<string>> modified_names;
+                set<string> link_names;
+                for (const auto &vertex : link_to_sub->link_vector())
+                    link_names.insert(vertex->name_);
+
                 for (const auto &eq_name: eq_keys) { // iterate over equations in parallel
                     // get equation
                     Equation &equation = equations_[eq_name]; // get equation
-                    size_t this_subs = equation.substitute(link_to_sub, allow_equality);
+                    size_t this_subs = equation.substitute(link_to_sub, allow_equality, &modified_names[eq_name]);
                     bool madeSub = this_subs > 0;
                     if (madeSub) {
                         // sort tmps in equation
                         equation.rearrange();
                         num_subs += this_subs;
+
+                        // the modified terms held the vertices of the linkage before the substitution
+                        modified_names[eq_name].insert(link_names.begin(), link_names.end());
                     }
                 }
                 totalSubs += num_subs; // add number of substitutions to total
@@ -418,12 +493,14 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
 
                     // add linkage to equations
                     const Term &precon_term = add_tmp(link_to_sub, equations_[eq_type], 1.0);
+                    modified_names[eq_type].insert(link_names.begin(), link_names.end());
+                    invalidate_scores(candidate_scores, modified_names);
 
                     // print linkage
                     {
-                        cout << " ====> Substitution " << to_string(temp_id) << " <==== " << endl;
-                        cout << " ====> " << precon_term << endl;
-                        cout << " Difference: " << flop_map_ - last_flop_map << std::endl << endl;
+                        out() << " ====> Substitution " << to_string(temp_id) << " <==== " << endl;
+                        out() << " ====> " << precon_term << endl;
+                        out() << " Difference: " << flop_map_ - last_flop_map << std::endl << endl;
                     }
 
                     // add linkage to this set
@@ -441,18 +518,18 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
                     update_timer.stop();
                     total_timer.stop();
 
-                    cout << "---------------------------- Remaining candidates: " << test_linkages.size();
-                    cout << " ----------------------------" << endl << endl;
-
-                    cout << "                  Net time: " << total_timer.elapsed() << endl;
-                    cout << "              Reorder Time: " << reorder_timer.elapsed() << endl;
-                    cout << "               Update Time: " << update_timer.elapsed() << endl;
-                    cout << "                 Sub. Time: " << substitute_timer.elapsed() << endl;
-                    cout << "         Average Sub. Time: " << substitute_timer.average_time() << endl;
-                    cout << "           Number of terms: " << num_terms << endl;
-                    cout << "    Number of Contractions: " << flop_map_.total() << endl;
-                    cout << "        Substitution count: " << num_subs << endl;
-                    cout << "  Total Substitution count: " << totalSubs << endl << endl;
+                    out() << "---------------------------- Remaining candidates: " << test_linkages.size();
+                    out() << " ----------------------------" << endl << endl;
+
+                    out() << "                  Net time: " << total_timer.elapsed() << endl;
+                    out() << "              Reorder Time: " << reorder_timer.elapsed() << endl;
+                    out() << "               Update Time: " << update_timer.elapsed() << endl;
+                    out() << "                 Sub. Time: " << substitute_timer.elapsed() << endl;
+                    out() << "         Average Sub. Time: " << substitute_timer.average_time() << endl;
+                    out() << "           Number of terms: " << num_terms << endl;
+                    out() << "    Number of Contractions: " << flop_map_.total() << endl;
+                    out() << "        Substitution count: " << num_subs << endl;
+                    out() << "  Total Substitution count: " << totalSubs << endl << endl;
                 }
 
                 total_timer.start();
@@ -483,6 +560,9 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
 
         if (recompute) {
 
+            // terms are merged and pruned below, so all scores are recomputed
+            candidate_scores.clear();
+
             // synchronize all pointers in graph
             forget();
 
@@ -493,7 +573,7 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
             size_t num_fused = merge_intermediates();
             if (num_fused > 0) {
                 total_num_merged += num_fused;
-                cout << "Fused " << num_fused << " terms." << endl;
+                out() << "Fused " << num_fused << " terms." << endl;
             }
 
             prune();
@@ -502,17 +582,16 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
             while (test_linkages.empty()) {
 
                 if (++current_depth == 0) --current_depth; // reset depth if overflow
-                Term::max_depth_ = current_depth; // increase max depth
 
                 {
-                    cout << "Regenerating test set with depth " << flush;
+                    out() << "Regenerating test set with depth " << flush;
                     if (current_depth >= org_max_depth)
-                        cout << "(max) ... " << flush;
-                    else cout << "(" << current_depth << ") ... " << flush;
+                        out() << "(max) ... " << flush;
+                    else out() << "(" << current_depth << ") ... " << flush;
                 }
 
                 // regenerate all valid linkages with the new depth
-                make_all_links(true);
+                make_all_links(true, current_depth);
 
                 // update test linkages
                 test_linkages = all_links_ - ignore_linkages;
@@ -523,7 +602,7 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
                 for (auto &linkage: test_linkages)
                     linkage->forget(true);
 
-                cout << " Done (" << "found " << test_linkages.size() << ")" << endl;
+                out() << " Done (" << "found " << test_linkages.size() << ")" << endl;
 
                 if (current_depth >= org_max_depth)
                     break; // break if we have reached the maximum depth
@@ -547,7 +626,7 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
             if (current_depth == org_max_depth && !makeSub) {
                 retries++;
                 if (retries > 5) {
-                    cout << "Could not find any more substitutions." << endl;
+                    out() << "Could not find any more substitutions." << endl;
                     break;
                 }
             } else if (makeSub) {
@@ -570,14 +649,12 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
     size_t num_fused = merge_intermediates();
     if (num_fused > 0) {
         total_num_merged += num_fused;
-        cout << "Fused " << num_fused << " terms." << endl;
+        out() << "Fused " << num_fused << " terms." << endl;
     }
 
     // prune intermediates, but also remove single use intermediates
     prune();
 
-    Term::max_depth_ = org_max_depth;
-
     // resort tmps
     for (auto & [type, eq] : equations_)
         eq.rearrange();
@@ -590,33 +667,33 @@ void PQGraph::substitute(bool format_sigma, bool only_scalars) {
 
 
     if (temp_counts_[temp_type] >= max_temps_)
-        cout << "WARNING: Maximum number of substitutions reached. " << endl << endl;
+        out() << "WARNING: Maximum number of substitutions reached. " << endl << endl;
 
     if (!found_any) {
-        cout << "No substitutions found." << endl << endl;
+        out() << "No substitutions found." << endl << endl;
         return;
     }
 
     // print total time elapsed
-    cout << endl << "=================================> Substitution Summary <=================================" << endl;
+    out() << endl << "=================================> Substitution Summary <=================================" << endl;
 
     num_terms = get_num_terms();
     for (const auto & [type, count] : temp_counts_) {
         if (count == 0)
             continue;
-        cout << "    Found " << count << " " << type << endl;
+        out() << "    Found " << count << " " << type << endl;
     }
 
     total_timer.stop();
-    cout << "    Total Time: " << total_timer.elapsed() << endl;
+    out() << "    Total Time: " << total_timer.elapsed() << endl;
     total_timer.start();
 
-    cout << "    Total number of terms: " << num_terms << endl;
-    cout << "    Total terms merged: " << total_num_merged << endl;
-    cout << "    Total contractions: " << flop_map_.total() << (format_sigma ? " (ignoring assignments of intermediates)" : "") << endl;
-    cout << endl;
+    out() << "    Total number of terms: " << num_terms << endl;
+    out() << "    Total terms merged: " << total_num_merged << endl;
+    out() << "    Total contractions: " << flop_map_.total() << (format_sigma ? " (ignoring assignments of intermediates)" : "") << endl;
+    out() << endl;
 
-    cout << " ===================================================="  << endl << endl;
+    out() << " ===================================================="  << endl << endl;
 
     total_timer.stop();
 }
@@ -649,7 +726,7 @@ PQGraph PQGraph::clone() const {
 
 void PQGraph::reindex() {
 
-    print_guard guard;
+    print_guard guard(*this);
     if (print_level_ <= 1)
         guard.lock();
 
@@ -767,16 +844,14 @@ void PQGraph::reindex() {
 
     // print reindexing
     if (!print_map.empty()) {
-        cout << "Reindexed temps:" << endl;
+        out() << "Reindexed temps:" << endl;
         for (auto &[id, str]: print_map) {
-            cout << "        " << str << endl;
+            out() << "        " << str << endl;
         }
     }
 
     // reindex again for good measure
-    static int reindex_count = 0;
-    reindex_count = ++reindex_count % 3;
-    if (reindex_count != 0)
+    if (++reindex_count_ % 3 != 0)
         reindex();
 }
 
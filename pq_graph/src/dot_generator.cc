@@ -209,7 +209,7 @@ vector<pair<string,VertexPtr>> sorted_temp_vertices(const LinkagePtr& link) {
 
 
 void PQGraph::write_dot(string &filepath) {
-    cout << "Writing DOT file to " << filepath << endl;
+    out() << "Writing DOT file to " << filepath << endl;
     ofstream os(filepath);
     os << "digraph G {\n";
     string padding = "    ";
@@ -252,11 +252,11 @@ void PQGraph::write_dot(string &filepath) {
     os << "}\n";
     os.close();
 
-    cout << "DOT file written successfully!" << endl;
-    cout << "Run the following command to generate the graph:" << endl;
-    cout << "       dot -Tpdf -O " << filepath << endl;
-    cout << "For a more compact graph, run the following command:" << endl;
-    cout << "       fdp -Tpdf -O " << filepath << endl;
+    out() << "DOT file written successfully!" << endl;
+    out() << "Run the following command to generate the graph:" << endl;
+    out() << "       dot -Tpdf -O " << filepath << endl;
+    out() << "For a more compact graph, run the following command:" << endl;
+    out() << "       fdp -Tpdf -O " << filepath << endl;
 }
 
 ostream &Equation::write_dot(ostream &os, size_t &term_count, size_t &dummy_count, const string &color) {
@@ -148,6 +148,7 @@ namespace pdaggerq {
     void Equation::insert(const Term& term, int index) {
         if (index < 0) index = (int)terms_.size() + index + 1; // convert negative index to positive index from end
         terms_.insert(terms_.begin() + index, term); // add term to index of terms
+        clear_index(); // positions of the terms changed
     }
 
     struct TermHash { // hash functor for finding similar terms
@@ -222,6 +223,7 @@ namespace pdaggerq {
 
 
         terms_ = new_terms;
+        clear_index(); // positions of the terms changed
         collect_scaling(true);
 
         return terms_size - terms_.size();
@@ -390,6 +392,8 @@ namespace pdaggerq {
             sort_tmp_type(terms_, "reused");
             sort_tmp_type(terms_, "temp");
         } else sort_tmp_type(terms_, type); // else rearrange by the type of temp
+
+        clear_index(); // positions of the terms changed
     }
 
 } // pdaggerq
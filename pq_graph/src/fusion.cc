@@ -492,9 +492,9 @@ struct LinkMerger {
         link_merge_map_ = new_link_merge_map;
     }
 
-    void print() {
+    void print(std::ostream &os) {
         for (auto &[target_link, merge_links]: link_merge_map_) {
-            cout << "Fusion Targets: " << endl;
+            os << "Fusion Targets: " << endl;
             Term target_as_term(as_link(target_link));
             string target_str = target_as_term.str();
             // replace all newlines with newlines and spaces
@@ -503,7 +503,7 @@ struct LinkMerger {
                 target_str.replace(pos, 1, "\n    ");
                 pos = target_str.find('\n', pos + 5);
             }
-            cout << "    " << target_str << endl;
+            os << "    " << target_str << endl;
 
             for (auto &merge_link: merge_links) {
                 Term merge_as_term(as_link(merge_link));
@@ -515,7 +515,7 @@ struct LinkMerger {
                     pos = merge_str.find('\n', pos + 5);
                 }
             }
-            cout << "Target Terms: " << endl;
+            os << "Target Terms: " << endl;
             for (auto &link_info: link_tracker_.link_track_map_[target_link]) {
                 auto &term = link_info.term;
                 string term_str = term->str();
@@ -525,7 +525,7 @@ struct LinkMerger {
                     term_str.replace(pos, 1, "\n    ");
                     pos = term_str.find('\n', pos + 5);
                 }
-                cout << "    " << term_str << endl;
+                os << "    " << term_str << endl;
             }
             for (auto &merge_link: merge_links) {
                 for (auto &link_info: link_tracker_.link_track_map_[merge_link]) {
@@ -537,10 +537,10 @@ struct LinkMerger {
                         term_str.replace(pos, 1, "\n    ");
                         pos = term_str.find('\n', pos + 5);
                     }
-                    cout << "    " << term_str << endl;
+                    os << "    " << term_str << endl;
                 }
             }
-            cout << endl;
+            os << endl;
         }
     }
 
@@ -714,7 +714,7 @@ size_t PQGraph::merge_intermediates(){
     if (opt_level_ < 6)
         return 0;
 
-    print_guard guard;
+    print_guard guard(*this);
     if (print_level_ < 2) {
         guard.lock();
     }
@@ -725,7 +725,7 @@ size_t PQGraph::merge_intermediates(){
     LinkMerger link_merger(*this);
     link_merger.populate();
     link_merger.prune();
-    link_merger.print();
+    link_merger.print(out());
     link_merger.merge();
     link_merger.clear();
 
@@ -747,7 +747,7 @@ size_t PQGraph::prune(bool keep_single_use) {
     if (opt_level_< 5)
         return 0; // do not remove unused temps if pruning is disabled
 
-    print_guard guard;
+    print_guard guard(*this);
     if (print_level_ < 2) {
         guard.lock();
     }
@@ -755,11 +755,12 @@ size_t PQGraph::prune(bool keep_single_use) {
     // remove unused contractions (only used in one term and its assignment)
 
     // get all temps in the equations
-    linkage_set all_temp_set; all_temp_set.reserve(10*(saved_linkages_["temp"].size()+1));
+    local_linkage_set all_temp_set; all_temp_set.reserve(10*(saved_linkages_["temp"].size()+1));
     for (auto & [name, eq] : equations_) {
         for (auto &term: eq.terms()) {
             vertex_vector term_temps = (term.lhs() + term.term_linkage())->get_temps();
-            all_temp_set.insert(term_temps.begin(), term_temps.end());
+            for (const auto &temp : term_temps)
+                all_temp_set.insert(as_link(temp));
         }
     }
 
@@ -778,7 +779,7 @@ size_t PQGraph::prune(bool keep_single_use) {
     // remove temps that are used in only one term or are not used at all
 
     size_t num_removed = 0;
-    linkage_set to_remove;
+    local_linkage_set to_remove;
     for (const auto & [temp, terms_pair] : matching_terms) {
 
         auto [tmp_decl_terms, terms] = terms_pair;
@@ -866,9 +867,9 @@ size_t PQGraph::prune(bool keep_single_use) {
             return make_pair(vertex, made_replacement);
         };
 
-        cout << "Removing unused temps:" << endl;
+        out() << "Removing unused temps:" << endl;
         for (auto & temp : sorted_to_remove) {
-            cout << "    " << temp->str() << endl;
+            out() << "    " << temp->str() << endl;
         }
 
         // unset the temp in saved_linkages
@@ -928,7 +929,7 @@ size_t PQGraph::prune(bool keep_single_use) {
         }
 
         // overwrite saved_linkages
-        cout << endl; // print newline after all removals
+        out() << endl; // print newline after all removals
     }
 
     if (opt_level_ >= 6) {
@@ -993,7 +994,7 @@ size_t PQGraph::merge_terms() {
     if (opt_level_< 5)
         return 0; // do not merge terms if not allowed
 
-    print_guard guard;
+    print_guard guard(*this);
     if (print_level_ < 2) {
         guard.lock();
     }
@@ -1010,7 +1011,7 @@ size_t PQGraph::merge_terms() {
     }
     collect_scaling(); // collect new scalings
 
-    if (num_merged > 0) cout << "Merged " << num_merged << " terms" << endl;
+    if (num_merged > 0) out() << "Merged " << num_merged << " terms" << endl;
 
     return num_merged;
 }
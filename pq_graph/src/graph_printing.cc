@@ -71,15 +71,15 @@ namespace pdaggerq {
 
         if (Vertex::print_type_ == "python" || Vertex::print_type_ == "einsum") {
             Vertex::print_type_ = "python";
-            cout << "Formatting equations for python" << endl;
+            out() << "Formatting equations for python" << endl;
         } else if (Vertex::print_type_ == "c++" || Vertex::print_type_ == "cpp") {
             Vertex::print_type_ = "c++";
-            cout << "Formatting equations for c++" << endl;
+            out() << "Formatting equations for c++" << endl;
         } else {
-            cout << "WARNING: output must be one of: python, einsum, c++, or cpp" << endl;
-            cout << "         Setting output to c++" << endl;
+            out() << "WARNING: output must be one of: python, einsum, c++, or cpp" << endl;
+            out() << "         Setting output to c++" << endl;
         }
-        cout << endl;
+        out() << endl;
 
         stringstream sout; // string stream to hold output
 
@@ -383,11 +383,11 @@ namespace pdaggerq {
 
         bool found_all_tmp_ids = missing_ids.empty();
         if (!found_all_tmp_ids) {
-            cout << "WARNING: could not find last use of tmps with ids: ";
+            out() << "WARNING: could not find last use of tmps with ids: ";
             for (long id : missing_ids) {
-                cout << id << " ";
+                out() << id << " ";
             }
-            cout << endl;
+            out() << endl;
         }
 
         sout << h1 << " Evaluate Equations " << h1 << endl << endl;
@@ -408,7 +408,7 @@ namespace pdaggerq {
 
     void PQGraph::print(const string &print_type) const {
         // print output to stdout
-        cout << this->str(print_type) << endl;
+        out() << this->str(print_type) << endl;
     }
 
     vector<string> PQGraph::to_strings(const string &print_type) const {
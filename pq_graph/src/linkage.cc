@@ -286,6 +286,27 @@ namespace pdaggerq {
     }
 
 
+    // mix a value into a hash
+    static inline void hash_combine(size_t &seed, size_t value) {
+        seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    }
+
+    // mix the properties compared by Line::equivalent into a hash
+    static inline void hash_lines(size_t &seed, const line_vector &lines) {
+        hash_combine(seed, lines.size());
+        for (const auto &line : lines)
+            hash_combine(seed, line.o_ | line.a_ << 1 | line.sig_ << 2 | line.den_ << 3);
+    }
+
+    // hash of a vertex that is consistent with Linkage::operator== (linkages) or Vertex::equivalent (other vertices)
+    static size_t vertex_hash(const VertexPtr &vertex) {
+        if (vertex->is_linked()) return as_link(vertex)->hash();
+
+        size_t seed = std::hash<string>()(vertex->base_name());
+        hash_lines(seed, vertex->lines());
+        return seed;
+    }
+
     void Linkage::set_properties() {
         // determine the depth of the linkage
         depth_ = 1;
@@ -331,6 +352,15 @@ namespace pdaggerq {
         has_blk_  = left_->has_blk_  || right_->has_blk_;
         is_sigma_ = left_->is_sigma_ || right_->is_sigma_ || left_->shape_.L_ > 0 || right_->shape_.L_ > 0;
         is_den_   = left_->is_den_   || right_->is_den_   || left_->shape_.Q_ > 0 || right_->shape_.Q_ > 0;
+
+        // cache the structural hash for linkage sets and maps (addition_ is left out since
+        // copy_misc() may change it after the linkage is built)
+        hash_ = depth_;
+        hash_combine(hash_, vertex_hash(left_));
+        hash_combine(hash_, vertex_hash(right_));
+        for (const auto &[leftidx, rightidx] : connec_map_)
+            hash_combine(hash_, (uint8_t) leftidx << 8 | (uint8_t) rightidx);
+        hash_lines(hash_, lines_);
     }
 
     vector<Line> Linkage::internal_lines() const {
@@ -393,6 +423,10 @@ namespace pdaggerq {
     }
     bool Linkage::operator==(const Linkage &other) const {
 
+        // linkages with different structural hashes can not be equal
+        if (hash_ != other.hash_)
+            return false;
+
         // the roots of the linkages are not equivalent
         if (!similar_root(other))
             return false;
@@ -413,6 +447,9 @@ namespace pdaggerq {
 
     bool Linkage::operator!=(const Linkage &other) const {
 
+        if (hash_ != other.hash_)
+            return true;
+
         // repeat code from == operator, but invert the logic to end recursion early if possible
         if (!similar_root(other))
             return true;
@@ -468,6 +505,7 @@ namespace pdaggerq {
 
         // copy root linkage connectivity and scales
         connec_map_ = other.connec_map_;
+        hash_       = other.hash_;
         flop_scale_ = other.flop_scale_;
         mem_scale_  = other.mem_scale_;
 
@@ -539,6 +577,7 @@ namespace pdaggerq {
 
         // move root linkage connectivity and scales
         connec_map_ = std::move(other.connec_map_);
+        hash_       = other.hash_;
         flop_scale_ = other.flop_scale_;
         mem_scale_  = other.mem_scale_;
 
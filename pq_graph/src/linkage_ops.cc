@@ -26,6 +26,8 @@
 #include <cstring>
 #include <stack>
 #include <numeric>
+#include <functional>
+#include <bitset>
 #include <cmath>
 #include "../include/linkage.h"
 #include "../include/linkage_set.hpp"
@@ -524,8 +526,9 @@ namespace pdaggerq {
         // initialize the best permutation as the current linkage
         LinkagePtr best_perm = as_link(shallow());
 
-        // generate every permutation
-        const linkage_vector &all_perms = permutations();
+        // generate the permutations with the lowest scaling (or every permutation if the search does not apply)
+        linkage_vector best_perms;
+        const linkage_vector &all_perms = optimal_permutations(best_perms) ? best_perms : permutations();
         if (all_perms.size() <= 1) {
             // if no permutations, return this as the best permutation
             return best_perm;
@@ -567,6 +570,137 @@ namespace pdaggerq {
         return best_perm;
     }
 
+    bool Linkage::optimal_permutations(linkage_vector &best_perms) const {
+
+        best_perms.clear();
+
+        // only products of vertices are reordered (see permutations())
+        if (empty() || is_temp() || is_addition() || left_->empty() || right_->empty())
+            return false;
+
+        // every ordering is tested if requested
+        if (exhaustive_ordering_) return false;
+
+        // short products are cheaper to test directly, and the tables below grow as 2^n_vert
+        const vertex_vector &link_vec = link_vector();
+        size_t n_vert = link_vec.size();
+        if (n_vert < 4 || n_vert > max_subset_vertices_) return false;
+
+        // the lines of a partial product only depend on the vertices in it if no line is shared by more than
+        // two vertices. constants are skipped in the scaling, so leave those to the full search as well
+        unordered_map<Line, size_t, LineHash> line_counts;
+        for (const auto &vertex : link_vec) {
+            if (vertex->is_constant()) return false;
+            for (const auto &line : vertex->lines()) {
+                if (++line_counts[line] > 2) return false;
+            }
+        }
+        for (const auto &vertex : link_vec) { // a line repeated within a vertex is a trace
+            unordered_set<Line, LineHash> vertex_lines(vertex->lines().begin(), vertex->lines().end());
+            if (vertex_lines.size() != vertex->lines().size()) return false;
+        }
+
+        // scaling of a sequence of contractions (flops, memory)
+        typedef pair<scaling_map, scaling_map> cost_type;
+        auto add_cost = [](const cost_type &a, const cost_type &b) {
+            return cost_type{a.first + b.first, a.second + b.second};
+        };
+        auto compare_cost = [](const cost_type &a, const cost_type &b) {
+            int comparison = a.first.compare(b.first);
+            return comparison == scaling_map::this_same ? a.second.compare(b.second) : comparison;
+        };
+
+        // product of each subset of vertices and the scaling of contracting it with each remaining vertex
+        size_t n_sets = (size_t) 1 << n_vert, full_set = n_sets - 1;
+        vector<VertexPtr> products(n_sets);
+        vector<vector<cost_type>> steps(n_sets, vector<cost_type>(n_vert));
+        for (size_t i = 0; i < n_vert; i++)
+            products[(size_t) 1 << i] = link_vec[i];
+
+        // visit subsets by increasing size, so the product of each subset is built before it is extended
+        vector<size_t> sets(n_sets);
+        std::iota(sets.begin(), sets.end(), 0);
+        std::stable_sort(sets.begin(), sets.end(), [](size_t a, size_t b) {
+            return std::bitset<64>(a).count() < std::bitset<64>(b).count();
+        });
+
+        for (size_t set : sets) {
+            if (set == 0 || set == full_set) continue;
+            for (size_t i = 0; i < n_vert; i++) {
+                size_t next_set = set | (size_t) 1 << i;
+                if (next_set == set) continue;
+
+                LinkagePtr product = as_link(products[set] * link_vec[i]);
+                steps[set][i] = {scaling_map({product->flop_scale_}), scaling_map({product->mem_scale_})};
+                if (products[next_set] == nullptr) products[next_set] = product;
+            }
+        }
+
+        // lowest scaling to complete the product from each subset
+        vector<cost_type> remaining(n_sets);
+        for (auto it = sets.rbegin(); it != sets.rend(); ++it) {
+            size_t set = *it;
+            if (set == full_set) continue;
+
+            bool found = false;
+            for (size_t i = 0; i < n_vert; i++) {
+                size_t next_set = set | (size_t) 1 << i;
+                if (next_set == set) continue;
+
+                cost_type cost = set == 0 ? remaining[next_set] : add_cost(steps[set][i], remaining[next_set]);
+                if (!found || compare_cost(cost, remaining[set]) == scaling_map::this_better) {
+                    remaining[set] = cost;
+                    found = true;
+                }
+            }
+        }
+
+        // collect the orderings with the lowest scaling in the order of std::next_permutation
+        best_perms.push_back(as_link(shallow()));
+        vector<size_t> order; order.reserve(n_vert);
+        bool found_identity = false;
+
+        std::function<void(size_t, const cost_type &)> collect = [&](size_t set, const cost_type &cost) {
+            if (set == full_set) {
+                bool is_identity = true;
+                for (size_t i = 0; i < n_vert && is_identity; i++) is_identity = order[i] == i;
+
+                // the identity is only tested as this linkage (like in permutations())
+                if (is_identity) { found_identity = true; return; }
+
+                vertex_vector link_perm(n_vert);
+                std::transform(order.begin(), order.end(), link_perm.begin(), [&link_vec](size_t i) {
+                    return link_vec[i];
+                });
+                best_perms.push_back(link(link_perm));
+                return;
+            }
+
+            for (size_t i = 0; i < n_vert; i++) {
+                size_t next_set = set | (size_t) 1 << i;
+                if (next_set == set) continue;
+
+                cost_type next_cost = set == 0 ? cost : add_cost(cost, steps[set][i]);
+                if (compare_cost(add_cost(next_cost, remaining[next_set]), remaining[0]) != scaling_map::this_same)
+                    continue;
+
+                order.push_back(i);
+                collect(next_set, next_cost);
+                order.pop_back();
+            }
+        };
+        collect(0, cost_type{});
+
+        // if the identity was the only best ordering, but this linkage is arranged differently, the best
+        // permutation is found among orderings that are not the lowest, so test all of them
+        if (found_identity && best_perms.size() == 1 && *best_perms.front() != *link(link_vec)) {
+            best_perms.clear();
+            return false;
+        }
+
+        return true;
+    }
+
     linkage_vector Linkage::subgraphs(size_t max_depth) const {
 
         if (is_temp()) { // do not generate subgraphs for temps
@@ -578,7 +712,7 @@ namespace pdaggerq {
 
         // build permutations of root vertex
         linkage_vector top_perms = {as_link(shallow())};
-        linkage_set unique_subgraphs; unique_subgraphs.reserve(4 * (depth_+1));
+        local_linkage_set unique_subgraphs; unique_subgraphs.reserve(4 * (depth_+1));
 
         // now add the subgraphs of the left and right vertices
         for (const auto &perm : top_perms) {
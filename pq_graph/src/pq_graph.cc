@@ -32,7 +32,10 @@
     #define omp_get_max_threads() 1
     #define omp_set_num_threads(n) 1
 #endif
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 
 namespace py = pybind11;
 using namespace pybind11::literals;
@@ -43,53 +46,109 @@ using std::ostream, std::string, std::vector, std::map, std::unordered_map, std:
 
 namespace pdaggerq {
 
+    // most options of a PQGraph are static members shared by every graph. the calls that write them (the
+    // constructor, set_options, and printing, which sets the print type) hold the option lock exclusively, and
+    // every other call holds it shared, so separate graphs can be optimized at the same time. calls on the same
+    // graph are serialized by the graph's own mutex. long-running calls release the GIL before locking, so
+    // pq_helper objects in other python threads keep running while a graph is optimized
+    static std::shared_mutex &option_mutex() {
+        static std::shared_mutex mutex;
+        return mutex;
+    }
+
+    template <class Call>
+    static auto run_locked(std::mutex &graph_mutex, bool sets_options, Call &&call) {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> graph_lock(graph_mutex);
+        std::shared_lock<std::shared_mutex> shared_options(option_mutex(), std::defer_lock);
+        std::unique_lock<std::shared_mutex> unique_options(option_mutex(), std::defer_lock);
+        if (sets_options) unique_options.lock();
+        else              shared_options.lock();
+        return call();
+    }
+
     void PQGraph::export_pq_graph(pybind11::module &m) {
         // add tabuilder pybind class
+        // the constructor and set_options read a python dict, so they keep the GIL while holding the locks
         py::class_<pdaggerq::PQGraph, std::shared_ptr<pdaggerq::PQGraph> >(m, "pq_graph")
-                .def(py::init<const pybind11::dict&>())
-                .def("set_options", &pdaggerq::PQGraph::set_options)
+                .def(py::init([](const pybind11::dict &options) {
+                    std::unique_lock<std::shared_mutex> option_lock(option_mutex());
+                    return std::make_shared<PQGraph>(options);
+                }))
+                .def("set_options", [](PQGraph& self, const pybind11::dict &options) {
+                    std::lock_guard<std::mutex> graph_lock(self.instance_.mutex);
+                    std::unique_lock<std::shared_mutex> option_lock(option_mutex());
+                    self.set_options(options);
+                })
                 .def("add", [](PQGraph& self, const pq_helper &pq, const std::string& equation_name, const vector<string> &label_order) {
-                    return self.add(pq, equation_name, label_order);
+                    run_locked(self.instance_.mutex, false, [&] { self.add(pq, equation_name, label_order); });
                 }, py::arg("pq") = pq_helper(), py::arg("equation_name") = "", py::arg("label_order") = vector<string>())
                 .def("print", [](PQGraph& self, const std::string &print_type) {
-                    return self.print(print_type);
+                    run_locked(self.instance_.mutex, true, [&] { self.print(print_type); });
                 }, py::arg("print_type") = "")
-                .def("__str__", [](PQGraph& self) { return self.str("python"); })
+                .def("__str__", [](PQGraph& self) {
+                    return run_locked(self.instance_.mutex, true, [&] { return self.str("python"); });
+                })
                 .def("str", [](PQGraph& self, const std::string &print_type) {
-                    return self.str(print_type);
+                    return run_locked(self.instance_.mutex, true, [&] { return self.str(print_type); });
                 }, py::arg("print_type") = "")
                 .def("to_strings", [](PQGraph& self, const std::string &print_type) {
-                    return self.to_strings(print_type);
+                    return run_locked(self.instance_.mutex, true, [&] { return self.to_strings(print_type); });
                 }, py::arg("print_type") = "")
-                .def("assemble", &pdaggerq::PQGraph::assemble)
-                .def("analysis", &pdaggerq::PQGraph::analysis)
-                .def("clear", &pdaggerq::PQGraph::clear)
-                .def("write_dot", &pdaggerq::PQGraph::write_dot)
+                .def("assemble", [](PQGraph& self) {
+                    run_locked(self.instance_.mutex, false, [&] { self.assemble(); });
+                })
+                .def("analysis", [](PQGraph& self) {
+                    run_locked(self.instance_.mutex, false, [&] { self.analysis(); });
+                })
+                .def("clear", [](PQGraph& self) {
+                    run_locked(self.instance_.mutex, false, [&] { self.clear(); });
+                })
+                .def("write_dot", [](PQGraph& self, string &filepath) {
+                    run_locked(self.instance_.mutex, false, [&] { self.write_dot(filepath); });
+                })
                 .def("reorder", [](PQGraph& self) {
-                    bool old_opt_level = self.opt_level_; self.opt_level_ = 1;
-                    self.reorder();                       self.opt_level_ = old_opt_level;
+                    run_locked(self.instance_.mutex, false, [&] {
+                        bool old_opt_level = self.opt_level_; self.opt_level_ = 1;
+                        self.reorder();                       self.opt_level_ = old_opt_level;
+                    });
                 })
                 .def("substitute", [](PQGraph& self, bool separate_sigma) {
-                    bool old_opt_level = self.opt_level_; self.opt_level_ = separate_sigma ? 3 : 2;
-                    self.substitute(separate_sigma, true);
-                    if (separate_sigma)
-                        self.substitute(true, false);
-                    self.substitute(false, false);
-                    self.opt_level_ = old_opt_level;
+                    run_locked(self.instance_.mutex, false, [&] {
+                        bool old_opt_level = self.opt_level_; self.opt_level_ = separate_sigma ? 3 : 2;
+                        self.substitute(separate_sigma, true);
+                        if (separate_sigma)
+                            self.substitute(true, false);
+                        self.substitute(false, false);
+                        self.opt_level_ = old_opt_level;
+                    });
                 }, py::arg("separate_sigma") = false)
                 .def("prune", [](PQGraph& self) {
-                    bool old_opt_level = self.opt_level_; self.opt_level_ = 4;
-                    self.prune(false);                   self.opt_level_ = old_opt_level;
+                    run_locked(self.instance_.mutex, false, [&] {
+                        bool old_opt_level = self.opt_level_; self.opt_level_ = 4;
+                        self.prune(false);                   self.opt_level_ = old_opt_level;
+                    });
                 })
                 .def("merge", [](PQGraph& self) {
-                    bool old_opt_level = self.opt_level_; self.opt_level_ = 5;
-                    self.merge_terms();                   self.opt_level_ = old_opt_level;
+                    run_locked(self.instance_.mutex, false, [&] {
+                        bool old_opt_level = self.opt_level_; self.opt_level_ = 5;
+                        self.merge_terms();                   self.opt_level_ = old_opt_level;
+                    });
                 })
                 .def("fusion", [](PQGraph& self) {
-                    bool old_opt_level = self.opt_level_; self.opt_level_ = 6;
-                    self.merge_intermediates();           self.opt_level_ = old_opt_level;
+                    run_locked(self.instance_.mutex, false, [&] {
+                        bool old_opt_level = self.opt_level_; self.opt_level_ = 6;
+                        self.merge_intermediates();           self.opt_level_ = old_opt_level;
+                    });
                 })
-                .def("optimize", &pdaggerq::PQGraph::optimize);
+                .def("optimize", [](PQGraph& self) {
+                    run_locked(self.instance_.mutex, false, [&] { self.optimize(); });
+                });
+    }
+
+    std::ostream &PQGraph::out() const {
+        static thread_local std::ostream null_out(nullptr); // has no buffer, so everything written to it is dropped
+        return instance_.quiet > 0 ? null_out : cout;
     }
 
     void PQGraph::set_options(const pybind11::dict& options) {
@@ -102,7 +161,7 @@ namespace pdaggerq {
             h2 = "/////";
         } else throw invalid_argument("Invalid print type: " + Vertex::print_type_);
 
-        cout << endl << h1 << " PQ GRAPH " << h1 << endl << endl;
+        out() << endl << h1 << " PQ GRAPH " << h1 << endl << endl;
 
         if (options.contains("print_level")) {
             print_level_ = options["print_level"].cast<int>();
@@ -129,7 +188,7 @@ namespace pdaggerq {
         if( options.contains("max_depth")) {
                 Term::max_depth_ = (size_t) options["max_depth"].cast<long>();
                 if (Term::max_depth_ < 1ul) {
-                    cout << "WARNING: max_depth must be greater than 1. Setting to 2." << endl;
+                    out() << "WARNING: max_depth must be greater than 1. Setting to 2." << endl;
                     Term::max_depth_ = 2ul;
                 }
         }
@@ -143,7 +202,7 @@ namespace pdaggerq {
         if (options.contains("no_scalars")) {
             Equation::no_scalars_ = options["no_scalars"].cast<bool>();
             if (Equation::no_scalars_)
-                cout << "'no_scalars' is set to true. Scalars will not be included in the final equations." << endl;
+                out() << "'no_scalars' is set to true. Scalars will not be included in the final equations." << endl;
         }
 
 
@@ -192,13 +251,17 @@ namespace pdaggerq {
             Linkage::low_memory_ = options["low_memory"].cast<bool>();
         }
 
+        if (options.contains("exhaustive_ordering")) {
+            Linkage::exhaustive_ordering_ = options["exhaustive_ordering"].cast<bool>();
+        }
+
         if (options.contains("batch_size")) {
             batch_size_ = static_cast<size_t>(options["batch_size"].cast<long>());
             if (batch_size_ < 1ul) {
-                cout << "WARNING: batch_size must be greater than 1. Setting to 100." << endl;
+                out() << "WARNING: batch_size must be greater than 1. Setting to 100." << endl;
                 batch_size_ = 100ul;
             } else if (batch_size_ == 1ul) {
-                cout << "WARNING: batch_size of 1 is equivalent to no batching." << endl;
+                out() << "WARNING: batch_size of 1 is equivalent to no batching." << endl;
             }
 
         }
@@ -221,7 +284,7 @@ namespace pdaggerq {
         if (options.contains("nthreads")) {
             nthreads_ = options["nthreads"].cast<int>();
             if (nthreads_ > omp_get_max_threads()) {
-                cout << "Warning: number of threads is larger than the maximum number of threads on this machine. "
+                out() << "Warning: number of threads is larger than the maximum number of threads on this machine. "
                         "Using the maximum number of threads instead." << endl;
                 nthreads_ = (int) omp_get_max_threads();
             } else if (nthreads_ < 0) {
@@ -236,7 +299,7 @@ namespace pdaggerq {
             if (omp_num_threads != nullptr) {
                 nthreads_ = std::stoi(omp_num_threads);
                 if (nthreads_ > omp_get_max_threads()) {
-                    cout << "Warning: OMP_NUM_THREADS is larger than the maximum number of threads on this machine. "
+                    out() << "Warning: OMP_NUM_THREADS is larger than the maximum number of threads on this machine. "
                             "Using the maximum number of threads instead." << endl;
                     nthreads_ = (int) omp_get_max_threads();
                 }
@@ -265,17 +328,17 @@ namespace pdaggerq {
             for (const auto &[condition, restrict_ops] : conditions) {
                 Term::mapped_conditions_[condition] = restrict_ops;
             }
-            cout << "Defined conditions: ";
+            out() << "Defined conditions: ";
             for (const auto &[condition, restrict_ops] : Term::mapped_conditions_) {
-                cout << condition << " -> [";
+                out() << condition << " -> [";
                 for (const auto &op : restrict_ops) {
-                    cout << op;
+                    out() << op;
                     if (op != restrict_ops.back())
-                        cout << ", ";
+                        out() << ", ";
                 }
-                cout << "]\n";
+                out() << "]\n";
             }
-            cout << endl;
+            out() << endl;
         }
 
         if (options.contains("use_trial_index"))
@@ -284,60 +347,64 @@ namespace pdaggerq {
         if (options.contains("separate_sigma"))
             separate_sigma_ = options["separate_sigma"].cast<bool>();
 
-        cout << "Options:" << endl;
-        cout << "--------" << endl;
-        cout << "    print_level: " << print_level_
+        out() << "Options:" << endl;
+        out() << "--------" << endl;
+        out() << "    print_level: " << print_level_
              << "  // verbosity level:" << endl;
-        cout << "                    // 0: no printing of optimization steps (default)" << endl;
-        cout << "                    // 1: print optimization steps without fusion or merging" << endl;
-        cout << "                    // 2: print optimization steps with fusion and merging" << endl;
+        out() << "                    // 0: no printing of optimization steps (default)" << endl;
+        out() << "                    // 1: print optimization steps without fusion or merging" << endl;
+        out() << "                    // 2: print optimization steps with fusion and merging" << endl;
 
-        cout << "    permute_eri: " << (Vertex::permute_eri_ ? "true" : "false")
+        out() << "    permute_eri: " << (Vertex::permute_eri_ ? "true" : "false")
              << "  // whether to permute two-electron integrals to common order (default: true)" << endl;
 
-        cout << "    no_scalars: " << (Equation::no_scalars_ ? "true" : "false")
+        out() << "    no_scalars: " << (Equation::no_scalars_ ? "true" : "false")
              << "  // whether to skip the scalar terms in the final equations (default: false)" << endl;
 
-        cout << "    use_trial_index: " << (Vertex::use_trial_index ? "true" : "false")
+        out() << "    use_trial_index: " << (Vertex::use_trial_index ? "true" : "false")
              << "  // whether to store trial vectors as an additional index/dimension for "
              << "tensors in a sigma-vector build (default: false)" << endl;
-        cout << "    separate_sigma: " << (separate_sigma_ ? "true" : "false")
+        out() << "    separate_sigma: " << (separate_sigma_ ? "true" : "false")
                 << "  // whether to separate reusable intermediates for sigma-vector build (default: false)" << endl;
-        cout << "    opt_level: " << opt_level_
+        out() << "    opt_level: " << opt_level_
              << "  // optimization level:" << endl;
-        cout << "                  // 0: no optimization" << endl;
-        cout << "                  // 1: single-term optimization only (reordering)" << endl;
-        cout << "                  // 2: reordering and subexpression elimination (substitution)" << endl;
-        cout << "                  // 3: reordering, substitution, and separation of reusable intermediates (for sigma vectors)" << endl;
-        cout << "                  // 4: reordering, substitution, and separation; unused intermediates are removed (pruning)" << endl;
-        cout << "                  // 5: reordering, substitution, separation, pruning, and merging of equivalent terms" << endl;
-        cout << "                  // 6: reordering, substitution, separation, pruning, merging, and fusion of intermediates (default)" << endl;
-
-        cout << "    batched: " << (batched_ ? "true" : "false")
+        out() << "                  // 0: no optimization" << endl;
+        out() << "                  // 1: single-term optimization only (reordering)" << endl;
+        out() << "                  // 2: reordering and subexpression elimination (substitution)" << endl;
+        out() << "                  // 3: reordering, substitution, and separation of reusable intermediates (for sigma vectors)" << endl;
+        out() << "                  // 4: reordering, substitution, and separation; unused intermediates are removed (pruning)" << endl;
+        out() << "                  // 5: reordering, substitution, separation, pruning, and merging of equivalent terms" << endl;
+        out() << "                  // 6: reordering, substitution, separation, pruning, merging, and fusion of intermediates (default)" << endl;
+
+        out() << "    batched: " << (batched_ ? "true" : "false")
              << "  // candidate substitutions are applied in batches rather than one at a time. (default: false)" << endl;
-        cout << "                   // Generally faster, but may not yield optimal results compared to single substitutions." << endl;
+        out() << "                   // Generally faster, but may not yield optimal results compared to single substitutions." << endl;
 
-        cout << "    batch_size: " << (long) batch_size_
+        out() << "    batch_size: " << (long) batch_size_
              << "  // size of the batch for batched substitution (default: 10; -1 for no limit)" << endl;
 
-        cout << "    max_temps: " << (long) max_temps_
+        out() << "    max_temps: " << (long) max_temps_
              << "  // maximum number of intermediates to find (default: -1 for no limit)" << endl;
 
-        cout << "    max_depth: " << (long) Term::max_depth_
+        out() << "    max_depth: " << (long) Term::max_depth_
              << "  // maximum depth for chain of contractions (default: -1 for no limit)" << endl;
 
-        cout << "    max_shape: " << Term::max_shape_.str() << " // a map of maximum sizes for each line type in an intermediate (default: {o: 255, v: 255}, "
+        out() << "    max_shape: " << Term::max_shape_.str() << " // a map of maximum sizes for each line type in an intermediate (default: {o: 255, v: 255}, "
                                                                "for no limit.): " << endl;
 
-        cout << "    low_memory: " << (Linkage::low_memory_ ? "true" : "false")
+        out() << "    low_memory: " << (Linkage::low_memory_ ? "true" : "false")
              << "  // whether to recompute or save all possible permutations of each term in memory (default: false)" << endl
              << "                       // if true, permutations are recomputed on the fly. Recommended if memory runs out." << endl;
 
-        cout << "    nthreads: " << nthreads_
+        out() << "    exhaustive_ordering: " << (Linkage::exhaustive_ordering_ ? "true" : "false")
+             << "  // whether to test every ordering of the contractions in a term (default: false)" << endl
+             << "                                // if false, the lowest scaling orderings are found by searching subsets of the tensors." << endl;
+
+        out() << "    nthreads: " << nthreads_
              << "  // number of threads to use (default: OMP_NUM_THREADS | available: "
              << omp_get_max_threads() << ")" << endl;
 
-        cout << endl;
+        out() << endl;
     }
 
     void PQGraph::add(const pq_helper& pq, const std::string &equation_name, vector<std::string> label_order) {
@@ -348,17 +415,17 @@ namespace pdaggerq {
         // check if equation already exists; if so, print warning
         bool equation_exists = equations_.find(equation_name) != equations_.end();
         if (equation_exists) {
-            cout << "WARNING: equation '" << equation_name << "' already exists. "
+            out() << "WARNING: equation '" << equation_name << "' already exists. "
                      "The terms will be merged with the existing equation." << endl;
         }
 
         // print that custom label order is being used
         if (!label_order.empty()) {
-            cout << "Using custom label order: ";
+            out() << "Using custom label order: ";
             for (const auto &label : label_order) {
-                cout << label << " ";
+                out() << label << " ";
             }
-            cout << endl;
+            out() << endl;
         }
 
         if (equations_.empty()) {
@@ -381,10 +448,12 @@ namespace pdaggerq {
         vector<Term> terms;
 
         // get strings
-        bool has_blocks = pq_string::is_spin_blocked || pq_string::is_range_blocked;
+        bool is_spin_blocked = pq.is_blocked_by_spin();
+        bool is_range_blocked = pq.is_blocked_by_range();
+        bool has_blocks = is_spin_blocked || is_range_blocked;
         const std::vector<std::shared_ptr<pq_string>> &ordered = pq.get_ordered_strings(has_blocks);
         if (ordered.empty()){
-            cout << "WARNING: no pq_strings found in pq_helper. Skipping equation '" << equation_name << "'." << endl;
+            out() << "WARNING: no pq_strings found in pq_helper. Skipping equation '" << equation_name << "'." << endl;
             return;
         }
 
@@ -445,10 +514,10 @@ namespace pdaggerq {
             Term term;
             if (name_is_formatted) {
                 // create term from string
-                term = Term(equation_name, pq_string);
+                term = Term(equation_name, pq_string, is_spin_blocked, is_range_blocked);
             } else {
                 // create term with an empty string
-                term = Term("", pq_string);
+                term = Term("", pq_string, is_spin_blocked, is_range_blocked);
             }
 
             // format self-contractions
@@ -570,9 +639,9 @@ namespace pdaggerq {
         total_timer.start(); // start timer
         reorder_timer.start(); // start timer
 
-        static bool print_reordering = print_level_ >= 1; // flag to check if first reordering is printed
+        static std::atomic<bool> print_reordering = print_level_ >= 1; // flag to check if first reordering is printed
 
-        print_guard guard;
+        print_guard guard(*this);
         if (!print_reordering) {
             guard.lock();
         }
@@ -583,7 +652,7 @@ namespace pdaggerq {
             mem_map_init_ = mem_map_;
         }
 
-        cout << "Reordering equations..." << flush;
+        out() << "Reordering equations..." << flush;
 
         // get address of every term
         vector<Term *> terms = every_term();
@@ -592,15 +661,15 @@ namespace pdaggerq {
             term->reorder(regenerate); // reorder terms in equation
         }
 
-        cout << " Done" << endl << endl;
+        out() << " Done" << endl << endl;
 
         // collect scaling
-        cout << "Collecting scalings of each equation...";
+        out() << "Collecting scalings of each equation...";
         collect_scaling(true); // collect scaling of equations
-        cout << " Done" << endl;
+        out() << " Done" << endl;
 
         reorder_timer.stop();
-        cout << "Reordering time: " << reorder_timer.elapsed() << endl << endl;
+        out() << "Reordering time: " << reorder_timer.elapsed() << endl << endl;
 
         // set reorder flags to true
         print_reordering = true;
@@ -624,11 +693,11 @@ namespace pdaggerq {
             h2 = "/////";
         } else throw invalid_argument("Invalid print type: " + Vertex::print_type_);
 
-        cout << h1 << " PQ GRAPH Analysis " << h1 << endl << endl;
+        out() << h1 << " PQ GRAPH Analysis " << h1 << endl << endl;
 
         // print total time elapsed
         long double total_time = total_timer.get_runtime();
-        cout << "Net time: " << Timer::format_time(total_time) << endl << endl;
+        out() << "Net time: " << Timer::format_time(total_time) << endl << endl;
 
         // get total number of linkages
         size_t n_flop_ops = flop_map_.total();
@@ -636,25 +705,28 @@ namespace pdaggerq {
 
         size_t number_of_terms = get_num_terms();
 
-        cout << "Total Number of Terms: " << number_of_terms;
+        out() << "Total Number of Terms: " << number_of_terms;
         if (number_of_terms != num_terms_init_)
-            cout << " (initial: " << num_terms_init_ << ")";
-        cout << endl;
-        cout << "Total Contractions: (last) " << n_flop_ops_pre << " -> (new) " << n_flop_ops << endl << endl;
-        cout << "Total FLOP scaling: " << endl;
-        cout << "------------------" << endl;
+            out() << " (initial: " << num_terms_init_ << ")";
+        out() << endl;
+        out() << "Total Contractions: (last) " << n_flop_ops_pre << " -> (new) " << n_flop_ops << endl << endl;
+        out() << "Total FLOP scaling: " << endl;
+        out() << "------------------" << endl;
         print_new_scaling(flop_map_init_, flop_map_pre_, is_optimized_ ? flop_map_ : flop_map_pre_);
 
-        cout << endl << "Total MEM scaling: " << endl;
-        cout << "------------------" << endl;
+        out() << endl << "Total MEM scaling: " << endl;
+        out() << "------------------" << endl;
 
         print_new_scaling(mem_map_init_, mem_map_pre_, is_optimized_ ? mem_map_ : mem_map_pre_);
-        cout << endl << endl;
-        cout << h1 << h1 << h1 << endl << endl;
+        out() << endl << endl;
+        out() << h1 << h1 << h1 << endl << endl;
 
     }
 
-    void PQGraph::print_new_scaling(const scaling_map &original_map, const scaling_map &previous_map, const scaling_map &current_map) {
+    void PQGraph::print_new_scaling(const scaling_map &original_map, const scaling_map &previous_map, const scaling_map &current_map) const {
+        if (instance_.quiet > 0)
+            return; // printf does not go through out()
+
         printf("%8s : %5s | %5s | %5s || %5s | %5s\n", "Scaling", "  I  ", "  R  ", "  F  ", " F-I ", " F-R ");
 
         // merge spins within the scaling maps
@@ -700,11 +772,11 @@ namespace pdaggerq {
     void PQGraph::optimize() {
 
         if (is_optimized_) {
-            cout << "Equations have already been optimized." << endl;
+            out() << "Equations have already been optimized." << endl;
             return;
         }
 
-        print_guard guard;
+        print_guard guard(*this);
         if (print_level_ < 1) {
             guard.lock();
         }
@@ -734,7 +806,7 @@ namespace pdaggerq {
 
         // substitute scalars first
         if (opt_level_ >= 1) {
-            cout << "----- Substituting scalars -----" << endl;
+            out() << "----- Substituting scalars -----" << endl;
             substitute(false, true);
         }
 
@@ -742,14 +814,14 @@ namespace pdaggerq {
 
             // find and substitute intermediate contractions
             if (separate_sigma_)
-                cout << "----- Separating Intermediates for sigma-vector build -----" << endl;
-            else cout << "----- Substituting intermediates -----" << endl;
+                out() << "----- Separating Intermediates for sigma-vector build -----" << endl;
+            else out() << "----- Substituting intermediates -----" << endl;
 
             substitute(separate_sigma_, false);
 
             if (separate_sigma_) {
                 // apply substitutions again without separating intermediates
-                cout << "----- Substituting all intermediates -----" << endl;
+                out() << "----- Substituting all intermediates -----" << endl;
                 substitute(false, false);
             }
         }
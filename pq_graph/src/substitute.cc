@@ -42,11 +42,11 @@ using std::max;
 
 using namespace pdaggerq;
 
-linkage_set Equation::make_all_links(bool compute_all) {
+linkage_set Equation::make_all_links(bool compute_all, size_t max_depth) {
 
     linkage_set all_linkages(2048); // all possible linkages in the equations (start with large bucket n_ops)
 
-#pragma omp parallel for schedule(guided) shared(terms_, all_linkages) default(none) firstprivate(compute_all)
+#pragma omp parallel for schedule(guided) shared(terms_, all_linkages) default(none) firstprivate(compute_all, max_depth)
     for (auto & term : terms_) { // iterate over terms
 
         // skip term if it is optimal, and we are not computing all linkages
@@ -54,7 +54,7 @@ linkage_set Equation::make_all_links(bool compute_all) {
             continue;
 
         term.reorder(); // reorder term (only if necessary)
-        all_linkages += term.make_all_links(); // nerate linkages in term and add to the set of all linkages
+        all_linkages += term.make_all_links(max_depth); // nerate linkages in term and add to the set of all linkages
 
         term.generated_linkages_ = true; // set term to have generated linkages
 
@@ -63,18 +63,18 @@ linkage_set Equation::make_all_links(bool compute_all) {
     return all_linkages;
 }
 
-linkage_set Term::make_all_links() const {
+local_linkage_set Term::make_all_links(size_t max_depth) const {
 
     if (rhs_.empty())
         return {}; // if constant, return an empty set of linkages
 
-    // initialize vector of linkages
-    linkage_set linkages;
+    // initialize set of linkages
+    local_linkage_set linkages;
 
     if (term_linkage()->is_temp()) return {}; // the term_linkage is already a temp, no need to test it.
 
     // generate all subgraphs of the term
-    auto subgraphs = term_linkage()->subgraphs(Term::max_depth_);
+    auto subgraphs = term_linkage()->subgraphs(max_depth);
 
     // insert all subgraphs of a given deoth into the set of linkages
     for (const auto &subgraph : subgraphs) {
@@ -94,7 +94,7 @@ linkage_set Term::make_all_links() const {
     return linkages;
 }
 
-size_t Equation::substitute(const LinkagePtr &linkage, bool allow_equality) {
+size_t Equation::substitute(const LinkagePtr &linkage, bool allow_equality, std::set<string> *modified_names) {
 
     /// iterate over terms and substitute
     size_t num_terms = terms_.size();
@@ -103,13 +103,21 @@ size_t Equation::substitute(const LinkagePtr &linkage, bool allow_equality) {
     // scaling of the linkage cannot be more than the equation
     if (linkage->netscales().first > flop_map()) return 0;
 
-    #pragma omp parallel for schedule(guided) shared(terms_, linkage) firstprivate(num_terms, allow_equality) \
+    vector<char> modified(num_terms, false); // which terms were changed
+
+    // only test the terms that hold every vertex of the linkage (the index is rebuilt only if it is out of date)
+    index_terms();
+    vector<size_t> term_ids = indexed_terms(linkage);
+    size_t num_ids = term_ids.size();
+
+    #pragma omp parallel for schedule(guided) shared(terms_, linkage, modified, term_ids) firstprivate(num_ids, allow_equality) \
                              reduction(+:num_subs) default(none)
-    for (int i = 0; i < num_terms; i++) {
+    for (int k = 0; k < num_ids; k++) {
+        size_t i = term_ids[k];
         Term &term = terms_[i]; // get term
 
         // check if linkage is compatible with term
-        if (!term.is_compatible(linkage)) continue; // skip term if linkage is not compatible
+        if (!term.is_compatible(linkage, false)) continue; // skip term if linkage is not compatible
 
         /// substitute linkage in term
         bool madeSub;
@@ -119,9 +127,20 @@ size_t Equation::substitute(const LinkagePtr &linkage, bool allow_equality) {
         if (madeSub) {
             ++num_subs;
             term.request_update(); // set term to be updated
+            modified[i] = true;
         }
     } // substitute linkage in term
 
+    if (num_subs > 0) clear_index(); // the modified terms hold other vertices now
+
+    if (modified_names) {
+        for (size_t i = 0; i < num_terms; i++) {
+            if (!modified[i]) continue;
+            for (const auto &vertex : terms_[i].term_linkage()->link_vector())
+                modified_names->insert(vertex->name_);
+        }
+    }
+
     return num_subs;
 }
 
@@ -130,13 +149,17 @@ size_t Equation::test_substitute(const MutableLinkagePtr &linkage, scaling_map &
     // scaling of the linkage cannot be more than the equation
     if (linkage->netscales().first > flop_map()) return 0;
 
-    /// iterate over terms and substitute
-    size_t num_terms = terms_.size();
-    size_t num_subs = 0; // number of substitutions
     test_flop_map += flop_map_; // test memory scaling map
-    for (int i = 0; i < num_terms; i++) {
+    return test_substitute_terms(linkage, test_flop_map);
+}
+
+size_t Equation::test_substitute_terms(const MutableLinkagePtr &linkage, scaling_map &delta_flop_map) const {
+
+    /// iterate over the terms that hold every vertex of the linkage and substitute
+    size_t num_subs = 0; // number of substitutions
+    for (size_t i : indexed_terms(linkage)) {
         // skip term if linkage is not compatible
-        if (!terms_[i].is_compatible(linkage)) continue;
+        if (!terms_[i].is_compatible(linkage, false)) continue;
 
         // get term copy
         Term term = terms_[i];
@@ -144,12 +167,12 @@ size_t Equation::test_substitute(const MutableLinkagePtr &linkage, scaling_map &
 
         // It's faster to subtract the old scaling and add the new scaling than
         // to recompute the scaling map from scratch
-        test_flop_map -= term.flop_map(); // subtract flop scaling map for term
+        delta_flop_map -= term.flop_map(); // subtract flop scaling map for term
 
         // substitute linkage in term copy
         bool madeSub = term.substitute(linkage);
         term.term_linkage()->forget(); // clear the linkage history for lazy evaluation
-        test_flop_map += term.flop_map(); // add new flop scaling map for term
+        delta_flop_map += term.flop_map(); // add new flop scaling map for term
 
         // increment number of substitutions if substitution was successful
         if (madeSub) ++num_subs; // increment number of substitutions
@@ -159,7 +182,74 @@ size_t Equation::test_substitute(const MutableLinkagePtr &linkage, scaling_map &
     return num_subs;
 }
 
-bool Term::is_compatible(const LinkagePtr &linkage) const {
+void Equation::index_terms() {
+
+    if (is_indexed_ && indexed_version_ == terms_version_) return; // the index is still valid
+
+    term_index_.clear();
+    for (size_t i = 0; i < terms_.size(); i++) {
+        const Term &term = terms_[i];
+        if (term.rhs().empty()) continue; // constants are never compatible
+
+        // count each vertex name of the term (without expanding nested linkages)
+        map<string, size_t> name_counts;
+        for (const auto &vertex : term.term_linkage()->link_vector())
+            ++name_counts[vertex->name_];
+
+        for (const auto &[name, count] : name_counts)
+            term_index_[name].emplace_back(i, count);
+    }
+
+    indexed_version_ = terms_version_;
+    is_indexed_ = true;
+}
+
+vector<size_t> Equation::indexed_terms(const LinkagePtr &linkage) const {
+
+    vector<size_t> term_ids;
+
+    // fall back to every term if the index is missing or out of date
+    if (!is_indexed_ || indexed_version_ != terms_version_) {
+        term_ids.resize(terms_.size());
+        for (size_t i = 0; i < terms_.size(); i++) term_ids[i] = i;
+        return term_ids;
+    }
+
+    // count each vertex name of the linkage and find the terms that hold it
+    map<string, size_t> name_counts;
+    for (const auto &vertex : linkage->link_vector())
+        ++name_counts[vertex->name_];
+
+    vector<pair<const vector<pair<size_t, size_t>> *, size_t>> postings;
+    for (const auto &[name, count] : name_counts) {
+        auto it = term_index_.find(name);
+        if (it == term_index_.end()) return term_ids; // no term holds this vertex
+        postings.emplace_back(&it->second, count);
+    }
+
+    // walk the shortest list and look up the term in the others (each list is sorted by term position)
+    std::sort(postings.begin(), postings.end(), [](const auto &a, const auto &b) {
+        return a.first->size() < b.first->size();
+    });
+
+    for (const auto &[term_id, term_count] : *postings.front().first) {
+        if (term_count < postings.front().second) continue;
+
+        bool holds_all = true;
+        for (size_t k = 1; k < postings.size() && holds_all; k++) {
+            const auto &[list, count] = postings[k];
+            auto found = std::lower_bound(list->begin(), list->end(), term_id, [](const pair<size_t, size_t> &entry, size_t id) {
+                return entry.first < id;
+            });
+            holds_all = found != list->end() && found->first == term_id && found->second >= count;
+        }
+        if (holds_all) term_ids.push_back(term_id);
+    }
+
+    return term_ids;
+}
+
+bool Term::is_compatible(const LinkagePtr &linkage, bool check_vertices) const {
 
     // if no possible linkages, return false
     if (rhs_.empty()) return false;
@@ -178,6 +268,9 @@ bool Term::is_compatible(const LinkagePtr &linkage) const {
     // scaling of the linkage cannot be more than the term
     if (linkage->netscales().first > flop_map()) return false;
 
+    // the vertices were already matched
+    if (!check_vertices) return true;
+
     // get total vector of linkage vertices (without expanding nested linkages)
     vertex_vector link_list = linkage->link_vector();
     vertex_vector term_list = term_linkage()->link_vector();
@@ -254,10 +347,10 @@ bool Term::substitute(const LinkagePtr &linkage) {
 
 void PQGraph::make_scalars() {
 
-    cout << "Finding scalars..." << flush;
+    out() << "Finding scalars..." << flush;
     if ( opt_level_ >= 2 ) {
         // use substitution to find scalars
-        print_guard guard; guard.lock();
+        print_guard guard(*this); guard.lock();
         substitute(false, true);
     }
 
@@ -267,7 +360,7 @@ void PQGraph::make_scalars() {
         if (name == "scalar") continue;
         eq.make_scalars(saved_linkages_["scalar"], temp_counts_["scalar"]);
     }
-    cout << " Done" << endl;
+    out() << " Done" << endl;
 
     // create new equation for scalars if it does not exist
     if (equations_.find("scalar") == equations_.end()) {
@@ -296,14 +389,14 @@ void PQGraph::make_scalars() {
             add_tmp(scalar, equations_["scalar"]);
 
         // print scalar
-        cout << scalar->str() << " = " << *scalar << endl;
+        out() << scalar->str() << " = " << *scalar << endl;
     }
 
     // remove comments from scalars
     for (Term &term: equations_["scalar"].terms())
         term.comments() = {}; // comments should be self-explanatory
 
-    cout << endl;
+    out() << endl;
 
     // collect scaling
     collect_scaling(true);
@@ -311,7 +404,7 @@ void PQGraph::make_scalars() {
 }
 
 void PQGraph::remove_scalars() {
-    cout << "Removing scalars from equations..." << endl;
+    out() << "Removing scalars from equations..." << endl;
 
     // remove scalar equation
     equations_.erase("scalar");
@@ -339,7 +432,7 @@ void PQGraph::remove_scalars() {
 
     // remove equations
     for (const auto &name: to_remove) {
-        cout << "Removing equation: " << name << " (no terms left after removing scalars)" << endl;
+        out() << "Removing equation: " << name << " (no terms left after removing scalars)" << endl;
         equations_.erase(name);
     }
 }
@@ -358,6 +451,8 @@ void Equation::make_scalars(linkage_set &scalars, long &n_temps) {
 
         } // eventually no more scalars will be made
     }
+
+    clear_index(); // the terms may hold scalars now
 }
 
 bool Term::make_scalars(linkage_set &scalars, long &id) {
@@ -369,7 +464,7 @@ bool Term::make_scalars(linkage_set &scalars, long &id) {
     bool made_scalar = false; // initialize boolean to track if substitution was made
 
     const linkage_vector &graph_perms = term_linkage()->permutations();
-    linkage_map<linkage_set> term_scalars;
+    linkage_map<local_linkage_set> term_scalars;
     for (const auto &graph_perm : graph_perms) {
         const auto perm_scalars = graph_perm->find_scalars();
         auto &perm_entry = term_scalars[graph_perm];
@@ -377,7 +472,7 @@ bool Term::make_scalars(linkage_set &scalars, long &id) {
             if (!scalar->is_scalar()) continue; // skip if scalar is not actually a scalar (should not happen)
             if (scalar->is_temp()) continue;    // skip if scalar is already a temp
             if (!scalar->is_linked()) continue; // skip if scalar is not linked
-            perm_entry.insert(scalar);
+            perm_entry.insert(as_link(scalar));
         }
     }
     if (term_scalars.empty()) return false; // do nothing if no scalars are found
@@ -394,9 +489,9 @@ bool Term::make_scalars(linkage_set &scalars, long &id) {
             #pragma omp critical
             {
                 long new_id = id + 1;
-                auto scalar_pos = scalars.find(new_scalar);
-                if (scalar_pos != scalars.end())
-                    new_id = scalar_pos->get()->id(); // if scalar is already in set of scalars, change the id
+                LinkagePtr found_scalar = scalars.find(new_scalar);
+                if (found_scalar)
+                    new_id = found_scalar->id(); // if scalar is already in set of scalars, change the id
                 else ++id; // if scalar is not in set of scalars, increment the id for the next scalar
 
                 new_scalar->id_ = new_id;
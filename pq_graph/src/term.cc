@@ -43,7 +43,7 @@ using std::max;
 
 namespace pdaggerq {
 
-    Term::Term(const string &name, const shared_ptr<pq_string>& pq_str) {
+    Term::Term(const string &name, const shared_ptr<pq_string>& pq_str, bool is_spin_blocked, bool is_range_blocked) {
 
         // check if term should be skipped (this should already be done before the term is constructed)
         if ( pq_str->skip ) return;
@@ -85,7 +85,7 @@ namespace pdaggerq {
 
         // add fermion operators
         for (size_t i = 0; i < pq_str->symbol.size(); i++) {
-            string tmp = pq_str->symbol[i];
+            string tmp = label_name(pq_str->symbol[i]);
             if ( pq_str->is_dagger[i] )
                 tmp += "*";
             rhs_.emplace_back(make_shared<Vertex>(tmp));
@@ -106,10 +106,10 @@ namespace pdaggerq {
 
         // create rhs vertices
         for (const auto & delta : pq_str->deltas) // add delta functions
-            rhs_.push_back(make_shared<Vertex>(delta));
+            rhs_.push_back(make_shared<Vertex>(delta, is_spin_blocked, is_range_blocked));
         for (const auto & [type, integrals] : pq_str->ints) { // add integrals
             for (auto & integral : integrals) {
-                MutableVertexPtr int_vert = make_shared<Vertex>(integral, type);
+                MutableVertexPtr int_vert = make_shared<Vertex>(integral, type, is_spin_blocked, is_range_blocked);
                 if (type == "eri") { // permute eri to proper form
                     // swap sign if eri is permuted with sign change
                     if (int_vert->permute_eri())
@@ -120,7 +120,7 @@ namespace pdaggerq {
         }
         for (const auto & [type, amp_vec] : pq_str->amps) { // add amplitudes
             for (auto & amp : amp_vec)
-                rhs_.push_back(make_shared<Vertex>(amp, type));
+                rhs_.push_back(make_shared<Vertex>(amp, type, is_spin_blocked, is_range_blocked));
         }
 
         // compute flop and memory scaling of the term
@@ -131,7 +131,7 @@ namespace pdaggerq {
         for (const auto &op : rhs_)
             comments_.push_back(op->str());
 
-        for (const std::string & str : pq_str->get_string())
+        for (const std::string & str : pq_str->get_string(is_spin_blocked, is_range_blocked))
             original_pq_ += str + ' ';
 
     }
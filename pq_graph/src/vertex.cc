@@ -44,14 +44,12 @@ namespace pdaggerq {
 
     /****** Constructors ******/
 
-    Vertex::Vertex(const delta_functions &delta) {
+    Vertex::Vertex(const delta_functions &delta, bool is_spin_blocked, bool is_range_blocked) {
 
         // set base name
         base_name_ = "Id";
 
         // determine if vertex is blocked
-        bool is_range_blocked = pq_string::is_range_blocked;
-        bool is_spin_blocked = pq_string::is_spin_blocked;
         has_blk_ = is_range_blocked || is_spin_blocked;
 
         // get label types
@@ -68,7 +66,7 @@ namespace pdaggerq {
         set_lines(delta.labels, blk_string);
     }
 
-    Vertex::Vertex(const integrals &integral, const string &type) {
+    Vertex::Vertex(const integrals &integral, const string &type, bool is_spin_blocked, bool is_range_blocked) {
 
         // set base name
         if (type == "two_body")  base_name_ = "g";
@@ -80,8 +78,6 @@ namespace pdaggerq {
         else throw invalid_argument("Vertex::Vertex: invalid integral type: " + type);
 
         //determine if vertex is blocked
-        bool is_range_blocked = pq_string::is_range_blocked;
-        bool is_spin_blocked = pq_string::is_spin_blocked;
         has_blk_ = is_range_blocked || is_spin_blocked;
 
         // get label types
@@ -98,7 +94,7 @@ namespace pdaggerq {
         set_lines(integral.labels, blk_string);
     }
 
-    Vertex::Vertex(const amplitudes &amp, char type) {
+    Vertex::Vertex(const amplitudes &amp, char type, bool is_spin_blocked, bool is_range_blocked) {
 
         // get order of amplitude
         size_t order = std::max(amp.n_create, amp.n_annihilate);
@@ -114,8 +110,6 @@ namespace pdaggerq {
         }
 
         //determine if vertex is blocked
-        bool is_range_blocked = pq_string::is_range_blocked;
-        bool is_spin_blocked = pq_string::is_spin_blocked;
         has_blk_ = is_range_blocked || is_spin_blocked;
 
         // get label types
@@ -68,6 +68,36 @@ def test_script_output(test_name):
     # all good
     return
 
+# reorders the ccsdt residuals with pq_graph and writes the result to a file
+ordering_script = """
+import sys, pdaggerq
+graph = pdaggerq.pq_graph({'opt_level': 1, 'print_level': 0, 'exhaustive_ordering': sys.argv[1] == 'exhaustive'})
+for name, proj in (('rt2', [['e2(i,j,b,a)']]), ('rt3', [['e3(i,j,k,c,b,a)']])):
+    pq = pdaggerq.pq_helper('fermi')
+    pq.set_left_operators(proj)
+    pq.add_st_operator(1.0, ['f'], ['t1', 't2', 't3'])
+    pq.add_st_operator(1.0, ['v'], ['t1', 't2', 't3'])
+    pq.simplify()
+    graph.add(pq, name)
+graph.optimize()
+with open(sys.argv[2], 'w') as file:
+    file.write(graph.str('python'))
+"""
+
+# the search over subsets of tensors for the lowest scaling contraction order must agree with testing
+# every ordering. pq_graph options are global, so each search runs in its own process
+def test_contraction_order(tmp_path):
+    outputs = []
+    for mode in ("search", "exhaustive"):
+        output_path = f"{tmp_path}/{mode}.py"
+        result = subprocess.run([str(sys.executable), "-c", ordering_script, mode, output_path], capture_output=True, text=True)
+        if result.returncode != 0:
+            raise AssertionError(f"Failure during execution:\n {result.stderr}")
+        with open(output_path) as file:
+            outputs.append(file.read())
+    assert len(outputs[0]) > 0
+    assert outputs[0] == outputs[1]
+
 if __name__ == "__main__":
     print("Please use pytest to run the tests")
     print("Syntax: python -m pytest numerical_test.py")
@@ -102,34 +102,275 @@ script_path = os.path.dirname(os.path.realpath(__file__))
 os.system(f"rm {script_path}/test_outputs/difference/*")
 os.system(f"rm pq_test.log")
 
-@pytest.mark.parametrize("test_name", tests)
-def test_script_output(test_name):
+# normal-ordering engines. the wick engine is only available for the fermi vacuum, so
+# scripts that use the true vacuum are run with the default (swap) engine either way
+engines = ("swap", "wick")
 
-    # Run the script
-    print(f"Running test {test_name}")
-    result = subprocess.run([str(sys.executable), f"{script_path}/../examples/{test_name}.py"], capture_output=True, text=True)
-    status = result.returncode
-    if status != 0:
+# runs an example script after pointing pdaggerq.pq_helper("fermi") at the requested engine and,
+# optionally, making add_st_operator generate connected terms only
+engine_bootstrap = """
+import os, runpy, sys, pdaggerq
+sys.path.insert(0, os.path.dirname(sys.argv[1]))
+class pq_helper(pdaggerq.pq_helper):
+    def __init__(self, vacuum_type="", engine=""):
+        if vacuum_type.lower() == "fermi" and not engine:
+            engine = sys.argv[2]
+        super().__init__(vacuum_type, engine)
+    def add_st_operator(self, *args, **kwargs):
+        if sys.argv[3] == "connected":
+            kwargs["connected_only"] = True
+        return super().add_st_operator(*args, **kwargs)
+pdaggerq.pq_helper = pq_helper
+runpy.run_path(sys.argv[1], run_name="__main__")
+"""
+
+def run_example(test_name, engine="swap", connected_only=False):
+    example_path = f"{script_path}/../examples/{test_name}.py"
+    mode = "connected" if connected_only else "bch"
+    command = [str(sys.executable), "-c", engine_bootstrap, example_path, engine, mode]
+    result = subprocess.run(command, capture_output=True, text=True)
+    if result.returncode != 0:
         with open("pq_test.log", "a") as file:
-            file.write(f"Test {test_name} failed!!\n")
+            file.write(f"Test {test_name} ({engine}) failed!!\n")
             file.write(result.stderr)
         raise AssertionError(f"Failure during execution:\n {result.stderr}")
+    return result.stdout
+
+@pytest.mark.parametrize("engine", engines)
+@pytest.mark.parametrize("test_name", tests)
+def test_script_output(test_name, engine):
+
+    # Run the script
+    print(f"Running test {test_name} ({engine})")
+    stdout = run_example(test_name, engine)
 
     # append stdout to log file
     with open("pq_test.log", "a") as file:
-        file.write(f"Test {test_name}\n")
-        file.write(result.stdout)
+        file.write(f"Test {test_name} ({engine})\n")
+        file.write(stdout)
 
     # Process outputs
-    result_set   = process_output(result.stdout)
+    result_set   = process_output(stdout)
     expected_set = process_output(read_file(f"{script_path}/reference_outputs/{test_name}.ref"))
 
     # Write actual and expected output to files
-    write_file(f"{script_path}/test_outputs/actual/{test_name}_result.out", result_set)
-    write_file(f"{script_path}/test_outputs/expected/{test_name}_expected.out", expected_set)
+    output_name = f"{test_name}_{engine}"
+    write_file(f"{script_path}/test_outputs/actual/{output_name}_result.out", result_set)
+    write_file(f"{script_path}/test_outputs/expected/{output_name}_expected.out", expected_set)
 
     # Compare outputs
-    compare_outputs(test_name, script_path)
+    compare_outputs(output_name, script_path)
+
+# coupled-cluster equations built from connected products rather than nested commutators
+connected_tests = ("ccsd", "ccsdt")
+
+@pytest.mark.parametrize("test_name", connected_tests)
+def test_connected_only(test_name):
+
+    print(f"Running test {test_name} (connected_only)")
+    stdout = run_example(test_name, connected_only=True)
+
+    result_set   = process_output(stdout)
+    expected_set = process_output(read_file(f"{script_path}/reference_outputs/{test_name}.ref"))
+
+    output_name = f"{test_name}_connected"
+    write_file(f"{script_path}/test_outputs/actual/{output_name}_result.out", result_set)
+    write_file(f"{script_path}/test_outputs/expected/{output_name}_expected.out", expected_set)
+
+    compare_outputs(output_name, script_path)
+
+def ccsd_residual(left_operators, cache_directory=""):
+    pq = pdaggerq.pq_helper("fermi")
+    pq.set_cache_directory(cache_directory)
+    pq.set_left_operators(left_operators)
+    pq.add_st_operator(1.0, ['f'], ['t1', 't2'])
+    pq.add_st_operator(1.0, ['v'], ['t1', 't2'])
+    pq.simplify()
+    return pq.strings()
+
+def test_cache_directory(tmp_path):
+
+    expected = ccsd_residual([['e2(m,n,f,e)']])
+
+    # the first run writes the result, and the second one reads it back
+    assert ccsd_residual([['e2(m,n,f,e)']], str(tmp_path)) == expected
+    cache_files = os.listdir(tmp_path)
+    assert len(cache_files) == 1
+    assert ccsd_residual([['e2(m,n,f,e)']], str(tmp_path)) == expected
+
+    # a file saved for other products under the same name (a stale file or a colliding key)
+    # must not be used
+    other_path = tmp_path / "other"
+    other_path.mkdir()
+    ccsd_residual([['e1(m,e)']], str(other_path))
+    os.replace(other_path / os.listdir(other_path)[0], tmp_path / cache_files[0])
+    assert ccsd_residual([['e2(m,n,f,e)']], str(tmp_path)) == expected
+
+    # a directory that cannot be written only means the result is not cached
+    missing_path = tmp_path / "missing"
+    assert ccsd_residual([['e2(m,n,f,e)']], str(missing_path)) == expected
+    assert not missing_path.exists()
+
+def bernoulli_residual(left_operators, order, prune):
+    pq = pdaggerq.pq_helper("fermi")
+    pq.set_unitary_cc(True)
+    pq.set_prune_operator_portions(prune)
+    pq.set_left_operators([left_operators])
+    pq.add_bernoulli_operator(1.0, ['f'], ['t1', 't2'], order)
+    pq.simplify()
+    return pq.strings()
+
+# products ruled out by their bernoulli operator portions are skipped before normal ordering, which
+# must not change the ucc3 residuals
+@pytest.mark.parametrize("left_operators", (['e1(m,e)'], ['e2(m,n,f,e)']))
+def test_bernoulli_pruning(left_operators):
+    expected = bernoulli_residual(left_operators, 3, False)
+    assert len(expected) > 0
+    assert bernoulli_residual(left_operators, 3, True) == expected
+
+# products are pruned with the excitation level in effect when they are added, so the level cannot
+# change before simplify() uses it
+def test_bernoulli_pruning_level():
+    def residual(prune, level_before_add):
+        pq = pdaggerq.pq_helper("fermi")
+        pq.set_unitary_cc(True)
+        pq.set_prune_operator_portions(prune)
+        pq.set_left_operators([['e1(i,a)']])
+        if level_before_add:
+            pq.set_bernoulli_excitation_level(1)
+        pq.add_bernoulli_operator(1.0, ['f', 'v'], ['t1', 't2'], 2)
+        if not level_before_add:
+            pq.set_bernoulli_excitation_level(1)
+        pq.simplify()
+        return pq.strings()
+
+    expected = residual(False, False)
+    assert len(expected) > 0
+    assert residual(True, True) == expected
+    with pytest.raises(RuntimeError):
+        residual(True, False)
+
+    # once simplify() has used the level, it may change again
+    pq = pdaggerq.pq_helper("fermi")
+    pq.set_unitary_cc(True)
+    pq.set_left_operators([['e1(i,a)']])
+    pq.add_bernoulli_operator(1.0, ['f'], ['t1', 't2'], 2)
+    pq.simplify()
+    pq.set_bernoulli_excitation_level(1)
+
+def commutator_residual(add_commutator, factor, ops):
+    pq = pdaggerq.pq_helper("fermi")
+    pq.set_left_operators([['e2(m,n,f,e)']])
+    if add_commutator == "nested":
+        pq.add_nested_commutator(factor, ops)
+    else:
+        getattr(pq, add_commutator)(factor, *ops)
+    pq.simplify()
+    return pq.strings()
+
+# add_nested_commutator combines identical operator products before normal ordering them, which must
+# not change the result of the hand-written commutators
+@pytest.mark.parametrize("add_commutator, factor, ops", (
+    ("add_double_commutator", 0.5, [['v'], ['t2'], ['t1']]),
+    ("add_double_commutator", 0.5, [['f'], ['t2'], ['t1']]),
+    ("add_triple_commutator", 1.0 / 6.0, [['v'], ['t1'], ['t1'], ['t2']]),
+    ("add_triple_commutator", 1.0 / 6.0, [['v'], ['t1'], ['t1'], ['t1']]),
+))
+def test_nested_commutator(add_commutator, factor, ops):
+    expected = commutator_residual(add_commutator, factor, ops)
+    assert len(expected) > 0
+    assert sorted(commutator_residual("nested", factor, ops)) == sorted(expected)
+
+# term_arrays describes the same terms as strings(), in the same order
+def test_term_arrays():
+    pq = pdaggerq.pq_helper("fermi")
+    pq.set_left_operators([['e2(i,j,b,a)']])
+    pq.add_st_operator(1.0, ['f'], ['t1', 't2'])
+    pq.add_st_operator(1.0, ['v'], ['t1', 't2'])
+    pq.simplify()
+    expected = pq.strings()
+
+    arrays = pq.term_arrays()
+    label_names = arrays.label_names()
+    permutation_names = ("P", "PP2", "PP3", "PP6")
+
+    def name_labels(labels, first, last):
+        return [label_names[labels[k]] for k in range(first, last)]
+
+    assert len(arrays.factors) == len(expected)
+    for t, term in enumerate(expected):
+        assert abs(arrays.factors[t] - float(term[0])) < 5e-3
+
+        actual = []
+        for n in range(arrays.permutation_offsets[t], arrays.permutation_offsets[t + 1]):
+            labels = name_labels(arrays.permutation_labels, arrays.permutation_label_offsets[n], arrays.permutation_label_offsets[n + 1])
+            actual.append(f"{permutation_names[arrays.permutation_types[n]]}({','.join(labels)})")
+        for n in range(arrays.tensor_offsets[t], arrays.tensor_offsets[t + 1]):
+            name = arrays.tensor_names[arrays.tensor_types[n]]
+            labels = name_labels(arrays.labels, arrays.label_offsets[n], arrays.label_offsets[n + 1])
+            if name == "eri":
+                actual.append(f"<{labels[0]},{labels[1]}||{labels[2]},{labels[3]}>")
+            else:
+                actual.append(f"{'f' if name == 'fock' else name}({','.join(labels)})")
+        assert actual == term[1:]
+
+def ccsd_doubles_by_parts(simplify_each_part):
+    pq = pdaggerq.pq_helper("fermi")
+    pq.set_left_operators([['e2(i,j,b,a)']])
+    for operator in ('f', 'v'):
+        pq.add_st_operator(1.0, [operator], ['t1', 't2'])
+        if simplify_each_part:
+            pq.simplify()
+    pq.simplify()
+    return pq.strings()
+
+# strings that survive one call to simplify() are only consolidated with those added later
+def test_repeated_simplify():
+    assert ccsd_doubles_by_parts(True) == ccsd_doubles_by_parts(False)
+
+    pq = pdaggerq.pq_helper("fermi")
+    pq.set_left_operators([['e2(i,j,b,a)']])
+    pq.add_st_operator(1.0, ['v'], ['t1', 't2'])
+    pq.simplify()
+    assert len(pq.strings()) > 0
+    pq.add_st_operator(-1.0, ['v'], ['t1', 't2'])
+    pq.simplify()
+    assert pq.strings() == []
+
+def test_save_and_load(tmp_path):
+
+    pq = pdaggerq.pq_helper("fermi")
+    pq.set_left_operators([['e2(m,n,f,e)']])
+    pq.add_st_operator(1.0, ['f'], ['t1', 't2'])
+    pq.add_st_operator(1.0, ['v'], ['t1', 't2'])
+    pq.simplify()
+    expected = pq.strings()
+
+    filename = str(tmp_path / "ccsd_doubles.bin")
+    pq.save(filename)
+
+    loaded = pdaggerq.pq_helper("fermi")
+    loaded.load(filename)
+    assert loaded.strings() == expected
+
+    # a spin block can be read on its own
+    spin_labels = {'m': 'a', 'n': 'b', 'e': 'a', 'f': 'b'}
+    pq.block_by_spin(spin_labels)
+    expected_block = pq.strings()
+    assert len(expected_block) > 0
+    pq.save(filename)
+
+    loaded = pdaggerq.pq_helper("fermi")
+    loaded.load(filename, spin_labels)
+    assert loaded.strings() == expected_block
+
+    # a truncated file is rejected rather than read past its end
+    with open(filename, "rb") as file:
+        data = file.read()
+    with open(filename, "wb") as file:
+        file.write(data[:len(data) // 2])
+    with pytest.raises(RuntimeError):
+        pdaggerq.pq_helper("fermi").load(filename)
 
 if __name__ == "__main__":
     print("Please use pytest to run the tests")